@@ -0,0 +1,1097 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/extract.hpp"
+#include "archive/index.hpp"
+#include "archive/seekable.hpp"
+#include "archive/tar_reader.hpp"
+#include "parsing/tree.hpp"
+#include "utilities/hash.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+    using Member = archive::Index::Member;
+
+
+    constexpr std::size_t READ_SIZE     = 256 * 1024;
+
+    /* Streamed files up to this size are handed whole to a worker */
+    constexpr std::size_t SMALL_FILE    = 1024 * 1024;
+    constexpr std::size_t MAX_IN_FLIGHT = 64 * 1024 * 1024;
+
+
+    // ---- MEMBER HELPERS ----
+    //
+    bool is_regular( char type ) {
+        return type == '0' or type == '\0' or type == '7';
+    }
+
+
+    /* The member asked for, or everything when empty: a directory
+     * brings all of its contents */
+    bool is_wanted( std::string_view name, std::string_view wanted ) {
+        return wanted.empty() or name == wanted
+            or ( name.starts_with( wanted ) and name[ wanted.size() ] == '/' );
+    }
+
+
+    /* Nothing may land outside the output directory */
+    bool is_safe_name( std::string_view name ) {
+        if ( name.empty() or name.front() == '/' )
+            return false;
+
+        while ( not name.empty() ) {
+            const auto slash     = name.find( '/' );
+            const auto component = name.substr( 0, slash );
+
+            if ( component == ".." )
+                return false;
+
+            if ( slash == std::string_view::npos )
+                break;
+
+            name.remove_prefix( slash + 1 );
+        }
+
+        return true;
+    }
+
+
+    void report( std::string_view what, const fs::path &path, int error ) {
+        fmt::println( stderr, "Cannot {} '{}': {}",
+            what,
+            path.string(),
+            std::strerror( error )
+        );
+    }
+
+
+    // ---- OUTPUT TREE ----
+    //
+    // Every member is resolved from the output directory's fd, one
+    // component at a time with O_NOFOLLOW: a symlink on the way (from the
+    // archive, or left there by an earlier run) fails the member instead
+    // of leading outside. Missing parents are created along the walk.
+    //
+    class OutputDir {
+    public:
+        explicit OutputDir( const fs::path &_root )
+          : root { _root },
+            fd   { ::open( _root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) }
+        {}
+
+        ~OutputDir() {
+            if ( fd >= 0 )
+                ::close( fd );
+        }
+
+        OutputDir( const OutputDir& ) = delete;
+        OutputDir& operator=( const OutputDir& ) = delete;
+
+
+        [[nodiscard]]
+        bool is_open( void ) const {
+            return fd >= 0;
+        }
+
+        [[nodiscard]]
+        fs::path path_of( std::string_view name ) const {
+            return root / name;
+        }
+
+
+        /* The directory `name` (empty: the root), -1 and errno on failure */
+        int open_directory( std::string_view name, bool create ) const {
+            constexpr int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+            int current = ::openat( fd, ".", flags );
+
+            while ( current >= 0 and not name.empty() ) {
+                const auto slash = name.find( '/' );
+                const std::string component { name.substr( 0, slash ) };
+
+                name = slash == std::string_view::npos
+                    ? std::string_view {}
+                    : name.substr( slash + 1 );
+
+                if ( component.empty() or component == "." )
+                    continue;
+
+                int child = ::openat( current, component.c_str(), flags );
+
+                /* Workers may race to create the same parent */
+                if ( child < 0 and errno == ENOENT and create
+                     and ( ::mkdirat( current, component.c_str(), 0777 ) == 0
+                           or errno == EEXIST ))
+                    child = ::openat( current, component.c_str(), flags );
+
+                const int error = errno;
+                ::close( current );
+                errno = error;
+
+                current = child;
+            }
+
+            return current;
+        }
+
+
+        /* The directory holding `name`, whose last component goes to `leaf` */
+        int open_parent( std::string_view name,
+                         bool create,
+                         std::string &leaf
+        ) const {
+            const auto slash = name.rfind( '/' );
+
+            if ( slash == std::string_view::npos ) {
+                leaf = name;
+                return open_directory( {}, create );
+            }
+
+            leaf = name.substr( slash + 1 );
+            return open_directory( name.substr( 0, slash ), create );
+        }
+
+
+        /* A non-directory member, never through a symlink */
+        int open_file( std::string_view name, int flags, bool create ) const {
+            std::string leaf;
+            const int   parent = open_parent( name, create, leaf );
+
+            if ( parent < 0 )
+                return -1;
+
+            int out = ::openat( parent, leaf.c_str(),
+                                flags | O_NOFOLLOW | O_CLOEXEC, 0600 );
+
+            /* A symlink from an earlier run is replaced, not followed */
+            if ( out < 0 and errno == ELOOP and ( flags & O_CREAT )
+                 and ::unlinkat( parent, leaf.c_str(), 0 ) == 0 )
+                out = ::openat( parent, leaf.c_str(),
+                                flags | O_NOFOLLOW | O_CLOEXEC, 0600 );
+
+            const int error = errno;
+            ::close( parent );
+            errno = error;
+
+            return out;
+        }
+
+    private:
+        fs::path root;
+        int      fd;
+    };
+
+
+    // ---- FILE OUTPUT ----
+    //
+    /* Owner-only until the member's own mode is applied */
+    int create_file( const OutputDir &out, const Member &member ) {
+        const auto path = out.path_of( member.name );
+        const auto size = member.size;
+
+        const int fd = out.open_file( member.name, O_WRONLY | O_CREAT | O_TRUNC, true );
+
+        if ( fd < 0 ) {
+            report( "create", path, errno );
+            return -1;
+        }
+
+        /* Extents reserved in one go; filesystems without it just skip */
+        if ( size > 0 and ::fallocate( fd, 0, 0, static_cast<off_t>( size )) != 0
+             and errno != EOPNOTSUPP and errno != ENOSYS )
+        {
+            report( "allocate", path, errno );
+            ::close( fd );
+            return -1;
+        }
+
+        return fd;
+    }
+
+
+    bool write_at( int fd,
+                   const std::byte *data,
+                   std::size_t size,
+                   std::uint64_t offset
+    ) {
+        while ( size > 0 ) {
+            const auto count = ::pwrite( fd, data, size,
+                static_cast<off_t>( offset )
+            );
+
+            if ( count < 0 and errno == EINTR )
+                continue;
+
+            if ( count <= 0 )
+                return false;
+
+            data   += count;
+            size   -= static_cast<std::size_t>( count );
+            offset += static_cast<std::uint64_t>( count );
+        }
+
+        return true;
+    }
+
+
+    void set_attributes( int fd, const fs::path &path, const Member &member ) {
+        const std::array<timespec, 2> times {
+            timespec { .tv_sec = member.mtime, .tv_nsec = 0 },
+            timespec { .tv_sec = member.mtime, .tv_nsec = 0 }
+        };
+
+        if ( ::fchmod( fd, member.mode ) != 0
+             or ::futimens( fd, times.data() ) != 0 )
+            report( "restore attributes of", path, errno );
+    }
+
+
+    /* Through an fd opened without following links */
+    void set_attributes( const OutputDir &out, const Member &member ) {
+        const auto path = out.path_of( member.name );
+
+        const int fd = member.type == '5'
+            ? out.open_directory( member.name, false )
+            : out.open_file( member.name, O_RDONLY, false );
+
+        if ( fd < 0 ) {
+            report( "restore attributes of", path, errno );
+            return;
+        }
+
+        set_attributes( fd, path, member );
+        ::close( fd );
+    }
+
+
+    /* Whole file in one buffer: create, write, attributes, close */
+    bool write_file( const OutputDir &out,
+                     const Member &member,
+                     const std::byte *data
+    ) {
+        const auto path = out.path_of( member.name );
+        const int  fd   = create_file( out, member );
+
+        if ( fd < 0 )
+            return false;
+
+        const bool written = write_at( fd, data, member.size, 0 );
+
+        if ( not written )
+            report( "write", path, errno );
+        else
+            set_attributes( fd, path, member );
+
+        ::close( fd );
+        return written;
+    }
+
+
+    // ---- FINISHING ----
+    //
+    // Links go last so their targets are complete; directories after
+    // that, deepest first, so writing into them cannot touch their times.
+    //
+    // A link never replaces a directory or anything extracted in this
+    // run: only leftovers of an earlier one are removed for it.
+    //
+    bool make_link( const OutputDir &out,
+                    const Member &member,
+                    const std::unordered_set<std::string_view> &extracted
+    ) {
+        const auto path = out.path_of( member.name );
+
+        std::string leaf;
+        const int   parent = out.open_parent( member.name, true, leaf );
+
+        if ( parent < 0 ) {
+            report( "link", path, errno );
+            return false;
+        }
+
+        struct stat existing {};
+        int         status = 0;
+
+        if ( ::fstatat( parent, leaf.c_str(), &existing, AT_SYMLINK_NOFOLLOW ) == 0 ) {
+            if ( S_ISDIR( existing.st_mode ) or extracted.contains( member.name )) {
+                fmt::println( stderr, "Skipping link '{}': it would replace an extracted entry",
+                    member.name
+                );
+                ::close( parent );
+                return true;
+            }
+
+            status = ::unlinkat( parent, leaf.c_str(), 0 );
+        }
+
+        if ( status == 0 and member.type == '2' )
+            status = ::symlinkat( member.link.c_str(), parent, leaf.c_str() );
+
+        else if ( status == 0 ) {
+            std::string target_leaf;
+            const int   target = out.open_parent( member.link, false, target_leaf );
+
+            status = target < 0 ? -1 : ::linkat(
+                target, target_leaf.c_str(), parent, leaf.c_str(), 0
+            );
+
+            if ( target >= 0 ) {
+                const int error = errno;
+                ::close( target );
+                errno = error;
+            }
+        }
+
+        if ( status != 0 )
+            report( "link", path, errno );
+
+        ::close( parent );
+        return status == 0;
+    }
+
+
+    bool finish_tree( const OutputDir &out,
+                      const std::vector<const Member *> &files,
+                      const std::vector<const Member *> &links,
+                      const std::vector<const Member *> &directories
+    ) {
+        std::unordered_set<std::string_view> names;
+
+        for ( const auto *member : files )
+            names.insert( member->name );
+
+        for ( const auto *member : directories )
+            names.insert( member->name );
+
+        bool ok = true;
+
+        for ( const auto *member : links ) {
+            if ( not make_link( out, *member, names ))
+                ok = false;
+
+            names.insert( member->name );
+        }
+
+        for ( auto it = directories.rbegin(); it != directories.rend(); it++ )
+            set_attributes( out, **it );
+
+        return ok;
+    }
+
+
+    // ---- SEEKABLE ARCHIVES ----
+    //
+    // Only the frames holding a wanted file are read; a wanted hardlink
+    // brings its target along.
+    //
+    bool extract_indexed( int fd,
+                          const archive::Index &index,
+                          const OutputDir &out,
+                          std::string_view wanted,
+                          utils::ThreadPool &pool,
+                          std::size_t &entries
+    ) {
+        const auto &members = index.get_members();
+        const auto &frames  = index.get_frames();
+
+        std::vector<std::uint8_t>   selected ( members.size(), 0 );
+        std::vector<const Member *> directories, links, files;
+        std::atomic<bool>           failed { false };
+
+
+        for ( std::size_t i = 0; i < members.size(); i++ ) {
+            const auto &member = members[i];
+
+            if ( not is_wanted( member.name, wanted ))
+                continue;
+
+            const bool safe = is_safe_name( member.name )
+                and ( member.type != '1' or is_safe_name( member.link ));
+
+            if ( not safe ) {
+                fmt::println( stderr, "Skipping unsafe member '{}'", member.name );
+                continue;
+            }
+
+            selected[i] = 1;
+
+            if ( member.type != '1' )
+                continue;
+
+            if ( const auto *target = index.find( member.link ))
+                selected[ static_cast<std::size_t>( target - members.data() ) ] = 1;
+        }
+
+
+        /* Directories in archive order: parents always come first */
+        std::string_view last_parent;
+
+        for ( std::size_t i = 0; i < members.size(); i++ ) {
+            const auto &member = members[i];
+
+            if ( not selected[i] )
+                continue;
+
+            entries++;
+
+            const std::string_view name   = member.name;
+            const auto             slash  = name.rfind( '/' );
+            const auto             parent = member.type == '5'
+                ? name
+                : name.substr( 0, slash == std::string_view::npos ? 0 : slash );
+
+            if ( parent != last_parent ) {
+                const int dir = out.open_directory( parent, true );
+
+                if ( dir < 0 ) {
+                    report( "create directory", out.path_of( parent ), errno );
+                    return false;
+                }
+
+                ::close( dir );
+                last_parent = parent;
+            }
+
+            if ( member.type == '5' )
+                directories.push_back( &member );
+
+            else if ( member.type == '1' or member.type == '2' )
+                links.push_back( &member );
+
+            else if ( is_regular( member.type ))
+                files.push_back( &member );
+        }
+
+
+        /* Files split across frames exist before any frame writes them */
+        const auto spans_frames = [&]( const Member &member ) {
+            return index.frame_at( member.data )
+                != index.frame_at( member.data + member.size - 1 );
+        };
+
+        std::vector<std::uint8_t> needed ( frames.size(), 0 );
+
+        for ( std::size_t i = 0; i < members.size(); i++ ) {
+            const auto &member = members[i];
+
+            if ( not selected[i] or not is_regular( member.type ))
+                continue;
+
+            if ( member.size > 0 ) {
+                const auto first = index.frame_at( member.data );
+                const auto last  = index.frame_at( member.data + member.size - 1 );
+
+                for ( auto f = first; f <= last and f < frames.size(); f++ )
+                    needed[f] = 1;
+
+                if ( first == last )
+                    continue;
+            }
+
+            pool.submit( failed, [&out, &member, &failed] {
+                const int file = create_file( out, member );
+
+                if ( file < 0 ) {
+                    failed = true;
+                    return;
+                }
+
+                if ( member.size == 0 )
+                    set_attributes( file, out.path_of( member.name ), member );
+
+                ::close( file );
+            });
+        }
+
+        pool.wait_idle();
+
+
+        for ( std::size_t f = 0; f < frames.size(); f++ ) {
+            if ( not needed[f] )
+                continue;
+
+            pool.submit( failed, [&, fd, f] {
+                thread_local std::vector<std::byte> raw;
+
+                const auto &frame = frames[f];
+
+                if ( not archive::read_frame( fd, index.get_codec(), frame, raw )) {
+                    fmt::println( stderr,
+                        "\x1b[1;31mError\x1b[0m: Corrupt frame at offset {}",
+                        frame.offset
+                    );
+                    failed = true;
+                    return;
+                }
+
+                const auto frame_end = frame.raw_offset + frame.raw_size;
+
+                /* Data ranges only grow along the archive */
+                auto i = static_cast<std::size_t>( std::partition_point(
+                    members.begin(), members.end(),
+                    [&frame]( const Member &member ) {
+                        return member.data + member.size <= frame.raw_offset;
+                    }
+                ) - members.begin() );
+
+                for ( ; i < members.size() and members[i].data < frame_end; i++ ) {
+                    const auto &member = members[i];
+
+                    if ( not selected[i] or not is_regular( member.type )
+                         or member.size == 0 )
+                        continue;
+
+                    const auto begin = std::max( member.data, frame.raw_offset );
+                    const auto end   = std::min( member.data + member.size, frame_end );
+                    const auto *data = raw.data() + ( begin - frame.raw_offset );
+
+                    if ( not spans_frames( member )) {
+                        if ( not write_file( out, member, data ))
+                            failed = true;
+                        continue;
+                    }
+
+                    const int file = out.open_file( member.name, O_WRONLY, false );
+
+                    if ( file < 0
+                         or not write_at( file, data, end - begin, begin - member.data ))
+                    {
+                        report( "write", out.path_of( member.name ), errno );
+                        failed = true;
+                    }
+
+                    if ( file >= 0 )
+                        ::close( file );
+                }
+            });
+        }
+
+        pool.wait_idle();
+
+
+        /* Pieces of split files may land in any order: attributes last */
+        for ( std::size_t i = 0; i < members.size(); i++ ) {
+            const auto &member = members[i];
+
+            if ( selected[i] and is_regular( member.type )
+                 and member.size > 0 and spans_frames( member ))
+                set_attributes( out, member );
+        }
+
+        return finish_tree( out, files, links, directories ) and not failed;
+    }
+
+
+    // ---- STREAMED ARCHIVES ----
+    //
+    void report_reader_error( archive::TarReader::Errors error ) {
+        using Errors = archive::TarReader::Errors;
+
+        switch ( error ) {
+            case Errors::NONE:
+                break;
+
+            case Errors::READ_FAILED:
+                fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot read archive: {}",
+                    std::strerror( errno )
+                );
+                break;
+
+            case Errors::CORRUPT_DATA:
+                fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Corrupt compressed data" );
+                break;
+
+            case Errors::BAD_HEADER:
+                fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Corrupt tar header" );
+                break;
+
+            case Errors::TRUNCATED:
+                fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Unexpected end of archive" );
+                break;
+        }
+    }
+
+
+    /* The current member's contents, copied as they are read */
+    bool stream_file( archive::TarReader &reader,
+                      const OutputDir &out,
+                      const Member &member
+    ) {
+        const auto path = out.path_of( member.name );
+        const int  file = create_file( out, member );
+
+        if ( file < 0 )
+            return false;
+
+        std::vector<std::byte> buffer ( READ_SIZE );
+        std::uint64_t          done    = 0;
+        bool                   written = true;
+
+        while ( done < member.size ) {
+            const auto chunk = std::min<std::uint64_t>( member.size - done, buffer.size() );
+
+            if ( not reader.read( buffer.data(), chunk ))
+                break;
+
+            if ( not write_at( file, buffer.data(), chunk, done )) {
+                report( "write", path, errno );
+                written = false;
+                break;
+            }
+
+            done += chunk;
+        }
+
+        if ( done == member.size )
+            set_attributes( file, path, member );
+
+        ::close( file );
+        return written;
+    }
+
+
+    // Wanted hardlinks whose target was not selected: a second pass over
+    // the archive writes the first one as a copy of the target, the rest
+    // of the same target are linked to that copy.
+    //
+    bool copy_link_targets( int fd,
+                            const OutputDir &out,
+                            const std::vector<const Member *> &orphans
+    ) {
+        std::unordered_multimap<std::string_view, const Member *> by_target;
+
+        for ( const auto *member : orphans )
+            by_target.emplace( member->link, member );
+
+        if ( ::lseek( fd, 0, SEEK_SET ) != 0 ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot rewind archive: {}",
+                std::strerror( errno )
+            );
+            return false;
+        }
+
+        archive::TarReader reader { fd };
+        Member             target;
+        bool               ok = true;
+
+        while ( ok and not by_target.empty() and reader.next( target )) {
+            if ( not is_regular( target.type ))
+                continue;
+
+            const auto [first, last] = by_target.equal_range( target.name );
+
+            if ( first == last )
+                continue;
+
+            Member copy = *first->second;
+
+            copy.type = '0';
+            copy.size = target.size;
+
+            ok = stream_file( reader, out, copy );
+
+            for ( auto it = std::next( first ); ok and it != last; it++ ) {
+                Member alias = *it->second;
+                alias.link   = copy.name;
+
+                ok = make_link( out, alias, {} );
+            }
+
+            by_target.erase( first, last );
+        }
+
+        report_reader_error( reader.get_error() );
+
+        for ( const auto &[name, member] : by_target ) {
+            fmt::println( stderr, "Cannot link '{}': '{}' is not in the archive",
+                out.path_of( member->name ).string(),
+                name
+            );
+        }
+
+        return ok and by_target.empty() and not reader.has_errors();
+    }
+
+
+    bool extract_stream( int fd,
+                         const OutputDir &out,
+                         std::string_view wanted,
+                         utils::ThreadPool &pool,
+                         std::size_t &entries
+    ) {
+        archive::TarReader reader { fd };
+
+        /* Members live until the end: links and directories point at them */
+        std::deque<Member>          members;
+        std::vector<const Member *> directories, links, files, orphans;
+        std::atomic<bool>           failed { false };
+
+        /* Regular files written so far, what hardlinks may point at */
+        std::unordered_set<std::string_view> extracted;
+
+        /* Small files in flight and the bytes they hold */
+        std::deque<std::pair<std::future<void>, std::size_t>> writes;
+        std::size_t in_flight = 0;
+
+        Member next;
+
+        while ( not failed and reader.next( next )) {
+            const auto type = next.type;
+
+            if ( not is_wanted( next.name, wanted )
+                 or not ( is_regular( type ) or type == '5'
+                          or type == '1' or type == '2' ))
+                continue;
+
+            const bool safe = is_safe_name( next.name )
+                and ( type != '1' or is_safe_name( next.link ));
+
+            if ( not safe ) {
+                fmt::println( stderr, "Skipping unsafe member '{}'", next.name );
+                continue;
+            }
+
+            const auto &member = members.emplace_back( std::move( next ));
+            const auto  path   = out.path_of( member.name );
+
+            entries++;
+
+            if ( type == '5' ) {
+                const int dir = out.open_directory( member.name, true );
+
+                if ( dir < 0 ) {
+                    report( "create directory", path, errno );
+                    failed = true;
+                    break;
+                }
+
+                ::close( dir );
+                directories.push_back( &member );
+                continue;
+            }
+
+            /* Only part of the archive wanted: the target may be left out */
+            if ( type == '1' and not wanted.empty()
+                 and not extracted.contains( member.link ))
+            {
+                orphans.push_back( &member );
+                continue;
+            }
+
+            if ( type == '1' or type == '2' ) {
+                links.push_back( &member );
+                continue;
+            }
+
+            files.push_back( &member );
+            extracted.insert( member.name );
+
+
+            /* Small files go whole to a worker, bounded in memory */
+            if ( member.size <= SMALL_FILE ) {
+                std::vector<std::byte> data ( member.size );
+
+                if ( not reader.read( data.data(), data.size() ))
+                    break;
+
+                while ( in_flight > MAX_IN_FLIGHT ) {
+                    writes.front().first.get();
+                    in_flight -= writes.front().second;
+                    writes.pop_front();
+                }
+
+                in_flight += data.size();
+                writes.emplace_back(
+                    pool.submit( failed, [&out, &member, &failed, data = std::move( data )] {
+                        if ( not write_file( out, member, data.data() ))
+                            failed = true;
+                    }),
+                    member.size
+                );
+                continue;
+            }
+
+
+            /* Big ones are streamed by this thread */
+            if ( not stream_file( reader, out, member )) {
+                failed = true;
+                break;
+            }
+        }
+
+        pool.wait_idle();
+
+        report_reader_error( reader.get_error() );
+
+        bool complete = not failed and not reader.has_errors();
+
+        if ( complete and not orphans.empty() ) {
+            complete = copy_link_targets( fd, out, orphans );
+            files.insert( files.end(), orphans.begin(), orphans.end() );
+        }
+
+        return finish_tree( out, files, links, directories ) and complete;
+    }
+
+
+    // ---- LISTING ----
+    //
+    /* Members of a plain archive, hashed on the way: needs a full pass */
+    bool scan_stream( int fd, std::vector<Member> &members ) {
+        archive::TarReader     reader { fd };
+        std::vector<std::byte> buffer ( READ_SIZE );
+        Member                 member;
+
+        while ( reader.next( member )) {
+            utils::Xxh64  hash;
+            std::uint64_t left = member.size;
+
+            while ( left > 0 ) {
+                const auto chunk = std::min<std::uint64_t>( left, buffer.size() );
+
+                if ( not reader.read( buffer.data(), chunk ))
+                    break;
+
+                hash.update({ buffer.data(), chunk });
+                left -= chunk;
+            }
+
+            if ( is_regular( member.type ))
+                member.hash = hash.digest();
+
+            members.push_back( std::move( member ));
+        }
+
+        report_reader_error( reader.get_error() );
+        return not reader.has_errors();
+    }
+
+
+    char type_letter( char type ) {
+        switch ( type ) {
+            case '5': return 'd';
+            case '1': return 'h';
+            case '2': return 'l';
+            default : return is_regular( type ) ? '-' : '?';
+        }
+    }
+
+
+    /* Every member hangs under `tree`'s root, parents made up as needed */
+    void add_to_tree( DirTree &tree, const Member &member ) {
+        tree.ascend_levels( std::numeric_limits<std::size_t>::max() );
+
+        std::string_view rest = member.name;
+
+        for ( auto slash = rest.find( '/' ); slash != std::string_view::npos;
+                   slash = rest.find( '/' ))
+        {
+            const auto component = rest.substr( 0, slash );
+            rest.remove_prefix( slash + 1 );
+
+            if ( component.empty() or component == "." )
+                continue;
+
+            if ( tree.go_to_child( component ) == DirTree::Errors::NO_SUCH_CHILD ) {
+                (void)tree.add_child( component );
+                (void)tree.go_to_child( component );
+            }
+        }
+
+        (void)tree.add_child( rest, member.type == '5'
+            ? DirTree::NodeType::IS_DIRECTORY
+            : DirTree::NodeType::IS_FILE
+        );
+    }
+}
+
+
+bool archive::extract_archive( const ExtractOptions &options ) {
+    const int fd = ::open( options.archive.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot open '{}': {}",
+            options.archive.string(),
+            std::strerror( errno )
+        );
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories( options.output, ec );
+
+    if ( ec ) {
+        report( "create directory", options.output, ec.value() );
+        ::close( fd );
+        return false;
+    }
+
+
+    const OutputDir out { options.output };
+
+    if ( not out.is_open() ) {
+        report( "open directory", options.output, errno );
+        ::close( fd );
+        return false;
+    }
+
+
+    utils::ThreadPool pool {
+        utils::ThreadPool::resolve_workers( options.threads )
+    };
+
+    /* Names are stored without a trailing '/' */
+    std::string_view wanted = options.member;
+
+    while ( wanted.ends_with( '/' ))
+        wanted.remove_suffix( 1 );
+
+    Index       index;
+    std::size_t entries = 0;
+    bool        ok;
+
+    const auto loaded = index.load( options.archive );
+
+    if ( loaded == Index::Errors::NONE ) {
+        ok = extract_indexed( fd, index, out, wanted, pool, entries );
+
+    } else {
+        /* A broken index is not fatal: the stream itself is still readable */
+        if ( loaded != Index::Errors::NOT_SEEKABLE )
+            fmt::println( stderr, "Ignoring unreadable index of '{}'",
+                options.archive.string()
+            );
+
+        ::posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+        ok = extract_stream( fd, out, wanted, pool, entries );
+    }
+
+    ::close( fd );
+
+    if ( ok and entries == 0 and not wanted.empty() ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: No member '{}' in '{}'",
+            wanted,
+            options.archive.string()
+        );
+        return false;
+    }
+
+    if ( not ok ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Failed to extract '{}'",
+            options.archive.string()
+        );
+        return false;
+    }
+
+    fmt::println("extracted: {} -> {} ({} entries{})",
+        options.archive.string(),
+        options.output.string(),
+        entries,
+        loaded == Index::Errors::NONE ? ", seekable" : ""
+    );
+
+    return true;
+}
+
+
+bool archive::list_archive( const std::filesystem::path &archive ) {
+    Index index;
+
+    const auto loaded = index.load( archive );
+
+    /* Seekable: the index has it all, nothing gets decompressed */
+    std::vector<Member> scanned;
+
+    if ( loaded != Index::Errors::NONE ) {
+        const int fd = ::open( archive.c_str(), O_RDONLY | O_CLOEXEC );
+
+        if ( fd < 0 ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot open '{}': {}",
+                archive.string(),
+                std::strerror( errno )
+            );
+            return false;
+        }
+
+        ::posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+        const bool ok = scan_stream( fd, scanned );
+        ::close( fd );
+
+        if ( not ok )
+            return false;
+    }
+
+    const auto &members = loaded == Index::Errors::NONE
+        ? index.get_members()
+        : scanned;
+
+
+    DirTree       tree { archive.filename().string() };
+    std::uint64_t total = 0;
+
+    for ( const auto &member : members ) {
+        const bool regular = is_regular( member.type );
+
+        fmt::println( "{} {:04o} {:>12} {:>16} {}{}{}",
+            type_letter( member.type ),
+            member.mode,
+            member.size,
+            regular ? fmt::format( "{:016x}", member.hash ) : "",
+            member.name,
+            member.link.empty() ? "" : " -> ",
+            member.link
+        );
+
+        total += member.size;
+        add_to_tree( tree, member );
+    }
+
+    fmt::println( "" );
+    tree.print_tree();
+
+    fmt::println( "listed: {} ({} entries, {} bytes{})",
+        archive.string(),
+        members.size(),
+        total,
+        loaded == Index::Errors::NONE ? ", seekable" : ""
+    );
+
+    return true;
+}
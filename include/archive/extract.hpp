@@ -0,0 +1,45 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+
+namespace archive {
+
+    // ---- EXTRACT OPTIONS ----
+    //
+    struct ExtractOptions {
+        std::filesystem::path archive;
+        std::filesystem::path output;     /* created when missing */
+        std::int64_t          threads;    /* 0 = all cores        */
+        // +
+        std::string member;   /* file or directory, empty = everything */
+    };
+
+
+    // ---- MAIN FUNCTIONS ----
+    //
+    // Restores an archive under `output`. A seekable archive is restored
+    // frame by frame: workers decompress frames and write the pieces of
+    // every file they hold with pwrite, into files created and
+    // preallocated (fallocate) beforehand. Any other gzip, zstd or plain
+    // tar stream is decompressed in one pass, its files written by the
+    // workers as they come out.
+    //
+    // Members with absolute names or ".." components are skipped, links
+    // are created once every file exists and directory modes and times
+    // are restored last.
+    //
+    // With `member` set only that file, or that directory and all below
+    // it, is restored; from a seekable archive only the frames holding
+    // them are read.
+    //
+    bool extract_archive( const ExtractOptions &options );
+    // +
+    /* Type, mode, size, xxh64 and name of every member, then the tree.
+     * A seekable archive is listed from its index alone */
+    bool list_archive( const std::filesystem::path &archive );
+}
@@ -0,0 +1,463 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/gzip.hpp"
+#include "utilities/crc32.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <limits>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    // ---- PER-THREAD DEFLATE STATE ----
+    //
+    // Each pool worker keeps one raw deflate stream alive and resets it
+    // between blocks instead of paying deflateInit2 per block.
+    //
+    struct Deflater {
+        z_stream stream {};
+        int      level = Z_DEFAULT_COMPRESSION;
+        bool     ready = false;
+
+        bool reset( int _level ) {
+            if ( not ready ) {
+                ready = deflateInit2( &stream, _level, Z_DEFLATED,
+                                      -15, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+                level = _level;
+                return ready;
+            }
+
+            if ( deflateReset( &stream ) != Z_OK )
+                return false;
+
+            if ( level != _level ) {
+                if ( deflateParams( &stream, _level, Z_DEFAULT_STRATEGY )
+                        != Z_OK )
+                    return false;
+
+                level = _level;
+            }
+
+            return true;
+        }
+
+        ~Deflater() {
+            if ( ready ) deflateEnd( &stream );
+        }
+    };
+
+
+    /* Little-endian store used by the gzip header and trailer */
+    void put_le32( std::byte *out, std::uint32_t value ) {
+        for ( int i = 0; i < 4; i++ ) {
+            out[i] = static_cast<std::byte>( value & 0xff );
+            value >>= 8;
+        }
+    }
+}
+
+
+/* ---------------------- GZIPSINK:: IMPLEMENTATION ----------------------- */
+
+archive::GzipSink::GzipSink( Sink &_next, int _level )
+  : next   { _next  },
+    level  { _level },
+    buffer ( BUFFER_SIZE )
+{
+    /* Negative windowBits: raw deflate, the framing is written here */
+    const int status = deflateInit2(
+        &stream,
+        _level,
+        Z_DEFLATED,
+        -15,
+        8,
+        Z_DEFAULT_STRATEGY
+    );
+
+    if ( status != Z_OK ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: gzip: {}",
+            stream.msg ? stream.msg : "cannot initialize deflate"
+        );
+
+        _has_errors = true;
+        return;
+    }
+
+    if ( not next.write( gzip_header( level )))
+        _has_errors = true;
+}
+
+
+archive::GzipSink::~GzipSink() {
+    deflateEnd( &stream );
+}
+
+
+bool archive::GzipSink::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+bool archive::GzipSink::deflate_input( int flush ) {
+    int status = Z_OK;
+
+    do {
+        stream.next_out  = reinterpret_cast<Bytef*>( buffer.data() );
+        stream.avail_out = static_cast<uInt>( buffer.size() );
+
+        status = deflate( &stream, flush );
+
+        if ( status == Z_STREAM_ERROR ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: gzip: {}",
+                stream.msg ? stream.msg : "deflate failed"
+            );
+
+            _has_errors = true;
+            return false;
+        }
+
+        const auto produced = buffer.size() - stream.avail_out;
+
+        if ( produced > 0
+            and not next.write({ buffer.data(), produced }) )
+        {
+            _has_errors = true;
+            return false;
+        }
+
+    } while ( stream.avail_out == 0
+        or ( flush == Z_FINISH and status != Z_STREAM_END ));
+
+    return true;
+}
+
+
+bool archive::GzipSink::write( std::span<const std::byte> data ) {
+    if ( _has_errors )
+        return false;
+
+    constexpr std::size_t max_chunk = std::numeric_limits<uInt>::max();
+
+    crc       = utils::crc32( crc, data );
+    total_in += data.size();
+
+    /* avail_in is 32 bits wide, feed bigger spans in pieces */
+    while ( not data.empty() ) {
+        const auto chunk = data.first( std::min( data.size(), max_chunk ));
+
+        stream.next_in  = reinterpret_cast<Bytef*>(
+            const_cast<std::byte*>( chunk.data() )
+        );
+        stream.avail_in = static_cast<uInt>( chunk.size() );
+
+        if ( not deflate_input( Z_NO_FLUSH ))
+            return false;
+
+        data = data.subspan( chunk.size() );
+    }
+
+    return true;
+}
+
+
+bool archive::GzipSink::set_stored( bool _stored ) {
+    if ( _has_errors )
+        return false;
+
+    if ( _stored == stored )
+        return true;
+
+    stored = _stored;
+
+
+    /* Drain everything pending so the new level starts on a fresh block */
+    stream.next_in  = nullptr;
+    stream.avail_in = 0;
+
+    if ( not deflate_input( Z_BLOCK ))
+        return false;
+
+    stream.next_out  = reinterpret_cast<Bytef*>( buffer.data() );
+    stream.avail_out = static_cast<uInt>( buffer.size() );
+
+    const int status = deflateParams( &stream,
+        stored ? Z_NO_COMPRESSION : level,
+        Z_DEFAULT_STRATEGY
+    );
+
+    const auto produced = buffer.size() - stream.avail_out;
+
+    if ( status != Z_OK
+         or ( produced > 0 and not next.write({ buffer.data(), produced })))
+    {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: gzip: {}",
+            stream.msg ? stream.msg : "cannot change level"
+        );
+
+        _has_errors = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool archive::GzipSink::finish( void ) {
+    if ( _has_errors )
+        return false;
+
+    stream.next_in  = nullptr;
+    stream.avail_in = 0;
+
+    return deflate_input( Z_FINISH )
+       and next.write( gzip_trailer( crc, total_in ))
+       and next.finish();
+}
+
+
+/* ------------------ PARALLELGZIPSINK:: IMPLEMENTATION ------------------- */
+
+void archive::ParallelGzipSink::compress_block( Block &block ) {
+    thread_local Deflater deflater;
+
+    if ( not deflater.reset( block.level )) {
+        block.ok = false;
+        return;
+    }
+
+    auto &stream = deflater.stream;
+
+    block.crc = utils::crc32( 0, block.input );
+
+
+    if ( not block.dictionary.empty() ) {
+        deflateSetDictionary( &stream,
+            reinterpret_cast<const Bytef*>( block.dictionary.data() ),
+            static_cast<uInt>( block.dictionary.size() )
+        );
+    }
+
+
+    /* Room for the worst case plus the sync flush marker */
+    block.output.resize(
+        deflateBound( &stream, static_cast<uLong>( block.input.size() )) + 16
+    );
+
+    stream.next_in   = reinterpret_cast<Bytef*>( block.input.data() );
+    stream.avail_in  = static_cast<uInt>( block.input.size() );
+    stream.next_out  = reinterpret_cast<Bytef*>( block.output.data() );
+    stream.avail_out = static_cast<uInt>( block.output.size() );
+
+
+    /* Non-final blocks end byte-aligned so they can be concatenated */
+    const int status = deflate( &stream,
+        block.last ? Z_FINISH : Z_SYNC_FLUSH
+    );
+
+    if ( status != ( block.last ? Z_STREAM_END : Z_OK )
+         or stream.avail_in != 0 )
+    {
+        block.ok = false;
+        return;
+    }
+
+    block.output.resize( block.output.size() - stream.avail_out );
+}
+
+
+bool archive::ParallelGzipSink::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+bool archive::ParallelGzipSink::write_header( void ) {
+    header_sent = true;
+    return next.write( gzip_header( level ));
+}
+
+
+bool archive::ParallelGzipSink::write_trailer( void ) {
+    return next.write( gzip_trailer( crc, total_in ));
+}
+
+
+void archive::ParallelGzipSink::submit_block( bool last ) {
+    auto &block = *current;
+
+    block.last       = last;
+    block.dictionary = std::move( last_tail );
+
+    /* Mixed blocks go with whichever kind of data dominates them */
+    const bool mostly_stored = block.stored_in > 0
+                           and 2 * block.stored_in >= block.input.size();
+
+    block.level = mostly_stored ? Z_NO_COMPRESSION : level;
+
+    /* The tail of this block primes the next one */
+    const auto tail = std::min( block.input.size(), DICT_SIZE );
+
+    last_tail.assign( block.input.end() - std::ptrdiff_t( tail ),
+                      block.input.end() );
+
+    block.done = pool.submit( [&block] {
+        compress_block( block );
+    });
+
+    pending.push_back( std::move( current ));
+
+    current = std::make_unique<Block>();
+    current->input.reserve( INPUT_BLOCK_SIZE );
+}
+
+
+bool archive::ParallelGzipSink::collect_block( void ) {
+    auto block = std::move( pending.front() );
+    pending.pop_front();
+
+    block->done.get();
+
+    if ( not block->ok ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: gzip: deflate failed" );
+        _has_errors = true;
+        return false;
+    }
+
+    if ( not header_sent and not write_header() ) {
+        _has_errors = true;
+        return false;
+    }
+
+    crc = utils::crc32_combine( crc, block->crc, block->input.size() );
+
+    total_in += block->input.size();
+
+    if ( not next.write( block->output )) {
+        _has_errors = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool archive::ParallelGzipSink::write( std::span<const std::byte> data ) {
+    if ( _has_errors )
+        return false;
+
+    while ( not data.empty() ) {
+        auto &input = current->input;
+
+        const auto room  = INPUT_BLOCK_SIZE - input.size();
+        const auto chunk = data.first( std::min( room, data.size() ));
+
+        input.insert( input.end(), chunk.begin(), chunk.end() );
+        data = data.subspan( chunk.size() );
+
+        if ( stored )
+            current->stored_in += chunk.size();
+
+        if ( input.size() < INPUT_BLOCK_SIZE )
+            break;
+
+        submit_block( false );
+
+        /* Bound memory: keep at most two blocks in flight per worker */
+        while ( pending.size() > 2 * pool.size() ) {
+            if ( not collect_block() )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool archive::ParallelGzipSink::set_stored( bool _stored ) {
+    stored = _stored;
+    return not _has_errors;
+}
+
+
+bool archive::ParallelGzipSink::finish( void ) {
+    if ( _has_errors )
+        return false;
+
+    submit_block( true );
+
+    while ( not pending.empty() ) {
+        if ( not collect_block() )
+            return false;
+    }
+
+    return write_trailer() and next.finish();
+}
+
+
+archive::ParallelGzipSink::ParallelGzipSink( Sink &_next,
+                                             int _level,
+                                             utils::ThreadPool &_pool
+)
+  : next    { _next  },
+    level   { _level },
+    pool    { _pool  },
+    current { std::make_unique<Block>() }
+{
+    if ( level < Z_DEFAULT_COMPRESSION or level > Z_BEST_COMPRESSION ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: gzip: invalid level {}",
+            level
+        );
+
+        _has_errors = true;
+    }
+
+    current->input.reserve( INPUT_BLOCK_SIZE );
+}
+
+
+archive::ParallelGzipSink::~ParallelGzipSink() {
+    /* Workers hold references into pending blocks */
+    for ( auto &block : pending ) {
+        if ( block->done.valid() )
+            block->done.wait();
+    }
+}
+
+
+std::array<std::byte, 10> archive::gzip_header( int level ) {
+    std::array<std::byte, 10> header {
+        std::byte{ 0x1f }, std::byte{ 0x8b }, /* magic             */
+        std::byte{ 0x08 },                    /* deflate           */
+        std::byte{ 0x00 },                    /* no flags          */
+        std::byte{ 0x00 }, std::byte{ 0x00 }, /* no mtime          */
+        std::byte{ 0x00 }, std::byte{ 0x00 },
+        std::byte{ 0x00 },                    /* extra flags       */
+        std::byte{ 0x03 }                     /* OS: unix          */
+    };
+
+    if ( level == 9 ) header[8] = std::byte{ 0x02 };
+    if ( level == 1 ) header[8] = std::byte{ 0x04 };
+
+    return header;
+}
+
+
+std::array<std::byte, 8> archive::gzip_trailer( std::uint32_t crc, std::uint64_t size ) {
+    std::array<std::byte, 8> trailer {};
+
+    put_le32( &trailer[0], crc );
+    put_le32( &trailer[4], static_cast<std::uint32_t>( size ));
+
+    return trailer;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/sink.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <zlib.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+
+namespace utils { class ThreadPool; }
+
+
+namespace archive {
+
+    // ---- GZIP SINK ----
+    //
+    // Streams everything it receives through deflate into `next`,
+    // using a single reusable output buffer. Stored stretches switch the
+    // stream to level 0 in place, closing the current deflate block.
+    //
+    // zlib only produces the raw deflate data: header, trailer and the
+    // CRC of the input are ours (utils::crc32).
+    //
+    class GzipSink final : public Sink {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        GzipSink( Sink &_next, int _level );
+        ~GzipSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        GzipSink( const GzipSink& ) = delete;
+        GzipSink& operator=( const GzipSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+        // +
+        bool set_stored( bool _stored ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+    private:
+        // ---- MAIN MEMBERS ----
+        //
+        Sink    &next;
+        z_stream stream {};
+        int      level;
+        bool     stored = false;
+        // +
+        std::uint32_t crc      = 0;
+        std::uint64_t total_in = 0;
+
+
+        // ---- BUFFER STATE ----
+        //
+        static constexpr std::size_t BUFFER_SIZE = 256 * 1024;
+        std::vector<std::byte> buffer;
+
+
+        // ---- ERROR STATE ----
+        //
+        bool _has_errors = false;
+
+
+        // ---- DEFLATE HANDLING ----
+        //
+        bool deflate_input( int flush );
+    };
+
+
+    // ---- PARALLEL GZIP SINK ----
+    //
+    // pigz-style compressor: input is cut into fixed blocks that are
+    // deflated independently on a thread pool, each one primed with the
+    // last 32 KiB of the previous block as dictionary. The raw deflate
+    // pieces are stitched into a single gzip member whose CRC is merged
+    // from the per-block CRCs, so stock gunzip reads the result.
+    //
+    // A block made mostly of stored stretches is deflated at level 0.
+    //
+    class ParallelGzipSink final : public Sink {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        ParallelGzipSink( Sink &_next, int _level, utils::ThreadPool &_pool );
+        ~ParallelGzipSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        ParallelGzipSink( const ParallelGzipSink& ) = delete;
+        ParallelGzipSink& operator=( const ParallelGzipSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+        // +
+        bool set_stored( bool _stored ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+    private:
+        // ---- BLOCK LAYOUT ----
+        //
+        static constexpr std::size_t INPUT_BLOCK_SIZE = 128 * 1024;
+        static constexpr std::size_t DICT_SIZE        =  32 * 1024;
+
+
+        // ---- COMPRESSION JOB ----
+        //
+        struct Block {
+            std::vector<std::byte> input;
+            std::vector<std::byte> dictionary;
+            std::vector<std::byte> output;
+            // +
+            std::size_t   stored_in = 0;    /* input bytes hinted stored */
+            int           level     = Z_DEFAULT_COMPRESSION;
+            // +
+            std::uint32_t crc  = 0;
+            bool          last = false;
+            bool          ok   = true;
+            // +
+            std::future<void> done;
+        };
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        Sink              &next;
+        int                level;
+        utils::ThreadPool &pool;
+
+
+        // ---- STREAM STATE ----
+        //
+        std::unique_ptr<Block>             current;
+        std::deque<std::unique_ptr<Block>> pending;
+        // +
+        std::vector<std::byte> last_tail;
+        std::uint32_t          crc         = 0;
+        std::uint64_t          total_in    = 0;
+        bool                   header_sent = false;
+        bool                   stored      = false;
+
+
+        // ---- ERROR STATE ----
+        //
+        bool _has_errors = false;
+
+
+        // ---- BLOCK HANDLING ----
+        //
+        void submit_block ( bool last );
+        bool collect_block( void );
+        bool write_header ( void );
+        bool write_trailer( void );
+        // +
+        static void compress_block( Block &block );
+    };
+
+
+    // ---- GZIP FRAMING ----
+    //
+    /* Member header, no name nor mtime, extra flags hinting the level */
+    [[nodiscard]]
+    std::array<std::byte, 10> gzip_header( int level );
+    // +
+    /* CRC-32 and size (mod 2^32) of the uncompressed member */
+    [[nodiscard]]
+    std::array<std::byte, 8>  gzip_trailer( std::uint32_t crc, std::uint64_t size );
+}
@@ -0,0 +1,526 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/index.hpp"
+#include "utilities/hash.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    // ---- LOCATOR ----
+    //
+    // Last bytes of the index: magic, version and codec, then the file
+    // offset where the index starts and the size of the encoded index.
+    //
+    constexpr std::string_view LOCATOR_MAGIC = "CXSEEK";
+    constexpr std::uint8_t     VERSION       = 1;
+    constexpr std::size_t      LOCATOR_SIZE  = 24;
+
+
+    // ---- GZIP CARRIER ----
+    //
+    // An empty member: header with FLG.FEXTRA, one 'CX' subfield, the
+    // empty final deflate block (03 00), then CRC32 and ISIZE, both 0.
+    //
+    constexpr std::size_t GZIP_HEAD  = 10 + 2 + 4;
+    constexpr std::size_t GZIP_TAIL  = 2 + 8;
+    constexpr std::size_t GZIP_CHUNK = 65535 - 4;   /* XLEN is 16 bits */
+
+    constexpr std::array<std::uint8_t, GZIP_TAIL> GZIP_EMPTY_TAIL {
+        0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+
+    // ---- ZSTD CARRIER ----
+    //
+    constexpr std::uint32_t ZSTD_SKIPPABLE = 0x184D2A5E;
+    constexpr std::size_t   ZSTD_HEAD      = 8;
+
+
+    template <typename T>
+    void put( std::string &out, T value ) {
+        using U = std::make_unsigned_t<T>;
+
+        auto bits = static_cast<U>( value );
+
+        for ( std::size_t i = 0; i < sizeof( T ); i++ ) {
+            out.push_back( static_cast<char>( bits & 0xff ));
+            bits = static_cast<U>( bits >> 8 );
+        }
+    }
+
+
+    void put_string( std::string &out, std::string_view value ) {
+        put( out, static_cast<std::uint32_t>( value.size() ));
+        out.append( value );
+    }
+
+
+    /* Bounds-checked little-endian reads, `failed` sticks */
+    class Reader {
+    public:
+        explicit Reader( std::string_view _data )
+          : data { _data }
+        {}
+
+        template <typename T>
+        T get( void ) {
+            using U = std::make_unsigned_t<T>;
+
+            if ( failed or data.size() - offset < sizeof( T )) {
+                failed = true;
+                return T {};
+            }
+
+            U bits = 0;
+
+            for ( std::size_t i = sizeof( T ); i --> 0; ) {
+                bits = static_cast<U>( bits << 8 );
+                bits = static_cast<U>(
+                    bits | static_cast<std::uint8_t>( data[ offset + i ] )
+                );
+            }
+
+            offset += sizeof( T );
+            return static_cast<T>( bits );
+        }
+
+        std::string_view get_string( void ) {
+            const auto length = get<std::uint32_t>();
+
+            if ( failed or data.size() - offset < length ) {
+                failed = true;
+                return {};
+            }
+
+            const auto value = data.substr( offset, length );
+            offset += length;
+
+            return value;
+        }
+
+        [[nodiscard]]
+        bool ok( void ) const {
+            return not failed;
+        }
+
+        [[nodiscard]]
+        std::size_t position( void ) const {
+            return offset;
+        }
+
+    private:
+        std::string_view data;
+        std::size_t      offset = 0;
+        bool             failed = false;
+    };
+
+
+    std::uint64_t hash_of( std::string_view bytes ) {
+        utils::Xxh64 hasher;
+        hasher.update( std::as_bytes( std::span( bytes )));
+
+        return hasher.digest();
+    }
+
+
+    std::string gzip_carrier( std::string_view data ) {
+        std::string member {
+            "\x1f\x8b\x08\x04" "\0\0\0\0" "\0\x03", 10
+        };
+
+        put( member, static_cast<std::uint16_t>( data.size() + 4 ));
+        member.append( "CX" );
+        put( member, static_cast<std::uint16_t>( data.size() ));
+        member.append( data );
+        member.append( reinterpret_cast<const char *>( GZIP_EMPTY_TAIL.data() ),
+                       GZIP_EMPTY_TAIL.size() );
+
+        return member;
+    }
+
+
+    /* Descriptor released on scope exit */
+    struct FileHandle {
+        int fd = -1;
+
+        ~FileHandle() {
+            if ( fd >= 0 )
+                ::close( fd );
+        }
+    };
+
+
+    bool read_at( int fd, char *out, std::size_t size, std::uint64_t offset ) {
+        while ( size > 0 ) {
+            const auto count = ::pread( fd, out, size,
+                static_cast<off_t>( offset )
+            );
+
+            if ( count < 0 and errno == EINTR )
+                continue;
+
+            if ( count <= 0 )
+                return false;
+
+            out    += count;
+            size   -= static_cast<std::size_t>( count );
+            offset += static_cast<std::uint64_t>( count );
+        }
+
+        return true;
+    }
+}
+
+
+/* ------------------------ INDEX:: IMPLEMENTATION ------------------------ */
+
+std::string archive::Index::encode( void ) const {
+    std::string blob;
+
+    put( blob, static_cast<std::uint64_t>( frames.size() ));
+
+    for ( const auto &frame : frames ) {
+        put( blob, frame.offset     );
+        put( blob, frame.size       );
+        put( blob, frame.raw_offset );
+        put( blob, frame.raw_size   );
+    }
+
+    put( blob, static_cast<std::uint64_t>( members.size() ));
+
+    for ( const auto &member : members ) {
+        put( blob, member.type   );
+        put( blob, member.mode   );
+        put( blob, member.mtime  );
+        put( blob, member.header );
+        put( blob, member.data   );
+        put( blob, member.size   );
+        put( blob, member.hash   );
+        put_string( blob, member.name );
+        put_string( blob, member.link );
+    }
+
+    /* A torn or edited index must not send readers to wrong offsets */
+    put( blob, hash_of( blob ));
+
+    return blob;
+}
+
+
+archive::Index::Errors archive::Index::decode( std::string_view blob,
+                                               std::uint64_t frames_end
+) {
+    if ( blob.size() < sizeof( std::uint64_t ))
+        return Errors::BAD_FORMAT;
+
+    const auto body = blob.substr( 0, blob.size() - sizeof( std::uint64_t ));
+
+    if ( Reader { blob.substr( body.size() ) }.get<std::uint64_t>()
+         != hash_of( body ))
+        return Errors::BAD_FORMAT;
+
+
+    Reader reader { body };
+
+    frames.clear();
+    members.clear();
+
+    /* A corrupt count cannot claim more records than the bytes hold */
+    const auto frame_count = reader.get<std::uint64_t>();
+
+    if ( frame_count > body.size() / 32 )
+        return Errors::BAD_FORMAT;
+
+    for ( std::uint64_t i = 0; i < frame_count; i++ ) {
+        Frame frame {};
+
+        frame.offset     = reader.get<std::uint64_t>();
+        frame.size       = reader.get<std::uint64_t>();
+        frame.raw_offset = reader.get<std::uint64_t>();
+        frame.raw_size   = reader.get<std::uint64_t>();
+
+        frames.push_back( frame );
+    }
+
+    const auto member_count = reader.get<std::uint64_t>();
+
+    if ( not reader.ok() or member_count > body.size() / 53 )
+        return Errors::BAD_FORMAT;
+
+    for ( std::uint64_t i = 0; i < member_count and reader.ok(); i++ ) {
+        Member member;
+
+        member.type   = reader.get<char>();
+        member.mode   = reader.get<std::uint32_t>();
+        member.mtime  = reader.get<std::int64_t >();
+        member.header = reader.get<std::uint64_t>();
+        member.data   = reader.get<std::uint64_t>();
+        member.size   = reader.get<std::uint64_t>();
+        member.hash   = reader.get<std::uint64_t>();
+        member.name   = reader.get_string();
+        member.link   = reader.get_string();
+
+        members.push_back( std::move( member ));
+    }
+
+    if ( not reader.ok() or reader.position() != body.size() )
+        return Errors::BAD_FORMAT;
+
+    /* The hash only catches torn writes, not a crafted footer */
+    return is_consistent( frames_end ) ? Errors::NONE : Errors::BAD_FORMAT;
+}
+
+
+bool archive::Index::is_consistent( std::uint64_t frames_end ) const {
+    std::uint64_t offset = 0, raw_offset = 0;
+
+    /* Back to back from the start of the file and of the tar stream */
+    for ( const auto &frame : frames ) {
+        if ( frame.offset != offset or frame.raw_offset != raw_offset
+             or frame.size     == 0 or frame.size     > MAX_FRAME_SIZE
+             or frame.raw_size == 0 or frame.raw_size > MAX_FRAME_SIZE )
+            return false;
+
+        offset     += frame.size;
+        raw_offset += frame.raw_size;
+    }
+
+    if ( offset != frames_end )
+        return false;
+
+    /* Readers binary search the members by data offset */
+    std::uint64_t last_data = 0;
+
+    for ( const auto &member : members ) {
+        if ( member.data < last_data or member.header > member.data )
+            return false;
+
+        if ( member.size > raw_offset or member.data > raw_offset - member.size )
+            return false;
+
+        last_data = member.data;
+    }
+
+    return true;
+}
+
+
+bool archive::Index::append( Sink &next, std::uint64_t offset ) const {
+    const auto blob = encode();
+
+    std::string locator { LOCATOR_MAGIC };
+    put( locator, VERSION );
+    put( locator, static_cast<std::uint8_t>( codec ));
+    put( locator, offset );
+    put( locator, static_cast<std::uint64_t>( blob.size() ));
+
+    std::string tail;
+
+    if ( codec == Codec::ZSTD ) {
+        put( tail, ZSTD_SKIPPABLE );
+        put( tail, static_cast<std::uint32_t>( blob.size() + locator.size() ));
+        tail.append( blob );
+        tail.append( locator );
+
+    } else {
+        for ( std::size_t at = 0; at < blob.size(); at += GZIP_CHUNK )
+            tail.append( gzip_carrier(
+                std::string_view( blob ).substr( at, GZIP_CHUNK )
+            ));
+
+        tail.append( gzip_carrier( locator ));
+    }
+
+    return next.write( std::as_bytes( std::span( tail )));
+}
+
+
+archive::Index::Errors archive::Index::load(
+    const std::filesystem::path &path
+) {
+    const FileHandle file { ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) };
+    const int        fd = file.fd;
+
+    if ( fd < 0 )
+        return Errors::OPEN_FAILED;
+
+    struct stat info {};
+
+    if ( ::fstat( fd, &info ) != 0 )
+        return Errors::READ_FAILED;
+
+    const auto file_size = static_cast<std::uint64_t>( info.st_size );
+
+
+    /* zstd ends with the locator, gzip with the locator's carrier tail */
+    std::array<char, LOCATOR_SIZE + GZIP_TAIL> last {};
+
+    if ( file_size < last.size() )
+        return Errors::NOT_SEEKABLE;
+
+    if ( not read_at( fd, last.data(), last.size(), file_size - last.size() ))
+        return Errors::READ_FAILED;
+
+    const std::string_view tail_view { last.data(), last.size() };
+
+    const bool gzip_tail = std::equal(
+        GZIP_EMPTY_TAIL.begin(), GZIP_EMPTY_TAIL.end(),
+        tail_view.substr( LOCATOR_SIZE ).begin(),
+        []( std::uint8_t a, char b ) { return a == std::uint8_t( b ); }
+    );
+
+    auto locator = gzip_tail ? tail_view.substr( 0, LOCATOR_SIZE )
+                             : tail_view.substr( GZIP_TAIL );
+
+    if ( not locator.starts_with( LOCATOR_MAGIC ))
+        return Errors::NOT_SEEKABLE;
+
+    locator.remove_prefix( LOCATOR_MAGIC.size() );
+
+    Reader fields { locator };
+
+    const auto version = fields.get<std::uint8_t >();
+    const auto kind    = fields.get<std::uint8_t >();
+    const auto offset  = fields.get<std::uint64_t>();
+    const auto size    = fields.get<std::uint64_t>();
+
+    if ( version != VERSION or kind > std::uint8_t( Codec::ZSTD )
+         or ( kind == std::uint8_t( Codec::GZIP )) != gzip_tail )
+        return Errors::BAD_FORMAT;
+
+    codec = static_cast<Codec>( kind );
+
+
+    /* Everything between `offset` and the locator (or its carrier) */
+    const std::uint64_t end = gzip_tail
+        ? file_size - GZIP_HEAD - LOCATOR_SIZE - GZIP_TAIL
+        : file_size - LOCATOR_SIZE;
+
+    if ( offset > end or end - offset > ( std::uint64_t( 1 ) << 32 ))
+        return Errors::BAD_FORMAT;
+
+    std::string region ( end - offset, '\0' );
+
+    if ( not read_at( fd, region.data(), region.size(), offset ))
+        return Errors::READ_FAILED;
+
+
+    std::string blob;
+    Reader      reader { region };
+
+    if ( codec == Codec::ZSTD ) {
+        if ( reader.get<std::uint32_t>() != ZSTD_SKIPPABLE
+             or reader.get<std::uint32_t>() != size + LOCATOR_SIZE
+             or region.size() != ZSTD_HEAD + size )
+            return Errors::BAD_FORMAT;
+
+        blob = region.substr( ZSTD_HEAD );
+
+    } else {
+        std::string_view rest { region };
+
+        while ( not rest.empty() ) {
+            Reader member { rest };
+
+            const auto magic = member.get<std::uint32_t>();
+            member.get<std::uint32_t>();    /* mtime        */
+            member.get<std::uint16_t>();    /* XFL, OS      */
+            const auto xlen  = member.get<std::uint16_t>();
+            const auto id    = member.get<std::uint16_t>();
+            const auto chunk = member.get<std::uint16_t>();
+
+            /* 1f 8b 08, FLG.FEXTRA; 'C' 'X' read little-endian */
+            if ( not member.ok() or magic != 0x04088b1f
+                 or id != 0x5843 or xlen != chunk + 4
+                 or rest.size() < GZIP_HEAD + chunk + GZIP_TAIL )
+                return Errors::BAD_FORMAT;
+
+            blob.append( rest.substr( GZIP_HEAD, chunk ));
+            rest.remove_prefix( GZIP_HEAD + chunk + GZIP_TAIL );
+        }
+
+        if ( blob.size() != size )
+            return Errors::BAD_FORMAT;
+    }
+
+    return decode( blob, offset );
+}
+
+
+void archive::Index::add_frame( const Frame &frame ) {
+    frames.push_back( frame );
+}
+
+
+void archive::Index::add_member( Member member ) {
+    members.push_back( std::move( member ));
+}
+
+
+const archive::Index::Member *archive::Index::find(
+    std::string_view name
+) const {
+    const auto it = std::find_if( members.begin(), members.end(),
+        [name]( const Member &member ) { return member.name == name; }
+    );
+
+    return it != members.end() ? &*it : nullptr;
+}
+
+
+std::size_t archive::Index::frame_at( std::uint64_t raw_offset ) const {
+    /* Frames are contiguous and sorted by raw_offset */
+    const auto it = std::upper_bound( frames.begin(), frames.end(), raw_offset,
+        []( std::uint64_t value, const Frame &frame ) {
+            return value < frame.raw_offset;
+        }
+    );
+
+    if ( it == frames.begin() )
+        return frames.size();
+
+    const auto index = static_cast<std::size_t>( it - frames.begin() ) - 1;
+
+    return raw_offset < frames[ index ].raw_offset + frames[ index ].raw_size
+        ? index
+        : frames.size();
+}
+
+
+archive::Index::Codec archive::Index::get_codec( void ) const {
+    return codec;
+}
+
+
+const std::vector<archive::Index::Frame> &archive::Index::get_frames( void ) const {
+    return frames;
+}
+
+
+const std::vector<archive::Index::Member> &archive::Index::get_members( void ) const {
+    return members;
+}
+
+
+archive::Index::Index( Codec _codec )
+  : codec { _codec }
+{}
@@ -0,0 +1,141 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/sink.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace archive {
+
+    // ---- SEEKABLE INDEX ----
+    //
+    // Footer of a seekable archive. Its tar stream is compressed as a run
+    // of independent frames (gzip members or zstd frames), so any frame
+    // can be decompressed on its own. The index maps every frame to its
+    // place in the file and in the tar stream, and every member to the
+    // tar offsets of its header and data, its size and its xxh64.
+    //
+    // It is appended in a form stock tools skip: empty gzip members that
+    // carry it in their FEXTRA field, or one zstd skippable frame. Either
+    // way the file ends with a fixed-size locator pointing back at it,
+    // so a reader only touches the tail and the frames it needs.
+    //
+    // All integers are stored little-endian.
+    //
+    class Index {
+    public:
+        // ---- RECORDS ----
+        //
+        enum class Codec : std::uint8_t {
+            GZIP,
+            ZSTD
+        };
+        // +
+        struct Frame {
+            std::uint64_t offset;       /* in the archive file        */
+            std::uint64_t size;         /* compressed                 */
+            std::uint64_t raw_offset;   /* in the tar stream          */
+            std::uint64_t raw_size;
+        };
+        // +
+        struct Member {
+            std::string   name;         /* as stored, without '/'     */
+            std::string   link;         /* hardlink target, or empty  */
+            char          type   = '0'; /* tar typeflag               */
+            std::uint32_t mode   = 0;
+            std::int64_t  mtime  = 0;   /* seconds since epoch        */
+            std::uint64_t header = 0;   /* tar offset, long names too */
+            std::uint64_t data   = 0;   /* tar offset of the contents */
+            std::uint64_t size   = 0;
+            std::uint64_t hash   = 0;   /* xxh64 of the contents      */
+        };
+
+
+        // ---- ERRORS TYPES ----
+        //
+        enum class Errors : std::uint8_t {
+            NONE,
+            OPEN_FAILED,
+            READ_FAILED,
+            NOT_SEEKABLE,
+            BAD_FORMAT
+        };
+
+
+        // ---- LIMITS ----
+        //
+        /* Largest frame a loaded index may claim, compressed or not;
+         * writers cut theirs well below it */
+        static constexpr std::uint64_t MAX_FRAME_SIZE = 8 * 1024 * 1024;
+
+
+        // ---- CONSTRUCTORS ----
+        //
+        explicit Index( Codec _codec = Codec::GZIP );
+
+
+        // ---- PERSISTENCE ----
+        //
+        /* Reads the locator and the index region of `path` only */
+        Errors load( const std::filesystem::path &path );
+        // +
+        /* Written at `offset` of the archive, right after the last frame */
+        [[nodiscard]]
+        bool append( Sink &next, std::uint64_t offset ) const;
+
+
+        // ---- RECORDS ----
+        //
+        void add_frame ( const Frame &frame );
+        void add_member( Member member );
+        // +
+        /* nullptr when no member has that name */
+        [[nodiscard]]
+        const Member *find( std::string_view name ) const;
+        // +
+        /* Frame holding tar offset `raw_offset`, frames.size() if none */
+        [[nodiscard]]
+        std::size_t frame_at( std::uint64_t raw_offset ) const;
+
+
+        // ---- GETTERS ----
+        //
+        [[nodiscard]]
+        Codec get_codec( void ) const;
+        // +
+        [[nodiscard]]
+        const std::vector<Frame>  &get_frames ( void ) const;
+        [[nodiscard]]
+        const std::vector<Member> &get_members( void ) const;
+
+
+    private:
+        // ---- MAIN MEMBERS ----
+        //
+        Codec               codec;
+        std::vector<Frame>  frames;
+        std::vector<Member> members;
+
+
+        // ---- ENCODING ----
+        //
+        [[nodiscard]]
+        std::string encode( void ) const;
+        // +
+        /* `frames_end`: file offset of the index, where frames stop */
+        [[nodiscard]]
+        Errors decode( std::string_view blob, std::uint64_t frames_end );
+        // +
+        [[nodiscard]]
+        bool is_consistent( std::uint64_t frames_end ) const;
+    };
+}
@@ -0,0 +1,368 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/prefetch.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* TarWriter works with plain stat, fill the fields it reads */
+    struct stat to_stat( const struct statx &raw ) {
+        struct stat info {};
+
+        info.st_dev   = makedev( raw.stx_dev_major, raw.stx_dev_minor );
+        info.st_ino   = raw.stx_ino;
+        info.st_mode  = raw.stx_mode;
+        info.st_nlink = raw.stx_nlink;
+        info.st_uid   = raw.stx_uid;
+        info.st_gid   = raw.stx_gid;
+        info.st_size  = static_cast<off_t>( raw.stx_size );
+        info.st_mtim  = { raw.stx_mtime.tv_sec, raw.stx_mtime.tv_nsec };
+
+        return info;
+    }
+}
+
+
+/* ------------------- URINGPREFETCHER:: IMPLEMENTATION ------------------- */
+
+bool archive::UringPrefetcher::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+io_uring_sqe *archive::UringPrefetcher::prepare( Slot &slot,
+                                                 std::uint8_t opcode,
+                                                 Step step
+) {
+    /* One operation per slot at a time, the ring has room for all */
+    auto *sqe = ring.get_sqe();
+
+    sqe->opcode    = opcode;
+    sqe->user_data = static_cast<std::uint64_t>( &slot - slots.data() );
+
+    slot.step = step;
+    return sqe;
+}
+
+
+void archive::UringPrefetcher::start( std::size_t index ) {
+    auto &slot = slots[ index % SLOTS ];
+
+    slot.offset      = 0;
+    slot.file.error  = 0;
+    slot.file.fd     = -1;
+    slot.file.loaded = false;
+    slot.file.data.clear();
+
+    auto *sqe = prepare( slot, IORING_OP_OPENAT, Step::OPEN );
+
+    sqe->fd         = AT_FDCWD;
+    sqe->addr       = reinterpret_cast<std::uint64_t>( files[ index ].c_str() );
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+}
+
+
+void archive::UringPrefetcher::read( Slot &slot ) {
+    auto *sqe = prepare( slot, IORING_OP_READ, Step::READ );
+
+    sqe->fd   = slot.file.fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(
+        slot.file.data.data() + slot.offset
+    );
+    sqe->len  = static_cast<std::uint32_t>(
+        slot.file.data.size() - slot.offset
+    );
+    sqe->off  = slot.offset;
+}
+
+
+void archive::UringPrefetcher::close( Slot &slot ) {
+    if ( slot.file.fd < 0 ) {
+        slot.step = Step::READY;
+        return;
+    }
+
+    auto *sqe = prepare( slot, IORING_OP_CLOSE, Step::CLOSE );
+    sqe->fd = std::exchange( slot.file.fd, -1 );
+}
+
+
+void archive::UringPrefetcher::complete( Slot &slot, int result ) {
+    using enum Step;
+
+    if ( result < 0 and slot.step != CLOSE ) {
+        slot.file.error = -result;
+        close( slot );
+        return;
+    }
+
+
+    switch ( slot.step ) {
+        case OPEN: {
+            slot.file.fd = result;
+
+            auto *sqe = prepare( slot, IORING_OP_STATX, STATX );
+
+            sqe->fd          = slot.file.fd;
+            sqe->addr        = reinterpret_cast<std::uint64_t>( "" );
+            sqe->statx_flags = AT_EMPTY_PATH;
+            sqe->len         = STATX_BASIC_STATS;
+            sqe->off         = reinterpret_cast<std::uint64_t>( &slot.raw );
+            break;
+        }
+
+        case STATX:
+            slot.file.info = to_stat( slot.raw );
+
+            /* Big files stay open, the writer streams them itself */
+            if ( not S_ISREG( slot.raw.stx_mode )
+                 or slot.raw.stx_size > SMALL_FILE )
+            {
+                slot.step = READY;
+                break;
+            }
+
+            slot.file.data.resize( slot.raw.stx_size );
+
+            if ( slot.raw.stx_size == 0 ) {
+                slot.file.loaded = true;
+                close( slot );
+            } else {
+                read( slot );
+            }
+            break;
+
+        case READ:
+            slot.offset += static_cast<std::uint64_t>( result );
+
+            /* result == 0: the file shrank, keep what was read */
+            if ( result == 0 or slot.offset >= slot.file.data.size() ) {
+                slot.file.data.resize( slot.offset );
+                slot.file.info.st_size = static_cast<off_t>( slot.offset );
+                slot.file.loaded = true;
+                close( slot );
+            } else {
+                read( slot );
+            }
+            break;
+
+        case CLOSE:
+            slot.step = READY;
+            break;
+
+        case IDLE:
+        case READY:
+            break;
+    }
+}
+
+
+bool archive::UringPrefetcher::wait_for( const Slot &slot ) {
+    while ( slot.step != Step::READY ) {
+        if ( const int status = ring.submit_and_wait( 1 ); status < 0 ) {
+            _has_errors = true;
+            return false;
+        }
+
+        ring.for_each_cqe( [&]( std::uint64_t user_data, int result ) {
+            complete( slots[ user_data ], result );
+        });
+    }
+
+    return true;
+}
+
+
+archive::UringPrefetcher::Loaded &archive::UringPrefetcher::next( void ) {
+    /* The previous file was consumed, its slot can take a new one */
+    if ( head > 0 )
+        slots[ ( head - 1 ) % SLOTS ].step = Step::IDLE;
+
+    while ( issued < files.size() and issued < head + SLOTS )
+        start( issued++ );
+
+
+    auto &slot = slots[ head++ % SLOTS ];
+
+    if ( not wait_for( slot )) {
+        slot.file.error = EIO;
+        slot.step       = Step::READY;
+    }
+
+    return slot.file;
+}
+
+
+archive::UringPrefetcher::UringPrefetcher(
+    const std::vector<std::filesystem::path> &_files
+)
+  : files { _files    },
+    ring  { SLOTS * 2 }
+{
+    _has_errors = not ring.supports({
+        IORING_OP_OPENAT,
+        IORING_OP_STATX,
+        IORING_OP_READ,
+        IORING_OP_CLOSE
+    });
+}
+
+
+archive::UringPrefetcher::~UringPrefetcher() {
+    /* The kernel may still write into slot buffers: drain first */
+    for ( auto &slot : slots ) {
+        if ( slot.step == Step::IDLE )
+            continue;
+
+        if ( not _has_errors )
+            wait_for( slot );
+
+        if ( slot.file.fd >= 0 )
+            ::close( std::exchange( slot.file.fd, -1 ));
+    }
+}
+
+
+/* ------------------ THREADPREFETCHER:: IMPLEMENTATION ------------------- */
+
+bool archive::ThreadPrefetcher::has_errors( void ) const {
+    return false;
+}
+
+
+void archive::ThreadPrefetcher::load( const std::filesystem::path &path,
+                                      Loaded &file
+) {
+    file.fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( file.fd < 0 or ::fstat( file.fd, &file.info ) != 0 ) {
+        file.error = errno;
+
+        if ( file.fd >= 0 )
+            ::close( std::exchange( file.fd, -1 ));
+        return;
+    }
+
+    const auto size = static_cast<std::size_t>( file.info.st_size );
+
+    /* Big files stay open, the kernel starts reading them meanwhile */
+    if ( not S_ISREG( file.info.st_mode ) or size > SMALL_FILE ) {
+        if ( S_ISREG( file.info.st_mode ))
+            ::posix_fadvise( file.fd, 0,
+                             static_cast<off_t>( std::min( size, READAHEAD )),
+                             POSIX_FADV_WILLNEED );
+        return;
+    }
+
+    /* Closed: the writer is gone, nothing will consume this */
+    if ( not budget.acquire( size )) {
+        file.error = ECANCELED;
+        ::close( std::exchange( file.fd, -1 ));
+        return;
+    }
+
+
+    file.data.resize( size );
+
+    std::size_t offset = 0;
+
+    while ( offset < size ) {
+        const auto count = ::read( file.fd, file.data.data() + offset, size - offset );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count < 0 ) {
+            file.error = errno;
+            offset     = 0;
+            break;
+        }
+
+        /* The file shrank, keep what was read */
+        if ( count == 0 )
+            break;
+
+        offset += static_cast<std::size_t>( count );
+    }
+
+    ::close( std::exchange( file.fd, -1 ));
+
+    /* Only what is held stays charged */
+    budget.release( size - offset );
+
+    file.data.resize( offset );
+    file.info.st_size = static_cast<off_t>( offset );
+    file.loaded       = file.error == 0;
+}
+
+
+void archive::ThreadPrefetcher::run( void ) {
+    for ( const auto &path : files ) {
+        Loaded file;
+        load( path, file );
+
+        if ( not queue.push( std::move( file ))) {
+            if ( file.fd >= 0 )
+                ::close( file.fd );
+            return;
+        }
+    }
+
+    queue.close();
+}
+
+
+archive::Prefetcher::Loaded &archive::ThreadPrefetcher::next( void ) {
+    /* The previous file was consumed, its contents leave the budget */
+    if ( not current.data.empty() )
+        budget.release( current.data.size() );
+
+    current = {};
+
+    /* Asked past the last file */
+    if ( not queue.pop( current ))
+        current.error = EIO;
+
+    return current;
+}
+
+
+archive::ThreadPrefetcher::ThreadPrefetcher(
+    const std::vector<std::filesystem::path> &_files,
+    std::size_t _budget
+)
+  : files  { _files  },
+    budget { _budget },
+    reader { [this] { run(); } }
+{}
+
+
+archive::ThreadPrefetcher::~ThreadPrefetcher() {
+    /* The writer may stop early: wake the reader wherever it waits */
+    queue.close();
+    budget.close();
+    reader.join();
+
+    Loaded left;
+
+    while ( queue.try_pop( left )) {
+        if ( left.fd >= 0 )
+            ::close( left.fd );
+    }
+}
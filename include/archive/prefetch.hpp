@@ -0,0 +1,197 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/memory_budget.hpp"
+#include "utilities/spsc_queue.hpp"
+#include "utilities/uring.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <sys/stat.h>
+
+
+namespace archive {
+
+    // ---- PREFETCHER ----
+    //
+    // Read stage of the writer: opens, stats and reads the next files of
+    // the archive ahead of it, in order. Small files arrive fully loaded;
+    // bigger ones arrive as an open fd that the caller streams and closes
+    // itself.
+    //
+    class Prefetcher {
+    public:
+        // ---- LOADED FILE ----
+        //
+        struct Loaded {
+            int          error = 0;     /* errno, 0 on success          */
+            int          fd    = -1;    /* open when data is not loaded */
+            struct stat  info  {};
+            // +
+            std::vector<std::byte> data;
+            bool                   loaded = false;
+        };
+
+
+        virtual ~Prefetcher() = default;
+
+        [[nodiscard]]
+        virtual bool has_errors( void ) const = 0;
+        // +
+        /* Blocks until the next file (in order) is ready. The reference
+         * stays valid until the following call. */
+        virtual Loaded &next( void ) = 0;
+    };
+
+
+    // ---- IO_URING PREFETCHER ----
+    //
+    // Keeps up to SLOTS files in flight through io_uring.
+    //
+    class UringPrefetcher final : public Prefetcher {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit UringPrefetcher(
+            const std::vector<std::filesystem::path> &_files
+        );
+        ~UringPrefetcher() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        UringPrefetcher( const UringPrefetcher& ) = delete;
+        UringPrefetcher& operator=( const UringPrefetcher& ) = delete;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+        // ---- MAIN METHODS ----
+        //
+        Loaded &next( void ) override;
+
+
+    private:
+        // ---- RING LAYOUT ----
+        //
+        static constexpr unsigned    SLOTS      = 64;
+        static constexpr std::size_t SMALL_FILE = 256 * 1024;
+
+
+        // ---- SLOT STATE ----
+        //
+        enum class Step : std::uint8_t {
+            IDLE,
+            OPEN,
+            STATX,
+            READ,
+            CLOSE,
+            READY
+        };
+        // +
+        struct Slot {
+            Step          step   = Step::IDLE;
+            std::uint64_t offset = 0;
+            struct statx  raw    {};
+            Loaded        file   {};
+        };
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        const std::vector<std::filesystem::path> &files;
+        // +
+        utils::IoUring          ring;
+        std::array<Slot, SLOTS> slots;
+        // +
+        std::size_t head        = 0;   /* next file handed out   */
+        std::size_t issued      = 0;   /* next file to start     */
+        bool        _has_errors = false;
+
+
+        // ---- STATE MACHINE ----
+        //
+        void start   ( std::size_t index );
+        void complete( Slot &slot, int result );
+        void read    ( Slot &slot );
+        void close   ( Slot &slot );
+        bool wait_for( const Slot &slot );
+        // +
+        io_uring_sqe *prepare( Slot &slot, std::uint8_t opcode, Step step );
+    };
+
+
+    // ---- THREAD PREFETCHER ----
+    //
+    // A reader thread doing the same with plain syscalls, handing files
+    // over through a bounded queue. Loaded contents are charged to a
+    // memory budget: the reader runs ahead as far as it allows, then
+    // waits for the writer to consume. Big files get a kernel readahead
+    // hint before they are handed over.
+    //
+    class ThreadPrefetcher final : public Prefetcher {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        ThreadPrefetcher( const std::vector<std::filesystem::path> &_files,
+                          std::size_t _budget );
+        ~ThreadPrefetcher() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        ThreadPrefetcher( const ThreadPrefetcher& ) = delete;
+        ThreadPrefetcher& operator=( const ThreadPrefetcher& ) = delete;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+        // ---- MAIN METHODS ----
+        //
+        Loaded &next( void ) override;
+
+
+    private:
+        // ---- QUEUE LAYOUT ----
+        //
+        static constexpr std::size_t SLOTS      = 256;
+        static constexpr std::size_t SMALL_FILE = 1024 * 1024;
+        static constexpr std::size_t READAHEAD  = 8 * 1024 * 1024;
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        const std::vector<std::filesystem::path> &files;
+        // +
+        utils::MemoryBudget       budget;
+        utils::SpscQueue<Loaded>  queue { SLOTS };
+        Loaded                    current;
+        // +
+        std::thread reader;
+
+
+        // ---- READER THREAD ----
+        //
+        void run ( void );
+        void load( const std::filesystem::path &path, Loaded &file );
+    };
+}
@@ -0,0 +1,160 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/sample.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <zlib.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* Sorted: looked up with a binary search */
+    constexpr std::array<std::string_view, 44> COMPRESSED_EXTENSIONS {
+        "7z"  , "aac" , "apk" , "avif", "br"  , "bz2" , "cab" , "docx",
+        "epub", "flac", "gif" , "gz"  , "heic", "jar" , "jpeg", "jpg" ,
+        "lz4" , "lzma", "m4a" , "m4v" , "mkv" , "mov" , "mp3" , "mp4" ,
+        "odp" , "ods" , "odt" , "ogg" , "opus", "png" , "pptx", "rar" ,
+        "tgz" , "txz" , "webm", "webp", "whl" , "woff", "woff2", "xlsx",
+        "xz"  , "zip" , "zst" , "zstd"
+    };
+
+
+    /* Below this a file is not worth a sample, nor a level switch */
+    constexpr std::size_t MIN_FILE_SIZE = 16 * 1024;
+    constexpr std::size_t SAMPLE_SIZE   = 64 * 1024;
+
+
+    /* Bits per byte; random data sits just under 8 */
+    constexpr double MIN_ENTROPY = 7.5;
+
+    /* Trial output at or above this fraction of the input: no gain */
+    constexpr double MIN_RATIO = 0.97;
+
+
+    double entropy( std::span<const std::byte> sample ) {
+        std::array<std::size_t, 256> counts {};
+
+        for ( const auto byte : sample )
+            counts[ static_cast<std::uint8_t>( byte ) ]++;
+
+        const auto total = static_cast<double>( sample.size() );
+        double     bits  = 0.0;
+
+        for ( const auto count : counts ) {
+            if ( count == 0 )
+                continue;
+
+            const auto p = static_cast<double>( count ) / total;
+            bits -= p * std::log2( p );
+        }
+
+        return bits;
+    }
+}
+
+
+bool archive::has_compressed_extension( std::string_view name ) {
+    const auto dot = name.rfind( '.' );
+
+    if ( dot == std::string_view::npos or dot + 1 == name.size() )
+        return false;
+
+    std::string extension { name.substr( dot + 1 ) };
+
+    for ( auto &c : extension )
+        c = static_cast<char>( std::tolower( static_cast<unsigned char>( c )));
+
+    return std::binary_search( COMPRESSED_EXTENSIONS.begin(),
+                               COMPRESSED_EXTENSIONS.end(),
+                               extension );
+}
+
+
+bool archive::is_incompressible( std::span<const std::byte> sample ) {
+    if ( sample.empty() or entropy( sample ) < MIN_ENTROPY )
+        return false;
+
+
+    /* A flat histogram can still hide long repeats: try the real thing */
+    auto bound = compressBound( static_cast<uLong>( sample.size() ));
+    std::vector<Bytef> output ( bound );
+
+    const int status = compress2( output.data(), &bound,
+        reinterpret_cast<const Bytef *>( sample.data() ),
+        static_cast<uLong>( sample.size() ),
+        Z_BEST_SPEED
+    );
+
+    return status == Z_OK
+       and static_cast<double>( bound )
+           >= MIN_RATIO * static_cast<double>( sample.size() );
+}
+
+
+bool archive::is_incompressible( const std::filesystem::path &path ) {
+    const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat info {};
+
+    if ( ::fstat( fd, &info ) != 0
+         or static_cast<std::size_t>( info.st_size ) < MIN_FILE_SIZE )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    if ( has_compressed_extension( path.filename().native() )) {
+        ::close( fd );
+        return true;
+    }
+
+
+    std::vector<std::byte> sample ( SAMPLE_SIZE );
+    std::size_t            filled = 0;
+
+    while ( filled < sample.size() ) {
+        const auto count = ::read( fd,
+            sample.data() + filled,
+            sample.size() - filled
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count <= 0 )
+            break;
+
+        filled += static_cast<std::size_t>( count );
+    }
+
+    ::close( fd );
+
+    sample.resize( filled );
+    return is_incompressible( sample );
+}
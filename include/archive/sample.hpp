@@ -0,0 +1,30 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+
+namespace archive {
+
+    // ---- INCOMPRESSIBLE CONTENT ----
+    //
+    // Spots files that deflate or zstd would only burn CPU on: formats
+    // that are already compressed, known by their extension, and any
+    // other file whose first block has close to 8 bits of entropy per
+    // byte and does not shrink when trial-deflated at the fastest level.
+    //
+    [[nodiscard]]
+    bool has_compressed_extension( std::string_view name );
+    // +
+    [[nodiscard]]
+    bool is_incompressible( std::span<const std::byte> sample );
+    // +
+    /* Extension first, then the first block of `path`. Unreadable or
+     * small files are left to the compressor. */
+    [[nodiscard]]
+    bool is_incompressible( const std::filesystem::path &path );
+}
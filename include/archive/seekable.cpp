@@ -0,0 +1,404 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/seekable.hpp"
+#include "archive/gzip.hpp"
+#include "archive/zstd.hpp"
+#include "utilities/crc32.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+#include <zlib.h>
+#include <zstd.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    // ---- PER-THREAD COMPRESSION STATE ----
+    //
+    // Each pool worker keeps one gzip stream and one zstd context alive
+    // and resets them between frames.
+    //
+    struct GzipFrames {
+        z_stream stream {};
+        int      level = Z_DEFAULT_COMPRESSION;
+        bool     ready = false;
+
+        bool reset( int _level ) {
+            if ( not ready ) {
+                /* Raw deflate: compress_frame() wraps it in a gzip member */
+                ready = deflateInit2( &stream, _level, Z_DEFLATED,
+                                      -15, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+                level = _level;
+                return ready;
+            }
+
+            if ( deflateReset( &stream ) != Z_OK )
+                return false;
+
+            if ( level != _level ) {
+                if ( deflateParams( &stream, _level, Z_DEFAULT_STRATEGY )
+                        != Z_OK )
+                    return false;
+
+                level = _level;
+            }
+
+            return true;
+        }
+
+        ~GzipFrames() {
+            if ( ready ) deflateEnd( &stream );
+        }
+    };
+
+
+    struct ZstdFrames {
+        ZSTD_CCtx *context = ZSTD_createCCtx();
+
+        ~ZstdFrames() {
+            ZSTD_freeCCtx( context );
+        }
+    };
+
+
+    struct GzipReader {
+        z_stream stream {};
+        bool     ready = false;
+
+        bool reset( void ) {
+            if ( not ready ) {
+                ready = inflateInit2( &stream, 15 + 16 ) == Z_OK;
+                return ready;
+            }
+
+            return inflateReset( &stream ) == Z_OK;
+        }
+
+        ~GzipReader() {
+            if ( ready ) inflateEnd( &stream );
+        }
+    };
+
+
+    struct ZstdReader {
+        ZSTD_DCtx *context = archive::create_zstd_reader();
+
+        ~ZstdReader() {
+            ZSTD_freeDCtx( context );
+        }
+    };
+}
+
+
+/* -------------------- SEEKABLESINK:: IMPLEMENTATION --------------------- */
+
+void archive::SeekableSink::compress_frame( Frame &frame,
+                                            Index::Codec codec,
+                                            int level
+) {
+    if ( codec == Index::Codec::ZSTD ) {
+        thread_local ZstdFrames frames;
+
+        const auto context = frames.context;
+
+        if ( context == nullptr
+             or ZSTD_isError( ZSTD_CCtx_setParameter( context,
+                    ZSTD_c_compressionLevel,
+                    frame.stored ? ZSTD_minCLevel() : level ))
+             or ZSTD_isError( ZSTD_CCtx_setParameter( context,
+                    ZSTD_c_checksumFlag, 1 )))
+        {
+            frame.ok = false;
+            return;
+        }
+
+        frame.output.resize( ZSTD_compressBound( frame.input.size() ));
+
+        const auto size = ZSTD_compress2( context,
+            frame.output.data(), frame.output.size(),
+            frame.input.data() , frame.input.size()
+        );
+
+        if ( ZSTD_isError( size )) {
+            frame.ok = false;
+            return;
+        }
+
+        frame.output.resize( size );
+        return;
+    }
+
+
+    thread_local GzipFrames frames;
+
+    if ( not frames.reset( frame.stored ? Z_NO_COMPRESSION : level )) {
+        frame.ok = false;
+        return;
+    }
+
+    auto &stream = frames.stream;
+
+    const auto header  = gzip_header( level );
+    const auto trailer = gzip_trailer( utils::crc32( 0, frame.input ),
+                                       frame.input.size() );
+
+    /* Header and trailer on top of the deflate bound */
+    frame.output.resize( header.size()
+        + deflateBound( &stream, static_cast<uLong>( frame.input.size() ))
+        + trailer.size()
+    );
+
+    std::copy( header.begin(), header.end(), frame.output.begin() );
+
+    stream.next_in   = reinterpret_cast<Bytef*>( frame.input.data() );
+    stream.avail_in  = static_cast<uInt>( frame.input.size() );
+    stream.next_out  = reinterpret_cast<Bytef*>( frame.output.data() + header.size() );
+    stream.avail_out = static_cast<uInt>( frame.output.size() - header.size() );
+
+    if ( deflate( &stream, Z_FINISH ) != Z_STREAM_END
+         or stream.avail_out < trailer.size() )
+    {
+        frame.ok = false;
+        return;
+    }
+
+    const auto end = frame.output.end() - std::ptrdiff_t( stream.avail_out );
+
+    std::copy( trailer.begin(), trailer.end(), end );
+    frame.output.resize( frame.output.size() - stream.avail_out + trailer.size() );
+}
+
+
+bool archive::SeekableSink::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+void archive::SeekableSink::submit_frame( void ) {
+    auto &frame = *current;
+
+    frame.raw_offset = raw_offset;
+    frame.stored     = frame.stored_in > 0
+                   and 2 * frame.stored_in >= frame.input.size();
+
+    raw_offset += frame.input.size();
+
+    frame.done = pool.submit(
+        [&frame, codec = index.get_codec(), level = level] {
+            compress_frame( frame, codec, level );
+        }
+    );
+
+    pending.push_back( std::move( current ));
+
+    current = std::make_unique<Frame>();
+    current->input.reserve( FRAME_SIZE );
+}
+
+
+bool archive::SeekableSink::collect_frame( void ) {
+    auto frame = std::move( pending.front() );
+    pending.pop_front();
+
+    frame->done.get();
+
+    if ( not frame->ok ) {
+        fmt::println( stderr,
+            "\x1b[1;31mError\x1b[0m: seekable: frame compression failed"
+        );
+        _has_errors = true;
+        return false;
+    }
+
+    if ( not next.write( frame->output )) {
+        _has_errors = true;
+        return false;
+    }
+
+    index.add_frame( Index::Frame {
+        .offset     = offset,
+        .size       = frame->output.size(),
+        .raw_offset = frame->raw_offset,
+        .raw_size   = frame->input.size()
+    });
+
+    offset += frame->output.size();
+    return true;
+}
+
+
+bool archive::SeekableSink::drain( std::size_t limit ) {
+    while ( pending.size() > limit ) {
+        if ( not collect_frame() )
+            return false;
+    }
+
+    return true;
+}
+
+
+bool archive::SeekableSink::write( std::span<const std::byte> data ) {
+    if ( _has_errors )
+        return false;
+
+    while ( not data.empty() ) {
+        auto &input = current->input;
+
+        const auto room  = FRAME_SIZE - input.size();
+        const auto chunk = data.first( std::min( room, data.size() ));
+
+        input.insert( input.end(), chunk.begin(), chunk.end() );
+        data = data.subspan( chunk.size() );
+
+        if ( stored )
+            current->stored_in += chunk.size();
+
+        if ( input.size() < FRAME_SIZE )
+            break;
+
+        submit_frame();
+
+        /* Bound memory: keep at most two frames in flight per worker */
+        if ( not drain( 2 * pool.size() ))
+            return false;
+    }
+
+    return true;
+}
+
+
+bool archive::SeekableSink::set_stored( bool _stored ) {
+    if ( _has_errors )
+        return false;
+
+    /* Frames need not be full: end one where the kind of data changes,
+     * unless it is still too small to be worth its own frame */
+    if ( _stored != stored and current->input.size() >= MIN_CUT_SIZE ) {
+        submit_frame();
+
+        if ( not drain( 2 * pool.size() ))
+            return false;
+    }
+
+    stored = _stored;
+    return true;
+}
+
+
+bool archive::SeekableSink::finish( void ) {
+    if ( _has_errors )
+        return false;
+
+    if ( not current->input.empty() )
+        submit_frame();
+
+    if ( not drain( 0 ))
+        return false;
+
+    if ( not index.append( next, offset )) {
+        _has_errors = true;
+        return false;
+    }
+
+    return next.finish();
+}
+
+
+archive::SeekableSink::SeekableSink( Sink &_next,
+                                     Index &_index,
+                                     int _level,
+                                     utils::ThreadPool &_pool
+)
+  : next    { _next  },
+    index   { _index },
+    level   { _level },
+    pool    { _pool  },
+    current { std::make_unique<Frame>() }
+{
+    current->input.reserve( FRAME_SIZE );
+}
+
+
+archive::SeekableSink::~SeekableSink() {
+    /* Workers hold references into pending frames */
+    for ( auto &frame : pending ) {
+        if ( frame->done.valid() )
+            frame->done.wait();
+    }
+}
+
+bool archive::read_frame( int fd,
+                          Index::Codec codec,
+                          const Index::Frame &frame,
+                          std::vector<std::byte> &out
+) {
+    thread_local std::vector<std::byte> input;
+
+    input.resize( frame.size );
+    out.resize( frame.raw_size );
+
+    for ( std::size_t done = 0; done < input.size(); ) {
+        const auto count = ::pread( fd,
+            input.data() + done,
+            input.size() - done,
+            static_cast<off_t>( frame.offset + done )
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count <= 0 )
+            return false;
+
+        done += static_cast<std::size_t>( count );
+    }
+
+
+    if ( codec == Index::Codec::ZSTD ) {
+        thread_local ZstdReader reader;
+
+        if ( reader.context == nullptr )
+            return false;
+
+        const auto size = ZSTD_decompressDCtx( reader.context,
+            out.data()  , out.size(),
+            input.data(), input.size()
+        );
+
+        return not ZSTD_isError( size ) and size == out.size();
+    }
+
+
+    thread_local GzipReader reader;
+
+    if ( not reader.reset() )
+        return false;
+
+    auto &stream = reader.stream;
+
+    stream.next_in   = reinterpret_cast<Bytef*>( input.data() );
+    stream.avail_in  = static_cast<uInt>( input.size() );
+    stream.next_out  = reinterpret_cast<Bytef*>( out.data() );
+    stream.avail_out = static_cast<uInt>( out.size() );
+
+    /* The CRC32 and ISIZE of the member are checked by inflate itself */
+    return inflate( &stream, Z_FINISH ) == Z_STREAM_END
+       and stream.avail_out == 0
+       and stream.avail_in  == 0;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/index.hpp"
+#include "archive/sink.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+
+namespace utils { class ThreadPool; }
+
+
+namespace archive {
+
+    // ---- SEEKABLE SINK ----
+    //
+    // Cuts its input into FRAME_SIZE pieces and compresses each one as a
+    // complete gzip member or zstd frame on the pool, in the index's
+    // codec. Stock gunzip / zstd read the concatenation as one stream,
+    // while a reader holding the index can start at any frame.
+    //
+    // Frames are recorded in `index` as they are written; finish()
+    // appends the index itself after the last one. Stored stretches get
+    // frames of their own where possible, compressed at the lowest level.
+    //
+    class SeekableSink final : public Sink {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        SeekableSink( Sink &_next,
+                      Index &_index,
+                      int _level,
+                      utils::ThreadPool &_pool );
+        ~SeekableSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        SeekableSink( const SeekableSink& ) = delete;
+        SeekableSink& operator=( const SeekableSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+        // +
+        bool set_stored( bool _stored ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+    private:
+        // ---- FRAME LAYOUT ----
+        //
+        static constexpr std::size_t FRAME_SIZE   = 2 * 1024 * 1024;
+        static constexpr std::size_t MIN_CUT_SIZE =      64 * 1024;
+        // +
+        /* Room for incompressible frames, which grow a little */
+        static_assert( 2 * FRAME_SIZE <= Index::MAX_FRAME_SIZE );
+
+
+        // ---- COMPRESSION JOB ----
+        //
+        struct Frame {
+            std::vector<std::byte> input;
+            std::vector<std::byte> output;
+            // +
+            std::uint64_t raw_offset = 0;
+            std::size_t   stored_in  = 0;    /* input bytes hinted stored */
+            bool          stored     = false;
+            bool          ok         = true;
+            // +
+            std::future<void> done;
+        };
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        Sink              &next;
+        Index             &index;
+        int                level;
+        utils::ThreadPool &pool;
+
+
+        // ---- STREAM STATE ----
+        //
+        std::unique_ptr<Frame>             current;
+        std::deque<std::unique_ptr<Frame>> pending;
+        // +
+        std::uint64_t raw_offset = 0;    /* tar bytes taken so far     */
+        std::uint64_t offset     = 0;    /* compressed bytes written   */
+        bool          stored     = false;
+
+
+        // ---- ERROR STATE ----
+        //
+        bool _has_errors = false;
+
+
+        // ---- FRAME HANDLING ----
+        //
+        void submit_frame ( void );
+        bool collect_frame( void );
+        bool drain        ( std::size_t limit );
+        // +
+        static void compress_frame( Frame &frame, Index::Codec codec, int level );
+    };
+
+
+    // ---- FRAME READING ----
+    //
+    /* Reads `frame` of the archive open at `fd` and decompresses it into
+     * `out` (resized to raw_size). False on I/O errors or corrupt data. */
+    [[nodiscard]]
+    bool read_frame( int fd,
+                     Index::Codec codec,
+                     const Index::Frame &frame,
+                     std::vector<std::byte> &out );
+}
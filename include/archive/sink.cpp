@@ -0,0 +1,204 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/sink.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/* ---------------------- FILESINK:: IMPLEMENTATION ----------------------- */
+
+archive::FileSink::FileSink( const std::filesystem::path &_filepath )
+  : filepath { _filepath },
+    fd       { ::open( _filepath.c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644 ) }
+{
+    if ( fd >= 0 ) {
+        buffer.resize( BUFFER_SIZE );
+        return;
+    }
+
+    _has_errors = true;
+
+    fmt::println( stderr, "File \"{}\"",
+        std::filesystem::absolute( _filepath ).string()
+    );
+
+    fmt::println( stderr, "Error: {}", std::strerror( errno ));
+}
+
+
+archive::FileSink::~FileSink() {
+    if ( fd >= 0 )
+        ::close( fd );
+}
+
+
+bool archive::FileSink::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+std::size_t archive::FileSink::get_written( void ) const {
+    return written;
+}
+
+
+bool archive::FileSink::write_all( const std::byte *data, std::size_t size ) {
+    while ( size > 0 ) {
+        const auto count = ::write( fd, data, size );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count <= 0 ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: writing '{}': {}",
+                filepath.string(),
+                std::strerror( errno )
+            );
+
+            _has_errors = true;
+            return false;
+        }
+
+        data    += count;
+        size    -= static_cast<std::size_t>( count );
+        written += static_cast<std::size_t>( count );
+    }
+
+    return true;
+}
+
+
+bool archive::FileSink::flush_buffer( void ) {
+    const auto len = buffer_len;
+    buffer_len = 0;
+
+    return write_all( buffer.data(), len );
+}
+
+
+bool archive::FileSink::write( std::span<const std::byte> data ) {
+    if ( _has_errors )
+        return false;
+
+    /* Large chunks bypass the buffer instead of being copied twice */
+    if ( data.size() >= BUFFER_SIZE ) {
+        return flush_buffer() and write_all( data.data(), data.size() );
+    }
+
+    if ( buffer_len + data.size() > BUFFER_SIZE and not flush_buffer() )
+        return false;
+
+    std::memcpy( buffer.data() + buffer_len, data.data(), data.size() );
+    buffer_len += data.size();
+
+    return true;
+}
+
+
+bool archive::FileSink::finish( void ) {
+    if ( _has_errors or not flush_buffer() )
+        return false;
+
+    if ( ::close( std::exchange( fd, -1 )) != 0 ) {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: closing '{}': {}",
+            filepath.string(),
+            std::strerror( errno )
+        );
+
+        _has_errors = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+/* ---------------------- ASYNCSINK:: IMPLEMENTATION ---------------------- */
+
+archive::AsyncSink::AsyncSink( Sink &_next, std::size_t _budget )
+  : next   { _next   },
+    budget { _budget },
+    writer { [this] { run(); } }
+{
+    pending.reserve( CHUNK_SIZE );
+}
+
+
+archive::AsyncSink::~AsyncSink() {
+    /* Not finished: the writer thread still drains and stops */
+    if ( writer.joinable() ) {
+        queue.close();
+        writer.join();
+    }
+}
+
+
+bool archive::AsyncSink::has_errors( void ) const {
+    /* `next` belongs to the writer thread until finish() */
+    return failed;
+}
+
+
+void archive::AsyncSink::run( void ) {
+    std::vector<std::byte> chunk;
+
+    /* After a failure the rest is dropped, the producer must not block */
+    while ( queue.pop( chunk )) {
+        if ( not failed and not next.write( chunk ))
+            failed = true;
+
+        budget.release( chunk.size() );
+    }
+}
+
+
+bool archive::AsyncSink::hand_over( void ) {
+    if ( pending.empty() )
+        return true;
+
+    budget.acquire( pending.size() );
+
+    auto chunk = std::exchange( pending, {} );
+    pending.reserve( CHUNK_SIZE );
+
+    return queue.push( std::move( chunk )) and not failed;
+}
+
+
+bool archive::AsyncSink::write( std::span<const std::byte> data ) {
+    if ( failed )
+        return false;
+
+    pending.insert( pending.end(), data.begin(), data.end() );
+
+    return pending.size() < CHUNK_SIZE or hand_over();
+}
+
+
+bool archive::AsyncSink::finish( void ) {
+    const bool handed = hand_over();
+
+    queue.close();
+    writer.join();
+
+    /* Only now `next` belongs to this thread again */
+    return handed and not failed and next.finish();
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/memory_budget.hpp"
+#include "utilities/spsc_queue.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+namespace archive {
+
+    // ---- BYTE SINK ----
+    //
+    // Every stage of the archive engine (tar, compressors, file) writes
+    // into the next one through this interface.
+    //
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+
+        [[nodiscard]]
+        virtual bool write ( std::span<const std::byte> data ) = 0;
+        [[nodiscard]]
+        virtual bool finish( void ) = 0;
+        // +
+        [[nodiscard]]
+        virtual bool has_errors( void ) const = 0;
+        // +
+        /* Hint: what is written while set is not worth compressing.
+         * Stages that cannot act on it just ignore it. */
+        [[nodiscard]]
+        virtual bool set_stored( bool ) { return true; }
+    };
+
+
+    // ---- FILE SINK ----
+    //
+    class FileSink final : public Sink {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit FileSink( const std::filesystem::path &_filepath );
+        ~FileSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        FileSink( const FileSink& ) = delete;
+        FileSink& operator=( const FileSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+        // ---- GETTERS ----
+        //
+        [[nodiscard]]
+        std::size_t get_written( void ) const;
+
+
+    private:
+        // ---- FILE STATE ----
+        //
+        std::filesystem::path filepath;
+        int         fd      = -1;
+        std::size_t written =  0;
+
+
+        // ---- BUFFER STATE ----
+        //
+        static constexpr std::size_t BUFFER_SIZE = 256 * 1024;
+        std::vector<std::byte> buffer;
+        // +
+        std::size_t buffer_len = 0;
+
+
+        // ---- ERROR STATE ----
+        //
+        bool _has_errors = false;
+
+
+        // ---- BUFFER HANDLING ----
+        //
+        bool flush_buffer( void );
+        bool write_all   ( const std::byte *data, std::size_t size );
+    };
+
+
+    // ---- ASYNC SINK ----
+    //
+    // Write stage of the writer: hands everything over to a thread that
+    // feeds `next`, so compression never waits on the disk. Writes are
+    // gathered into chunks charged to a memory budget; once it is used
+    // up, write() blocks until the thread has flushed some (backpressure).
+    //
+    // A single producer thread, as every sink.
+    //
+    class AsyncSink final : public Sink {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        AsyncSink( Sink &_next, std::size_t _budget );
+        ~AsyncSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        AsyncSink( const AsyncSink& ) = delete;
+        AsyncSink& operator=( const AsyncSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+    private:
+        // ---- QUEUE LAYOUT ----
+        //
+        static constexpr std::size_t CHUNK_SIZE = 1024 * 1024;
+        static constexpr std::size_t SLOTS      = 64;
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        Sink &next;
+        // +
+        utils::MemoryBudget                       budget;
+        utils::SpscQueue<std::vector<std::byte>>  queue { SLOTS };
+        std::vector<std::byte>                    pending;
+
+
+        // ---- ERROR STATE ----
+        //
+        std::atomic<bool> failed { false };    /* set by the writer thread */
+
+
+        // ---- WRITER THREAD ----
+        //
+        std::thread writer;
+        // +
+        bool hand_over( void );
+        void run      ( void );
+    };
+}
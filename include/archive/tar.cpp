@@ -0,0 +1,448 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/tar.hpp"
+#include "utilities/hash.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace {
+
+    // ---- USTAR FIELD OFFSETS ----
+    //
+    namespace field {
+        constexpr std::size_t NAME     =   0;
+        constexpr std::size_t MODE     = 100;
+        constexpr std::size_t UID      = 108;
+        constexpr std::size_t GID      = 116;
+        constexpr std::size_t SIZE     = 124;
+        constexpr std::size_t MTIME    = 136;
+        constexpr std::size_t CHKSUM   = 148;
+        constexpr std::size_t TYPEFLAG = 156;
+        constexpr std::size_t LINKNAME = 157;
+        constexpr std::size_t MAGIC    = 257;
+        constexpr std::size_t VERSION  = 263;
+        constexpr std::size_t PREFIX   = 345;
+    }
+
+
+    /* GNU tar name for records carrying an overlong path */
+    constexpr std::string_view LONG_LINK_NAME = "././@LongLink";
+}
+
+
+void archive::TarWriter::put_string( char *field,
+                                     std::size_t width,
+                                     std::string_view value
+) {
+    std::memcpy( field, value.data(), std::min( width, value.size() ));
+}
+
+
+void archive::TarWriter::put_number( char *field,
+                                     std::size_t width,
+                                     std::uint64_t value
+) {
+    /* Octal with a trailing NUL, if the value fits in width-1 digits */
+    if ( value < ( std::uint64_t(1) << ( 3 * ( width - 1 )))) {
+        field[ width - 1 ] = '\0';
+
+        for ( std::size_t i = width - 1; i --> 0; ) {
+            field[i] = static_cast<char>( '0' + ( value & 7 ));
+            value  >>= 3;
+        }
+
+        return;
+    }
+
+    /* GNU base-256 extension: high bit set, big-endian binary */
+    for ( std::size_t i = width; i --> 1; ) {
+        field[i] = static_cast<char>( value & 0xff );
+        value  >>= 8;
+    }
+
+    field[0] = static_cast<char>( 0x80 );
+}
+
+
+bool archive::TarWriter::split_name( std::string_view  name,
+                                     std::string_view &prefix,
+                                     std::string_view &base
+) {
+    if ( name.size() <= 100 ) {
+        prefix = {};
+        base   = name;
+        return true;
+    }
+
+    /* ustar can store up to 155 + '/' + 100 characters split on a slash */
+    for ( auto pos = name.find( '/' );
+          pos != std::string_view::npos and pos <= 155;
+          pos = name.find( '/', pos + 1 )
+    ) {
+        if ( name.size() - pos - 1 <= 100 and pos + 1 < name.size() ) {
+            prefix = name.substr( 0, pos );
+            base   = name.substr( pos + 1 );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool archive::TarWriter::emit( std::span<const std::byte> data ) {
+    offset += data.size();
+    return next.write( data );
+}
+
+
+void archive::TarWriter::record_member( std::uint64_t hash ) {
+    file_hash = hash;
+
+    if ( index == nullptr )
+        return;
+
+    member.hash = hash;
+    index->add_member( std::move( member ));
+}
+
+
+bool archive::TarWriter::write_block( const header_t &block ) {
+    return emit( std::as_bytes( std::span( block )));
+}
+
+
+bool archive::TarWriter::write_padding( std::uint64_t size ) {
+    static constexpr header_t zeros {};
+
+    const auto remainder = size % TAR_BLOCK_SIZE;
+
+    if ( remainder == 0 )
+        return true;
+
+    return emit(
+        std::as_bytes( std::span( zeros )).first( TAR_BLOCK_SIZE - remainder )
+    );
+}
+
+
+bool archive::TarWriter::write_long_name( char typeflag,
+                                          std::string_view value
+) {
+    struct stat info {};
+    header_t header {};
+
+    info.st_mode = 0644;
+
+    put_string( &header[ field::NAME ], 100, LONG_LINK_NAME );
+    put_number( &header[ field::MODE ],   8, info.st_mode   );
+    put_number( &header[ field::UID  ],   8, 0 );
+    put_number( &header[ field::GID  ],   8, 0 );
+    put_number( &header[ field::SIZE ],  12, value.size() + 1 );
+    put_number( &header[ field::MTIME],  12, 0 );
+
+    header[ field::TYPEFLAG ] = typeflag;
+
+    /* GNU records use the old "ustar  " magic */
+    put_string( &header[ field::MAGIC ], 8, "ustar  " );
+
+    std::memset( &header[ field::CHKSUM ], ' ', 8 );
+
+    unsigned checksum = 0;
+    for ( const char c : header )
+        checksum += static_cast<unsigned char>( c );
+
+    put_number( &header[ field::CHKSUM ], 7, checksum );
+
+    const auto bytes = std::as_bytes( std::span( value ));
+    static constexpr std::byte terminator { 0 };
+
+    return write_block( header )
+       and emit( bytes )
+       and emit({ &terminator, 1 })
+       and write_padding( value.size() + 1 );
+}
+
+
+bool archive::TarWriter::write_header( std::string_view name,
+                                       char typeflag,
+                                       const struct stat &info,
+                                       std::uint64_t size,
+                                       std::string_view linkname
+) {
+    const auto header_offset = offset;
+
+    /* The link target has no prefix field: anything longer goes in a
+     * GNU 'K' record, ahead of the entry it belongs to */
+    if ( linkname.size() > 100 and not write_long_name( 'K', linkname ))
+        return false;
+
+    std::string_view prefix, base;
+
+    if ( not split_name( name, prefix, base )) {
+        if ( not write_long_name( 'L', name ))
+            return false;
+
+        /* The real header keeps a truncated copy for old readers */
+        prefix = {};
+        base   = name.substr( 0, 100 );
+    }
+
+    header_t header {};
+
+    put_string( &header[ field::NAME    ], 100, base );
+    put_number( &header[ field::MODE    ],   8, info.st_mode & 07777 );
+    put_number( &header[ field::UID     ],   8, info.st_uid );
+    put_number( &header[ field::GID     ],   8, info.st_gid );
+    put_number( &header[ field::SIZE    ],  12, size );
+    put_number( &header[ field::MTIME   ],  12,
+        static_cast<std::uint64_t>( std::max<time_t>( info.st_mtime, 0 ))
+    );
+
+    header[ field::TYPEFLAG ] = typeflag;
+
+    put_string( &header[ field::LINKNAME], 100, linkname );
+    put_string( &header[ field::MAGIC   ],   6, "ustar" );
+    put_string( &header[ field::VERSION ],   2, "00" );
+    put_string( &header[ field::PREFIX  ], 155, prefix );
+
+    /* The checksum is computed with its own field filled with spaces */
+    std::memset( &header[ field::CHKSUM ], ' ', 8 );
+
+    unsigned checksum = 0;
+    for ( const char c : header )
+        checksum += static_cast<unsigned char>( c );
+
+    put_number( &header[ field::CHKSUM ], 7, checksum );
+
+    entries++;
+
+    if ( not write_block( header ))
+        return false;
+
+    if ( index != nullptr ) {
+        while ( name.ends_with( '/' ))
+            name.remove_suffix( 1 );
+
+        member = Index::Member {
+            .name   = std::string( name ),
+            .link   = std::string( linkname ),
+            .type   = typeflag,
+            .mode   = static_cast<std::uint32_t>( info.st_mode & 07777 ),
+            .mtime  = info.st_mtim.tv_sec,
+            .header = header_offset,
+            .data   = offset,
+            .size   = size
+        };
+    }
+
+    return true;
+}
+
+
+archive::TarWriter::Errors archive::TarWriter::add_directory(
+    std::string_view name,
+    const struct stat &info
+) {
+    std::string dirname { name };
+
+    if ( dirname.empty() or dirname.back() != '/' )
+        dirname.push_back( '/' );
+
+    if ( not write_header( dirname, '5', info, 0 ))
+        return Errors::WRITE_FAILED;
+
+    record_member( 0 );
+    return Errors::NONE;
+}
+
+
+archive::TarWriter::Errors archive::TarWriter::add_file(
+    std::string_view name,
+    const std::filesystem::path &source
+) {
+    const int fd = ::open( source.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        read_error = errno;
+        return Errors::OPEN_FAILED;
+    }
+
+    struct stat info {};
+
+    Errors result = Errors::READ_FAILED;
+
+    if ( ::fstat( fd, &info ) == 0 )
+        result = add_file( name, fd, info );
+    else
+        read_error = errno;
+
+    ::close( fd );
+    return result;
+}
+
+
+archive::TarWriter::Errors archive::TarWriter::add_file(
+    std::string_view name,
+    int fd,
+    const struct stat &info
+) {
+    const auto size = static_cast<std::uint64_t>( info.st_size );
+
+    if ( buffer.empty() )
+        buffer.resize( BUFFER_SIZE );
+
+    if ( not write_header( name, '0', info, size ))
+        return Errors::WRITE_FAILED;
+
+
+    std::uint64_t remaining = size;
+    Errors        result    = Errors::NONE;
+    utils::Xxh64  hasher;
+
+    read_error = 0;
+
+    while ( remaining > 0 ) {
+        const auto want  = std::min<std::uint64_t>( remaining, buffer.size() );
+        const auto count = ::read( fd, buffer.data(), want );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        /* The file shrank while reading: keep the stream consistent */
+        if ( count <= 0 ) {
+            read_error = count < 0 ? errno : 0;
+            result     = Errors::READ_FAILED;
+            break;
+        }
+
+        const std::span<const std::byte> chunk {
+            buffer.data(), std::size_t( count )
+        };
+
+        if ( not emit( chunk ))
+            return Errors::WRITE_FAILED;
+
+        hasher.update( chunk );
+
+        remaining -= static_cast<std::uint64_t>( count );
+    }
+
+
+    /* Fill whatever could not be read, the header already promised it */
+    if ( remaining > 0 ) {
+        std::fill( buffer.begin(), buffer.end(), std::byte{ 0 } );
+
+        while ( remaining > 0 ) {
+            const auto chunk = std::min<std::uint64_t>(
+                remaining,
+                buffer.size()
+            );
+
+            const std::span<const std::byte> zeros {
+                buffer.data(), std::size_t( chunk )
+            };
+
+            if ( not emit( zeros ))
+                return Errors::WRITE_FAILED;
+
+            hasher.update( zeros );
+
+            remaining -= chunk;
+        }
+    }
+
+
+    if ( not write_padding( size ))
+        return Errors::WRITE_FAILED;
+
+    record_member( hasher.digest() );
+
+    bytes_in += size;
+    return result;
+}
+
+
+archive::TarWriter::Errors archive::TarWriter::add_file(
+    std::string_view name,
+    const struct stat &info,
+    std::span<const std::byte> contents
+) {
+    if ( not write_header( name, '0', info, contents.size() )
+      or not emit( contents )
+      or not write_padding( contents.size() ))
+        return Errors::WRITE_FAILED;
+
+    utils::Xxh64 hasher;
+    hasher.update( contents );
+    record_member( hasher.digest() );
+
+    bytes_in += contents.size();
+    return Errors::NONE;
+}
+
+
+archive::TarWriter::Errors archive::TarWriter::add_hardlink(
+    std::string_view name,
+    std::string_view target,
+    const struct stat &info
+) {
+    if ( not write_header( name, '1', info, 0, target ))
+        return Errors::WRITE_FAILED;
+
+    record_member( 0 );
+    return Errors::NONE;
+}
+
+
+bool archive::TarWriter::finish( void ) {
+    static constexpr header_t zeros {};
+
+    /* End of archive: two zero blocks */
+    return write_block( zeros )
+       and write_block( zeros )
+       and next.finish();
+}
+
+
+std::size_t archive::TarWriter::get_entries( void ) const {
+    return entries;
+}
+
+
+std::size_t archive::TarWriter::get_bytes_in( void ) const {
+    return bytes_in;
+}
+
+
+int archive::TarWriter::get_read_error( void ) const {
+    return read_error;
+}
+
+
+std::uint64_t archive::TarWriter::get_file_hash( void ) const {
+    return file_hash;
+}
+
+
+archive::TarWriter::TarWriter( Sink &_next, Index *_index )
+  : next  { _next  },
+    index { _index }
+{}
@@ -0,0 +1,163 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/index.hpp"
+#include "archive/sink.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <sys/stat.h>
+
+
+namespace archive {
+
+    // ---- TAR WRITER ----
+    //
+    // Emits a POSIX ustar stream (with GNU long name/link records when a
+    // path does not fit) into `next`. File contents are streamed through one
+    // fixed-size buffer, whole files are never held in memory.
+    //
+    // File contents are hashed (xxh64) on their way through. Given an
+    // index, every member is recorded there with its offsets in the
+    // stream and that hash.
+    //
+    class TarWriter {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit TarWriter( Sink &_next, Index *_index = nullptr );
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        TarWriter( const TarWriter& ) = delete;
+        TarWriter& operator=( const TarWriter& ) = delete;
+
+
+        // ---- ERRORS TYPES ----
+        //
+        enum class Errors : std::uint8_t {
+            NONE,
+            OPEN_FAILED,
+            READ_FAILED,
+            WRITE_FAILED
+        };
+
+
+        // ---- ENTRY METHODS ----
+        //
+        Errors add_directory( std::string_view name,
+                              const struct stat &info );
+        // +
+        Errors add_file     ( std::string_view name,
+                              const std::filesystem::path &source );
+        // +
+        Errors add_file     ( std::string_view name,
+                              int fd,
+                              const struct stat &info );
+        // +
+        Errors add_file     ( std::string_view name,
+                              const struct stat &info,
+                              std::span<const std::byte> contents );
+        // +
+        /* Same contents as `target`, an earlier member: no data stored */
+        Errors add_hardlink ( std::string_view name,
+                              std::string_view target,
+                              const struct stat &info );
+
+
+        // ---- FINALIZATION ----
+        //
+        [[nodiscard]]
+        bool finish( void );
+
+
+        // ---- GETTERS ----
+        //
+        [[nodiscard]]
+        std::size_t get_entries( void ) const;
+        // +
+        [[nodiscard]]
+        std::size_t get_bytes_in( void ) const;
+        // +
+        /* errno behind the last OPEN/READ_FAILED, 0 if the file shrank */
+        [[nodiscard]]
+        int get_read_error( void ) const;
+        // +
+        /* xxh64 of the last file's contents, 0 for other members */
+        [[nodiscard]]
+        std::uint64_t get_file_hash( void ) const;
+
+
+    private:
+        // ---- BLOCK LAYOUT ----
+        //
+        static constexpr std::size_t TAR_BLOCK_SIZE = 512;
+        static constexpr std::size_t BUFFER_SIZE    = 256 * 1024;
+        // +
+        using header_t = std::array<char, TAR_BLOCK_SIZE>;
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        Sink  &next;
+        Index *index;
+        std::vector<std::byte> buffer;
+        // +
+        std::uint64_t offset = 0;    /* bytes emitted so far */
+        Index::Member member;        /* being written, for `index` */
+
+
+        // ---- STATISTICS ----
+        //
+        std::size_t entries  = 0;
+        std::size_t bytes_in = 0;
+        // +
+        int           read_error = 0;
+        std::uint64_t file_hash  = 0;
+
+
+        // ---- HEADER HELPERS ----
+        //
+        static void put_string( char *field, std::size_t width,
+                                std::string_view value );
+        // +
+        static void put_number( char *field, std::size_t width,
+                                std::uint64_t value );
+        // +
+        static bool split_name( std::string_view name,
+                                std::string_view &prefix,
+                                std::string_view &base );
+
+
+        // ---- OUTPUT HELPERS ----
+        //
+        bool write_header   ( std::string_view name,
+                              char typeflag,
+                              const struct stat &info,
+                              std::uint64_t size,
+                              std::string_view linkname = {} );
+        // +
+        bool write_long_name( char typeflag, std::string_view value );
+        // +
+        bool write_padding  ( std::uint64_t size );
+        // +
+        bool write_block    ( const header_t &block );
+        // +
+        bool emit           ( std::span<const std::byte> data );
+        // +
+        void record_member  ( std::uint64_t hash );
+    };
+}
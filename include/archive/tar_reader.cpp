@@ -0,0 +1,410 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/tar_reader.hpp"
+#include "archive/zstd.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <zlib.h>
+#include <zstd.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    constexpr std::size_t TAR_BLOCK_SIZE = 512;
+    constexpr std::size_t READ_SIZE      = 256 * 1024;
+
+    /* GNU long names/links longer than this are not paths */
+    constexpr std::uint64_t MAX_LONG_NAME = 1024 * 1024;
+
+
+    using header_t = std::array<char, TAR_BLOCK_SIZE>;
+
+
+    /* Octal, or GNU base-256 when the high bit of the first byte is set */
+    std::uint64_t parse_number( const char *field, std::size_t width ) {
+        std::uint64_t value = 0;
+
+        if ( static_cast<unsigned char>( field[0] ) & 0x80 ) {
+            for ( std::size_t i = 1; i < width; i++ )
+                value = ( value << 8 ) | static_cast<unsigned char>( field[i] );
+
+            return value;
+        }
+
+        for ( std::size_t i = 0; i < width; i++ ) {
+            if ( field[i] >= '0' and field[i] <= '7' )
+                value = ( value << 3 ) | std::uint64_t( field[i] - '0' );
+
+            else if ( field[i] != ' ' or value != 0 )
+                break;
+        }
+
+        return value;
+    }
+
+
+    std::string_view parse_string( const char *field, std::size_t width ) {
+        return { field, ::strnlen( field, width ) };
+    }
+
+
+    bool valid_checksum( const header_t &header ) {
+        unsigned sum = 0;
+
+        for ( std::size_t i = 0; i < header.size(); i++ ) {
+            sum += ( i >= 148 and i < 156 )
+                ? unsigned( ' ' )
+                : static_cast<unsigned char>( header[i] );
+        }
+
+        return sum == parse_number( &header[148], 8 );
+    }
+
+
+    std::uint64_t padding_of( std::uint64_t size ) {
+        return ( TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE ) % TAR_BLOCK_SIZE;
+    }
+
+
+    /* Links, devices, fifos and directories store no contents */
+    bool has_contents( char type ) {
+        return std::string_view( "123456" ).find( type ) == std::string_view::npos;
+    }
+}
+
+
+/* --------------- TARREADER::DECOMPRESSOR:: IMPLEMENTATION --------------- */
+
+class archive::TarReader::Decompressor {
+public:
+    explicit Decompressor( int _fd )
+      : fd    { _fd },
+        input ( READ_SIZE )
+    {
+        (void)fill();
+
+        const std::span head { input.data(), length };
+
+        if ( head.size() >= 2 and head[0] == std::byte{ 0x1f }
+                              and head[1] == std::byte{ 0x8b } )
+        {
+            kind = Kind::GZIP;
+
+            if ( inflateInit2( &gzip, 15 + 16 ) != Z_OK )
+                error = Errors::CORRUPT_DATA;
+
+        } else if ( head.size() >= 4 and head[0] == std::byte{ 0x28 }
+                                     and head[1] == std::byte{ 0xb5 }
+                                     and head[2] == std::byte{ 0x2f }
+                                     and head[3] == std::byte{ 0xfd } )
+        {
+            kind = Kind::ZSTD;
+            zstd = create_zstd_reader();
+
+            if ( zstd == nullptr )
+                error = Errors::CORRUPT_DATA;
+        }
+    }
+
+    ~Decompressor() {
+        if ( kind == Kind::GZIP ) inflateEnd( &gzip );
+        if ( kind == Kind::ZSTD ) ZSTD_freeDCtx( zstd );
+    }
+
+    Decompressor( const Decompressor& ) = delete;
+    Decompressor& operator=( const Decompressor& ) = delete;
+
+
+    /* All of `size` or false: end of the data (TRUNCATED) or an error */
+    bool read( std::byte *out, std::size_t size ) {
+        while ( size > 0 ) {
+            const auto count = read_some( out, size );
+
+            if ( count == 0 ) {
+                if ( error == Errors::NONE )
+                    error = Errors::TRUNCATED;
+                return false;
+            }
+
+            out  += count;
+            size -= count;
+        }
+
+        return true;
+    }
+
+    /* Reads past the tar end so the trailing checksums get verified */
+    void drain( void ) {
+        std::array<std::byte, 16 * 1024> sink;
+
+        while ( read_some( sink.data(), sink.size() ) > 0 ) {}
+    }
+
+    [[nodiscard]]
+    Errors get_error( void ) const {
+        return error;
+    }
+
+private:
+    enum class Kind : std::uint8_t { PLAIN, GZIP, ZSTD };
+
+    int                    fd;
+    std::vector<std::byte> input;
+    std::size_t            offset = 0;
+    std::size_t            length = 0;
+    // +
+    Kind       kind  = Kind::PLAIN;
+    z_stream   gzip  {};
+    ZSTD_DCtx *zstd  = nullptr;
+    Errors     error = Errors::NONE;
+
+
+    /* Refills the input buffer once it is used up, false at EOF */
+    bool fill( void ) {
+        if ( offset < length )
+            return true;
+
+        while ( true ) {
+            const auto count = ::read( fd, input.data(), input.size() );
+
+            if ( count < 0 and errno == EINTR )
+                continue;
+
+            if ( count < 0 )
+                error = Errors::READ_FAILED;
+
+            offset = 0;
+            length = count > 0 ? static_cast<std::size_t>( count ) : 0;
+
+            return length > 0;
+        }
+    }
+
+    std::size_t read_some( std::byte *out, std::size_t size ) {
+        while ( error == Errors::NONE and fill() ) {
+            const auto *in    = input.data() + offset;
+            const auto  avail = length - offset;
+
+            if ( kind == Kind::PLAIN ) {
+                const auto count = std::min( avail, size );
+
+                std::memcpy( out, in, count );
+                offset += count;
+
+                return count;
+            }
+
+            if ( kind == Kind::ZSTD ) {
+                ZSTD_inBuffer  source { in , avail, 0 };
+                ZSTD_outBuffer target { out, size , 0 };
+
+                if ( ZSTD_isError( ZSTD_decompressStream( zstd, &target, &source ))) {
+                    error = Errors::CORRUPT_DATA;
+                    return 0;
+                }
+
+                offset += source.pos;
+
+                if ( target.pos > 0 )
+                    return target.pos;
+
+                continue;
+            }
+
+
+            const auto window = std::min<std::size_t>( size, READ_SIZE );
+
+            gzip.next_in   = reinterpret_cast<Bytef*>( const_cast<std::byte*>( in ));
+            gzip.avail_in  = static_cast<uInt>( avail );
+            gzip.next_out  = reinterpret_cast<Bytef*>( out );
+            gzip.avail_out = static_cast<uInt>( window );
+
+            const int status = inflate( &gzip, Z_NO_FLUSH );
+
+            if ( status != Z_OK and status != Z_STREAM_END
+                 and status != Z_BUF_ERROR )
+            {
+                error = Errors::CORRUPT_DATA;
+                return 0;
+            }
+
+            offset += avail - gzip.avail_in;
+
+            /* Concatenated members: the next one starts right after */
+            if ( status == Z_STREAM_END and inflateReset( &gzip ) != Z_OK ) {
+                error = Errors::CORRUPT_DATA;
+                return 0;
+            }
+
+            if ( window > gzip.avail_out )
+                return window - gzip.avail_out;
+        }
+
+        return 0;
+    }
+};
+
+
+/* ---------------------- TARREADER:: IMPLEMENTATION ---------------------- */
+
+archive::TarReader::TarReader( int _fd )
+  : source { std::make_unique<Decompressor>( _fd ) },
+    curr_error { source->get_error() }
+{}
+
+
+archive::TarReader::~TarReader() = default;
+
+
+bool archive::TarReader::next( Index::Member &member ) {
+    if ( has_errors() or not skip( remaining + padding ))
+        return false;
+
+    remaining = padding = 0;
+
+
+    std::string long_name, long_link;
+    const auto  start = offset;
+    header_t    header;
+
+    while ( true ) {
+        if ( not consume( reinterpret_cast<std::byte *>( header.data() ),
+                          header.size() ))
+            return false;
+
+        if ( std::all_of( header.begin(), header.end(),
+                          []( char c ) { return c == '\0'; } ))
+        {
+            source->drain();
+
+            if ( source->get_error() != Errors::NONE )
+                curr_error = source->get_error();
+
+            return false;
+        }
+
+        if ( not valid_checksum( header )) {
+            curr_error = Errors::BAD_HEADER;
+            return false;
+        }
+
+        const auto type = header[156];
+        const auto size = parse_number( &header[124], 12 );
+
+        if ( type != 'L' and type != 'K' )
+            break;
+
+
+        /* GNU long name/link: the value is the data of this record */
+        if ( size > MAX_LONG_NAME ) {
+            curr_error = Errors::BAD_HEADER;
+            return false;
+        }
+
+        std::string value ( size, '\0' );
+
+        if ( not consume( reinterpret_cast<std::byte *>( value.data() ), size )
+             or not skip( padding_of( size )))
+            return false;
+
+        value.resize( ::strnlen( value.data(), value.size() ));
+        ( type == 'L' ? long_name : long_link ) = std::move( value );
+    }
+
+
+    if ( not long_name.empty() ) {
+        member.name = std::move( long_name );
+    } else {
+        const auto prefix = parse_string( &header[345], 155 );
+        const auto name   = parse_string( &header[0]  , 100 );
+
+        member.name = prefix.empty()
+            ? std::string( name )
+            : std::string( prefix ) + '/' + std::string( name );
+    }
+
+    member.link = long_link.empty()
+        ? std::string( parse_string( &header[157], 100 ))
+        : std::move( long_link );
+
+    while ( member.name.ends_with( '/' ))
+        member.name.pop_back();
+
+    const auto type = header[156];
+    const auto size = has_contents( type ) ? parse_number( &header[124], 12 ) : 0;
+
+    member.type   = type;
+    member.mode   = static_cast<std::uint32_t>( parse_number( &header[100], 8 ) & 07777 );
+    member.mtime  = static_cast<std::int64_t >( parse_number( &header[136], 12 ));
+    member.header = start;
+    member.data   = offset;
+    member.size   = size;
+    member.hash   = 0;
+
+    remaining = size;
+    padding   = padding_of( size );
+
+    return true;
+}
+
+
+bool archive::TarReader::read( std::byte *out, std::size_t size ) {
+    if ( size > remaining ) {
+        curr_error = Errors::TRUNCATED;
+        return false;
+    }
+
+    if ( not consume( out, size ))
+        return false;
+
+    remaining -= size;
+    return true;
+}
+
+
+bool archive::TarReader::consume( std::byte *out, std::size_t size ) {
+    if ( not source->read( out, size )) {
+        curr_error = source->get_error();
+        return false;
+    }
+
+    offset += size;
+    return true;
+}
+
+
+bool archive::TarReader::skip( std::uint64_t size ) {
+    std::array<std::byte, 16 * 1024> sink;
+
+    while ( size > 0 ) {
+        const auto chunk = std::min<std::uint64_t>( size, sink.size() );
+
+        if ( not consume( sink.data(), chunk ))
+            return false;
+
+        size -= chunk;
+    }
+
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/index.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace archive {
+
+    // ---- TAR READER ----
+    //
+    // Reads a tar stream back from `fd`, plain or compressed with gzip
+    // (any number of members) or zstd (any number of frames, skippable
+    // ones included), told apart by its first bytes.
+    //
+    // Members come out one at a time: next() parses a header (GNU long
+    // names and links included), then its contents may be read() in
+    // order; whatever is left is skipped by the following next(). They
+    // are described with Index records, offsets in the tar stream
+    // included, the hash left at 0.
+    //
+    class TarReader {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit TarReader( int _fd );
+        ~TarReader();
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        TarReader( const TarReader& ) = delete;
+        TarReader& operator=( const TarReader& ) = delete;
+
+
+        // ---- ERRORS TYPES ----
+        //
+        enum class Errors : std::uint8_t {
+            NONE,
+            READ_FAILED,
+            CORRUPT_DATA,
+            BAD_HEADER,
+            TRUNCATED
+        };
+
+
+        // ---- MAIN METHODS ----
+        //
+        /* False at the end of the archive or on errors */
+        [[nodiscard]]
+        bool next( Index::Member &member );
+        // +
+        /* Contents of the current member, at most what is left of it */
+        [[nodiscard]]
+        bool read( std::byte *out, std::size_t size );
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const {
+            return curr_error != Errors::NONE;
+        }
+        // +
+        [[nodiscard]]
+        Errors get_error( void ) const {
+            return curr_error;
+        }
+
+
+    private:
+        class Decompressor;
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        std::unique_ptr<Decompressor> source;
+        // +
+        std::uint64_t offset    = 0;    /* in the tar stream          */
+        std::uint64_t remaining = 0;    /* of the current contents    */
+        std::uint64_t padding   = 0;    /* after the current contents */
+
+
+        // ---- ERROR STATE ----
+        //
+        Errors curr_error = Errors::NONE;
+
+
+        // ---- STREAM HELPERS ----
+        //
+        [[nodiscard]]
+        bool consume( std::byte *out, std::size_t size );
+        [[nodiscard]]
+        bool skip   ( std::uint64_t size );
+    };
+}
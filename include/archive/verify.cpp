@@ -0,0 +1,482 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/verify.hpp"
+#include "archive/seekable.hpp"
+#include "archive/tar_reader.hpp"
+#include "utilities/hash.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+    using Member = archive::Index::Member;
+
+
+    constexpr std::size_t READ_SIZE = 256 * 1024;
+
+
+    bool is_regular( char type ) {
+        return type == '0' or type == '\0' or type == '7';
+    }
+
+
+    // ---- EXPECTED HASHES ----
+    //
+    struct Check {
+        enum class State : std::uint8_t {
+            MISSING,
+            MATCHED,
+            FAILED
+        };
+
+        std::string   name;
+        std::uint64_t expected;
+        State         state = State::MISSING;
+    };
+
+
+    /* Lines "<16 hex digits>  <name>" */
+    bool read_checksums( const fs::path &path, std::vector<Check> &checks ) {
+        const std::unique_ptr<std::FILE, decltype( &std::fclose )> file {
+            std::fopen( path.c_str(), "r" ),
+            &std::fclose
+        };
+
+        if ( file == nullptr ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot open '{}': {}",
+                path.string(),
+                std::strerror( errno )
+            );
+            return false;
+        }
+
+
+        std::string line;
+
+        for ( int c = std::fgetc( file.get() ); c != EOF;
+                  c = std::fgetc( file.get() )
+        ) {
+            if ( c != '\n' ) {
+                line.push_back( static_cast<char>( c ));
+                continue;
+            }
+
+            std::uint64_t hash = 0;
+
+            const auto [end, error] = std::from_chars(
+                line.data(), line.data() + line.size(), hash, 16
+            );
+
+            if ( error != std::errc() or end != line.data() + 16
+                 or not std::string_view( end, line.data() + line.size() ).starts_with( "  " ))
+            {
+                fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Malformed line in '{}': {}",
+                    path.string(),
+                    line
+                );
+                return false;
+            }
+
+            checks.push_back({ std::string( end + 2 ), hash });
+            line.clear();
+        }
+
+        return true;
+    }
+
+
+    /* Files of `index` with their hashes, hardlinks given their target's */
+    std::vector<Check> checks_of( const archive::Index &index ) {
+        std::unordered_map<std::string_view, std::uint64_t> hashes;
+        std::vector<Check>                                  checks;
+
+        for ( const auto &member : index.get_members() ) {
+            std::uint64_t hash;
+
+            if ( is_regular( member.type ))
+                hash = member.hash;
+
+            else if ( member.type == '1' and hashes.contains( member.link ))
+                hash = hashes.at( member.link );
+
+            else
+                continue;
+
+            hashes.emplace( member.name, hash );
+            checks.push_back({ member.name, hash });
+        }
+
+        return checks;
+    }
+
+
+    // ---- HASHING ----
+    //
+    // Per regular member of a seekable archive. A frame's task hashes the
+    // members whose contents start in it, reading on into the next frames
+    // for the last one when it runs past the end: only the members that
+    // span frames are hashed serially.
+    //
+    bool hash_indexed( int fd,
+                       const archive::Index &index,
+                       utils::ThreadPool &pool,
+                       std::vector<std::uint64_t> &hashes
+    ) {
+        const auto &members = index.get_members();
+        const auto &frames  = index.get_frames();
+
+        std::atomic<bool> failed { false };
+
+        /* Empty files may sit past the last frame */
+        hashes.assign( members.size(), utils::Xxh64().digest() );
+
+
+        for ( std::size_t f = 0; f < frames.size(); f++ ) {
+            const auto frame_end = frames[f].raw_offset + frames[f].raw_size;
+
+            const auto starts_before = [&members]( std::uint64_t offset ) {
+                return static_cast<std::size_t>( std::partition_point(
+                    members.begin(), members.end(),
+                    [offset]( const Member &member ) { return member.data < offset; }
+                ) - members.begin() );
+            };
+
+            const auto first = starts_before( frames[f].raw_offset );
+            const auto last  = starts_before( frame_end );
+
+            if ( first == last )
+                continue;
+
+            pool.submit( failed, [&, fd, f, first, last] {
+                thread_local std::vector<std::byte> raw;
+
+                auto current = f;
+
+                const auto load = [&] {
+                    if ( archive::read_frame( fd, index.get_codec(), frames[current], raw ))
+                        return true;
+
+                    fmt::println( stderr,
+                        "\x1b[1;31mError\x1b[0m: Corrupt frame at offset {}",
+                        frames[current].offset
+                    );
+                    failed = true;
+                    return false;
+                };
+
+                if ( not load() )
+                    return;
+
+                for ( auto i = first; i < last; i++ ) {
+                    const auto &member = members[i];
+
+                    if ( not is_regular( member.type ))
+                        continue;
+
+                    utils::Xxh64  hash;
+                    std::uint64_t offset = member.data;
+
+                    const auto end = member.data + member.size;
+
+                    while ( offset < end ) {
+                        const auto &held     = frames[current];
+                        const auto  held_end = held.raw_offset + held.raw_size;
+
+                        if ( offset >= held_end ) {
+                            if ( ++current == frames.size() or not load() ) {
+                                failed = true;
+                                return;
+                            }
+                            continue;
+                        }
+
+                        const auto stop = std::min( end, held_end );
+
+                        hash.update({ raw.data() + ( offset - held.raw_offset ),
+                                      stop - offset });
+                        offset = stop;
+                    }
+
+                    hashes[i] = hash.digest();
+                }
+            });
+        }
+
+        pool.wait_idle();
+        return not failed;
+    }
+
+
+    /* Decompression is the bottleneck here, hashing keeps up inline */
+    bool hash_stream( int fd,
+                      std::unordered_map<std::string, std::uint64_t> &hashes
+    ) {
+        archive::TarReader     reader { fd };
+        std::vector<std::byte> buffer ( READ_SIZE );
+        Member                 member;
+
+        while ( reader.next( member )) {
+            if ( member.type == '1' and hashes.contains( member.link )) {
+                hashes[ member.name ] = hashes[ member.link ];
+                continue;
+            }
+
+            if ( not is_regular( member.type ))
+                continue;
+
+            utils::Xxh64  hash;
+            std::uint64_t left = member.size;
+
+            while ( left > 0 ) {
+                const auto chunk = std::min<std::uint64_t>( left, buffer.size() );
+
+                if ( not reader.read( buffer.data(), chunk ))
+                    break;
+
+                hash.update({ buffer.data(), chunk });
+                left -= chunk;
+            }
+
+            hashes[ member.name ] = hash.digest();
+        }
+
+        if ( reader.has_errors() ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot read the archive to its end" );
+            return false;
+        }
+
+        return true;
+    }
+
+
+    void compare( Check &check, std::uint64_t actual ) {
+        check.state = actual == check.expected
+            ? Check::State::MATCHED
+            : Check::State::FAILED;
+    }
+
+
+    // ---- VERIFICATION MODES ----
+    //
+    // Every member name starts with "<project_name>/". An extracted or
+    // staged copy has that directory inside `directory`; otherwise it is
+    // the source tree itself, where names resolve without the prefix.
+    //
+    bool verify_directory( const fs::path &directory,
+                           utils::ThreadPool &pool,
+                           std::vector<Check> &checks
+    ) {
+        std::size_t strip = 0;
+
+        if ( not checks.empty() ) {
+            const std::string_view first { checks.front().name };
+            const auto             slash = first.find( '/' );
+
+            std::error_code ec;
+
+            if ( slash != std::string_view::npos
+                 and not fs::is_directory( directory / first.substr( 0, slash ), ec ))
+                strip = slash + 1;
+        }
+
+        for ( auto &check : checks ) {
+            pool.submit( [&directory, &check, strip] {
+                const auto relative = std::string_view { check.name }.substr(
+                    std::min( strip, check.name.size() )
+                );
+
+                std::error_code ec;
+                const auto hash = utils::hash_file( directory / relative, ec );
+
+                if ( not ec )
+                    compare( check, hash );
+            });
+        }
+
+        pool.wait_idle();
+        return true;
+    }
+
+
+    bool verify_contents( const fs::path &archive,
+                          utils::ThreadPool &pool,
+                          std::vector<Check> &checks
+    ) {
+        const int fd = ::open( archive.c_str(), O_RDONLY | O_CLOEXEC );
+
+        if ( fd < 0 ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Cannot open '{}': {}",
+                archive.string(),
+                std::strerror( errno )
+            );
+            return false;
+        }
+
+
+        std::unordered_map<std::string, std::uint64_t> hashes;
+        archive::Index                                  index;
+        bool                                            ok;
+
+        if ( index.load( archive ) == archive::Index::Errors::NONE ) {
+            std::vector<std::uint64_t> by_member;
+            ok = hash_indexed( fd, index, pool, by_member );
+
+            const auto &members = index.get_members();
+
+            for ( std::size_t i = 0; i < members.size(); i++ ) {
+                if ( is_regular( members[i].type ))
+                    hashes[ members[i].name ] = by_member[i];
+
+                else if ( members[i].type == '1' and hashes.contains( members[i].link ))
+                    hashes[ members[i].name ] = hashes[ members[i].link ];
+            }
+
+        } else {
+            ::posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+            ok = hash_stream( fd, hashes );
+        }
+
+        ::close( fd );
+
+
+        for ( auto &check : checks ) {
+            if ( const auto it = hashes.find( check.name ); it != hashes.end() )
+                compare( check, it->second );
+        }
+
+        return ok;
+    }
+}
+
+
+std::filesystem::path archive::get_checksums_path( const std::filesystem::path &archive ) {
+    auto path = archive;
+    path += ".xxh64";
+
+    return path;
+}
+
+
+bool archive::write_checksums( const Index &index, const std::filesystem::path &path ) {
+    /* Write aside and rename, a crash never leaves half a list */
+    auto temporary = path;
+    temporary += ".tmp";
+
+    std::FILE *file = std::fopen( temporary.c_str(), "w" );
+
+    if ( file == nullptr )
+        return false;
+
+    for ( const auto &check : checks_of( index )) {
+        /* The format is line based, such names cannot be listed */
+        if ( check.name.find( '\n' ) != std::string::npos )
+            continue;
+
+        fmt::print( file, "{:016x}  {}\n", check.expected, check.name );
+    }
+
+    const bool written = std::ferror( file ) == 0;
+
+    if ( std::fclose( file ) != 0 or not written ) {
+        std::error_code ignored;
+        fs::remove( temporary, ignored );
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename( temporary, path, ec );
+
+    return not ec;
+}
+
+
+bool archive::verify_archive( const VerifyOptions &options ) {
+    const auto checksums = get_checksums_path( options.archive );
+
+    std::vector<Check> checks;
+    std::error_code    ec;
+
+    if ( fs::exists( checksums, ec )) {
+        if ( not read_checksums( checksums, checks ))
+            return false;
+
+    } else {
+        Index index;
+
+        /* A seekable archive carries the hashes in its index */
+        if ( index.load( options.archive ) != Index::Errors::NONE ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: No checksums for '{}' ('{}')",
+                options.archive.string(),
+                checksums.string()
+            );
+            return false;
+        }
+
+        checks = checks_of( index );
+    }
+
+
+    utils::ThreadPool pool {
+        utils::ThreadPool::resolve_workers( options.threads )
+    };
+
+    const bool ok = options.directory.empty()
+        ? verify_contents ( options.archive, pool, checks )
+        : verify_directory( options.directory, pool, checks );
+
+
+    std::size_t failed = 0, missing = 0;
+
+    for ( const auto &check : checks ) {
+        if ( check.state == Check::State::FAILED ) {
+            fmt::println( "{}: \x1b[1;31mFAILED\x1b[0m", check.name );
+            failed++;
+
+        } else if ( check.state == Check::State::MISSING ) {
+            fmt::println( "{}: \x1b[1;33mMISSING\x1b[0m", check.name );
+            missing++;
+        }
+    }
+
+    fmt::println( "verified: {} ({} files, {} failed, {} missing)",
+        options.directory.empty()
+            ? options.archive.string()
+            : options.directory.string(),
+        checks.size(),
+        failed,
+        missing
+    );
+
+    return ok and failed == 0 and missing == 0;
+}
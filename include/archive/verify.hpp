@@ -0,0 +1,48 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/index.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+
+
+namespace archive {
+
+    // ---- VERIFY OPTIONS ----
+    //
+    struct VerifyOptions {
+        std::filesystem::path archive;
+        std::filesystem::path directory;  /* empty = the archive itself */
+        std::int64_t          threads;    /* 0 = all cores              */
+    };
+
+
+    // ---- MAIN FUNCTIONS ----
+    //
+    /* "<archive>.xxh64", next to the archive */
+    [[nodiscard]]
+    std::filesystem::path get_checksums_path( const std::filesystem::path &archive );
+    // +
+    // One "<xxh64>  <member name>" line per file, hardlinks included, in
+    // the format of `xxhsum`: `xxhsum -c` checks an extracted copy.
+    //
+    bool write_checksums( const Index &index, const std::filesystem::path &path );
+    // +
+    // Rehashes every file listed next to `archive` and reports the ones
+    // that differ or are missing. With `directory` the files are read
+    // from there, one per worker: where the archive was extracted or the
+    // parent of the staging copy (both hold `<project_name>/`), or else
+    // the project root the archive was built from. Otherwise the archive
+    // contents are hashed: by frames across workers when it is seekable,
+    // in one pass if not.
+    //
+    // A seekable archive without a checksums file is checked against
+    // the hashes of its index.
+    //
+    bool verify_archive( const VerifyOptions &options );
+}
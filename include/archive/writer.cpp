@@ -0,0 +1,751 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/writer.hpp"
+#include "archive/gzip.hpp"
+#include "archive/prefetch.hpp"
+#include "archive/sample.hpp"
+#include "archive/seekable.hpp"
+#include "archive/sink.hpp"
+#include "archive/tar.hpp"
+#include "archive/verify.hpp"
+#include "archive/zstd.hpp"
+#include "utilities/hash.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+
+    // ---- ARCHIVE ENTRY ----
+    //
+    struct Entry {
+        std::string   name;       /* member name inside the archive  */
+        std::string   relative;   /* to the project root (manifest)  */
+        fs::path      source;
+        std::string   leaf;       /* name inside the parent directory */
+        std::uint32_t depth;      /* 0 for the project root           */
+        bool          directory;
+    };
+
+
+    std::vector<Entry> collect_entries( const DirTree &tree,
+                                        const archive::Options &options
+    ) {
+        struct DirFrame {
+            DirTree::children_node_t::const_iterator begin;
+            DirTree::children_node_t::const_iterator end  ;
+            std::string                              relative;
+        };
+
+        std::vector<DirFrame> stack;
+        std::vector<Entry>    entries;
+
+        const auto &root_node = tree.get_root();
+        const fs::path root_path  = root_node.get_name();
+
+        entries.push_back({
+            options.project_name, {}, root_path, root_path.string(), 0, true
+        });
+
+
+        stack.push_back( DirFrame {
+            .begin    = root_node.get_children().begin(),
+            .end      = root_node.get_children().end  (),
+            .relative = {}
+        });
+
+
+        while ( not stack.empty() ) {
+            auto &[it, it_end, parent] = stack.back();
+
+            if ( it == it_end ) {
+                stack.pop_back();
+                continue;
+            }
+
+            const auto &[name, child] = *it;
+            it++;
+
+            /* Built while descending, nodes are never asked for paths */
+            auto relative = DirTree::join_path( parent, name );
+
+            entries.push_back({
+                DirTree::join_path( options.project_name, relative ),
+                relative,
+                root_path / relative,
+                std::string( name ),
+                static_cast<std::uint32_t>( stack.size() ),
+                ( *child ).is_directory()
+            });
+
+            if ( ( *child ).is_directory() ) {
+                stack.push_back( DirFrame {
+                    .begin    = ( *child ).get_children().begin(),
+                    .end      = ( *child ).get_children().end  (),
+                    .relative = std::move( relative )
+                });
+            }
+        }
+
+        return entries;
+    }
+
+
+    // ---- DUPLICATE CONTENTS ----
+    //
+    // Only files sharing a size are hashed (xxh64, reused from the
+    // manifest when it has them), and a matching hash is confirmed byte
+    // by byte. Each copy then points at the first entry with its contents.
+    //
+    constexpr std::size_t NO_LINK = std::numeric_limits<std::size_t>::max();
+
+
+    bool same_contents( const fs::path &first, const fs::path &second ) {
+        const int a = ::open( first.c_str() , O_RDONLY | O_CLOEXEC );
+        const int b = ::open( second.c_str(), O_RDONLY | O_CLOEXEC );
+
+        bool same = a >= 0 and b >= 0;
+
+        std::array<char, 64 * 1024> left, right;
+
+        while ( same ) {
+            const auto count = ::read( a, left.data(), left.size() );
+
+            if ( count <= 0 ) {
+                /* Both must end together */
+                same = count == 0 and ::read( b, right.data(), 1 ) == 0;
+                break;
+            }
+
+            /* Regular files: a short read only happens at the end */
+            std::size_t filled = 0;
+
+            while ( filled < std::size_t( count )) {
+                const auto got = ::read( b,
+                    right.data() + filled,
+                    std::size_t( count ) - filled
+                );
+
+                if ( got <= 0 )
+                    break;
+
+                filled += std::size_t( got );
+            }
+
+            same = filled == std::size_t( count )
+               and std::memcmp( left.data(), right.data(), filled ) == 0;
+        }
+
+        if ( a >= 0 ) ::close( a );
+        if ( b >= 0 ) ::close( b );
+
+        return same;
+    }
+
+
+    std::vector<std::size_t> find_duplicates( const std::vector<Entry> &entries,
+                                              const archive::Options &options
+    ) {
+        struct Candidate {
+            std::uint64_t size  = 0;
+            std::uint64_t hash  = 0;
+            bool          known = false;    /* hash already computed */
+        };
+
+        std::vector<std::size_t> links ( entries.size(), NO_LINK );
+        std::vector<Candidate>   files ( entries.size() );
+
+        utils::ThreadPool pool {
+            utils::ThreadPool::resolve_workers( options.threads )
+        };
+
+
+        /* Sizes: from the manifest, or one stat per unknown file */
+        for ( std::size_t i = 0; i < entries.size(); i++ ) {
+            if ( entries[i].directory )
+                continue;
+
+            const auto *record = options.manifest != nullptr
+                ? options.manifest->find( entries[i].relative )
+                : nullptr;
+
+            if ( record != nullptr and not record->directory ) {
+                files[i] = { record->size, record->hash, record->hash != 0 };
+                continue;
+            }
+
+            pool.submit( [&entries, &files, i] {
+                struct stat info {};
+
+                if ( ::stat( entries[i].source.c_str(), &info ) == 0
+                     and S_ISREG( info.st_mode ))
+                    files[i].size = static_cast<std::uint64_t>( info.st_size );
+            });
+        }
+
+        pool.wait_idle();
+
+
+        /* Empty files gain nothing from a link */
+        std::unordered_map<std::uint64_t, std::vector<std::size_t>> by_size;
+
+        for ( std::size_t i = 0; i < entries.size(); i++ ) {
+            if ( not entries[i].directory and files[i].size > 0 )
+                by_size[ files[i].size ].push_back( i );
+        }
+
+        for ( const auto &[size, group] : by_size ) {
+            if ( group.size() < 2 )
+                continue;
+
+            for ( const auto i : group ) {
+                if ( files[i].known )
+                    continue;
+
+                pool.submit( [&entries, &files, i] {
+                    std::error_code ec;
+                    files[i].hash  = utils::hash_file( entries[i].source, ec );
+                    files[i].known = not ec;
+                });
+            }
+        }
+
+        pool.wait_idle();
+
+
+        /* Earliest entry first: a link always points backwards */
+        std::map<std::pair<std::uint64_t, std::uint64_t>,
+                 std::vector<std::size_t>> by_contents;
+
+        for ( const auto &[size, group] : by_size ) {
+            if ( group.size() < 2 )
+                continue;
+
+            for ( const auto i : group ) {
+                if ( files[i].known )
+                    by_contents[{ size, files[i].hash }].push_back( i );
+            }
+        }
+
+        for ( auto &[key, group] : by_contents ) {
+            std::sort( group.begin(), group.end() );
+
+            for ( std::size_t k = 1; k < group.size(); k++ ) {
+                pool.submit( [&entries, &links, &group, k] {
+                    if ( same_contents( entries[ group[0] ].source,
+                                        entries[ group[k] ].source ))
+                        links[ group[k] ] = group[0];
+                });
+            }
+        }
+
+        pool.wait_idle();
+
+        return links;
+    }
+
+
+    // ---- INCOMPRESSIBLE FILES ----
+    //
+    // Sampled up front on a pool; the writer then tells the compressor
+    // where their data starts and ends. Linked copies carry no data.
+    //
+    std::vector<std::uint8_t> find_incompressible(
+        const std::vector<Entry> &entries,
+        const std::vector<std::size_t> &links,
+        const archive::Options &options
+    ) {
+        std::vector<std::uint8_t> stored ( entries.size(), 0 );
+
+        /* Level 0 already stores everything */
+        if ( not options.skip_incompressible
+             or ( options.compress_type == "gzip" and options.compress_level == 0 ))
+            return stored;
+
+        utils::ThreadPool pool {
+            utils::ThreadPool::resolve_workers( options.threads )
+        };
+
+        for ( std::size_t i = 0; i < entries.size(); i++ ) {
+            if ( entries[i].directory or links[i] != NO_LINK )
+                continue;
+
+            pool.submit( [&entries, &stored, i] {
+                stored[i] = archive::is_incompressible( entries[i].source );
+            });
+        }
+
+        pool.wait_idle();
+        return stored;
+    }
+
+
+    // ---- DIRECTORY FDS ----
+    //
+    // Open directories along the current branch of the walk, one per
+    // depth: entries are opened relative to their parent's fd.
+    //
+    class DirStack {
+    public:
+        DirStack() = default;
+
+        DirStack( const DirStack& ) = delete;
+        DirStack& operator=( const DirStack& ) = delete;
+
+        ~DirStack() {
+            truncate( 0 );
+        }
+
+
+        /* Opens `entry` (a directory) and makes it the deepest level */
+        int enter( const Entry &entry ) {
+            truncate( entry.depth );
+
+            const int fd = entry.depth == 0
+                ? ::open( entry.source.c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC )
+                : ::openat( fds.back(), entry.leaf.c_str(),
+                            O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+            if ( fd >= 0 )
+                fds.push_back( fd );
+
+            return fd;
+        }
+
+
+        /* Opens a file whose parent is still on the stack */
+        int open_file( const Entry &entry ) {
+            truncate( entry.depth );
+
+            return ::openat( fds.back(), entry.leaf.c_str(),
+                             O_RDONLY | O_CLOEXEC );
+        }
+
+    private:
+        std::vector<int> fds;
+
+        void truncate( std::size_t depth ) {
+            while ( fds.size() > depth ) {
+                ::close( fds.back() );
+                fds.pop_back();
+            }
+        }
+    };
+
+
+    /* `error`: errno of a failed open/read, 0 if the file shrank */
+    archive::TarWriter::Errors add_file_at( archive::TarWriter &tar,
+                                            const Entry &entry,
+                                            DirStack &directories,
+                                            int &error
+    ) {
+        const int fd = directories.open_file( entry );
+
+        if ( fd < 0 ) {
+            error = errno;
+            return archive::TarWriter::Errors::OPEN_FAILED;
+        }
+
+        struct stat info {};
+
+        auto result = archive::TarWriter::Errors::READ_FAILED;
+
+        if ( ::fstat( fd, &info ) == 0 ) {
+            result = tar.add_file( entry.name, fd, info );
+            error  = tar.get_read_error();
+        } else {
+            error  = errno;
+        }
+
+        ::close( fd );
+        return result;
+    }
+
+
+    struct WriteStats {
+        std::size_t linked = 0;    /* duplicates written as hardlinks */
+        std::size_t stored = 0;    /* files left uncompressed         */
+    };
+
+
+    /* A quarter of the budget holds compressed output, the rest reads */
+    std::size_t get_write_budget( const archive::Options &options ) {
+        return options.memory_budget / 4;
+    }
+
+
+    bool write_entries( const std::vector<Entry> &entries,
+                        const archive::Options &options,
+                        archive::TarWriter &tar,
+                        archive::Sink &compressor,
+                        WriteStats &stats
+    ) {
+        using Errors = archive::TarWriter::Errors;
+
+        const auto links = options.dedup
+            ? find_duplicates( entries, options )
+            : std::vector<std::size_t>( entries.size(), NO_LINK );
+
+        const auto stored = find_incompressible( entries, links, options );
+
+        /* A copy is linked only if its target really made it in */
+        std::vector<bool> written ( entries.size(), false );
+
+        const auto archived = [&]( const Entry &entry, std::uint64_t hash ) {
+            if ( options.hashes != nullptr )
+                options.hashes->insert_or_assign( entry.relative, hash );
+        };
+
+        /* File opens and reads run ahead of the writer: io_uring, or a
+         * reader thread within the read share of the memory budget */
+        std::vector<fs::path> sources;
+        std::unique_ptr<archive::Prefetcher> prefetcher;
+
+        if ( options.io_backend == "uring" or options.memory_budget > 0 ) {
+            for ( std::size_t i = 0; i < entries.size(); i++ ) {
+                if ( not entries[i].directory and links[i] == NO_LINK )
+                    sources.push_back( entries[i].source );
+            }
+        }
+
+        if ( options.io_backend == "uring" ) {
+            prefetcher = std::make_unique<archive::UringPrefetcher>( sources );
+
+            if ( prefetcher->has_errors() ) {
+                fmt::println( stderr, "io_uring unavailable, using threads" );
+                prefetcher.reset();
+            }
+        }
+
+        if ( prefetcher == nullptr and options.memory_budget > 0 )
+            prefetcher = std::make_unique<archive::ThreadPrefetcher>(
+                sources,
+                options.memory_budget - get_write_budget( options )
+            );
+
+
+        const auto left_out = [&]( const Entry &entry ) {
+            if ( options.skipped != nullptr )
+                options.skipped->push_back( entry.relative );
+        };
+
+        const auto cannot_read = [&]( const Entry &entry, int error ) {
+            left_out( entry );
+
+            if ( error == ENOENT )
+                fmt::println("File not found: {}", entry.source.string());
+            else if ( error == 0 )
+                fmt::println( stderr, "Cannot read '{}': it shrank while reading",
+                    entry.source.string()
+                );
+            else
+                fmt::println( stderr, "Cannot read '{}': {}",
+                    entry.source.string(),
+                    std::strerror( error )
+                );
+        };
+
+
+        /* Children of a missing directory are skipped silently */
+        std::string skip_prefix;
+        DirStack    directories;
+
+        for ( std::size_t i = 0; i < entries.size(); i++ ) {
+            using Loaded = archive::Prefetcher::Loaded;
+
+            const auto &entry = entries[i];
+            Loaded     *loaded = nullptr;
+
+            if ( prefetcher and not entry.directory and links[i] == NO_LINK )
+                loaded = &prefetcher->next();
+
+            const bool skipped = not skip_prefix.empty()
+                and entry.name.starts_with( skip_prefix );
+
+            if ( skipped ) {
+                left_out( entry );
+
+                if ( loaded != nullptr and loaded->fd >= 0 )
+                    ::close( std::exchange( loaded->fd, -1 ));
+                continue;
+            }
+
+
+            if ( entry.directory ) {
+                struct stat info {};
+
+                const int fd = directories.enter( entry );
+
+                if ( fd < 0 or ::fstat( fd, &info ) != 0 ) {
+                    cannot_read( entry, errno );
+                    skip_prefix = entry.name;
+
+                    if ( not skip_prefix.ends_with( '/' ))
+                        skip_prefix.push_back( '/' );
+
+                    /* Without the root there is nothing to archive */
+                    if ( &entry == &entries.front() )
+                        return false;
+
+                    continue;
+                }
+
+                if ( tar.add_directory( entry.name, info ) != Errors::NONE )
+                    return false;
+
+                continue;
+            }
+
+
+            Errors result = Errors::NONE;
+            int    error  = 0;
+
+            if ( links[i] != NO_LINK and written[ links[i] ] ) {
+                struct stat info {};
+
+                if ( ::stat( entry.source.c_str(), &info ) != 0 ) {
+                    cannot_read( entry, errno );
+                    continue;
+                }
+
+                if ( tar.add_hardlink( entry.name,
+                                       entries[ links[i] ].name,
+                                       info ) != Errors::NONE )
+                    return false;
+
+                /* Same contents, same hash: the target was hashed already */
+                if ( options.hashes != nullptr )
+                    archived( entry, options.hashes->at( entries[ links[i] ].relative ));
+
+                stats.linked++;
+                continue;
+            }
+
+            if ( not compressor.set_stored( stored[i] != 0 ))
+                return false;
+
+            if ( loaded == nullptr ) {
+                result = add_file_at( tar, entry, directories, error );
+
+            } else if ( loaded->error != 0 ) {
+                cannot_read( entry, loaded->error );
+                continue;
+
+            } else if ( loaded->loaded ) {
+                result = tar.add_file( entry.name, loaded->info, loaded->data );
+
+            } else {
+                result = tar.add_file( entry.name, loaded->fd, loaded->info );
+                error  = tar.get_read_error();
+                ::close( std::exchange( loaded->fd, -1 ));
+            }
+
+
+            switch ( result ) {
+                case Errors::NONE:
+                    written[i] = true;
+                    stats.stored += stored[i];
+                    archived( entry, tar.get_file_hash() );
+                    break;
+
+                case Errors::OPEN_FAILED:
+                case Errors::READ_FAILED:
+                    cannot_read( entry, error );
+                    break;
+
+                case Errors::WRITE_FAILED:
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    std::unique_ptr<archive::Sink> make_compressor(
+        archive::Sink &file,
+        const archive::Options &options,
+        std::optional<utils::ThreadPool> &pool,
+        archive::Index *index
+    ) {
+        using namespace archive;
+
+        const auto workers = utils::ThreadPool::resolve_workers( options.threads );
+        const auto level   = static_cast<int>( options.compress_level );
+
+
+        if ( options.compress_type == "zstd" ) {
+            if ( not ZstdSink::is_valid_level( options.compress_level )) {
+                fmt::println( stderr,
+                    "\x1b[1;31mError\x1b[0m: Invalid zstd level {} ({}..{})",
+                    options.compress_level,
+                    ZSTD_minCLevel(),
+                    ZSTD_maxCLevel()
+                );
+                return nullptr;
+            }
+
+            if ( index != nullptr ) {
+                pool.emplace( workers );
+                return std::make_unique<SeekableSink>( file, *index, level, *pool );
+            }
+
+            return std::make_unique<ZstdSink>( file, ZstdSink::Params {
+                .level      = level,
+                .workers    = workers,
+                .window_log = static_cast<int>( options.long_window )
+            });
+        }
+
+
+        if ( options.compress_level < 0 or options.compress_level > 9 ) {
+            fmt::println( stderr,
+                "\x1b[1;31mError\x1b[0m: Invalid gzip level {} (0..9)",
+                options.compress_level
+            );
+            return nullptr;
+        }
+
+        /* Frames are independent: they go to the pool even with one worker */
+        if ( index != nullptr ) {
+            pool.emplace( workers );
+            return std::make_unique<SeekableSink>( file, *index, level, *pool );
+        }
+
+        /* Single worker: plain streaming deflate, no block splitting */
+        if ( workers > 1 ) {
+            pool.emplace( workers );
+            return std::make_unique<ParallelGzipSink>( file, level, *pool );
+        }
+
+        return std::make_unique<GzipSink>( file, level );
+    }
+}
+
+
+std::string archive::get_extension( const std::string &compress_type ) {
+    if ( compress_type == "gzip" )
+        return ".tar.gz";
+
+    if ( compress_type == "zstd" )
+        return ".tar.zst";
+
+    return ".tar";
+}
+
+
+bool archive::write_tree( const DirTree &tree, const Options &options ) {
+
+    FileSink file { options.output };
+
+    if ( file.has_errors() )
+        return false;
+
+    /* Writes run on their own thread, behind the compressor */
+    std::optional<AsyncSink> behind;
+
+    if ( options.memory_budget > 0 )
+        behind.emplace( file, get_write_budget( options ));
+
+    Sink &output = behind ? static_cast<Sink &>( *behind ) : file;
+
+
+    std::optional<utils::ThreadPool> pool;
+    std::optional<Index>             index;
+
+    /* The index also collects the hashes of the checksums file */
+    if ( options.seekable or options.checksums )
+        index.emplace( options.compress_type == "zstd"
+            ? Index::Codec::ZSTD
+            : Index::Codec::GZIP
+        );
+
+    const auto compressor = make_compressor( output, options, pool,
+        options.seekable ? &*index : nullptr
+    );
+
+    /* Never leave a truncated archive behind */
+    const auto discard = [&] {
+        std::error_code ignored;
+        std::filesystem::remove( options.output, ignored );
+        return false;
+    };
+
+    if ( compressor == nullptr or compressor->has_errors() )
+        return discard();
+
+
+    TarWriter tar { *compressor, index ? &*index : nullptr };
+
+    const auto entries = collect_entries( tree, options );
+    WriteStats stats;
+
+    if ( not write_entries( entries, options, tar, *compressor, stats )
+         or not tar.finish() )
+    {
+        fmt::println( stderr, "\x1b[1;31mError\x1b[0m: Failed to write '{}'",
+            options.output.string()
+        );
+        return discard();
+    }
+
+
+    fmt::println("archived: {} ({} entries, {} -> {} bytes{}{}{})",
+        options.output.string(),
+        tar.get_entries (),
+        tar.get_bytes_in(),
+        file.get_written(),
+        options.seekable
+            ? fmt::format( ", {} seekable frames", index->get_frames().size() )
+            : "",
+        stats.linked > 0
+            ? fmt::format( ", {} duplicates linked", stats.linked ) : "",
+        stats.stored > 0
+            ? fmt::format( ", {} stored uncompressed", stats.stored ) : ""
+    );
+
+
+    /* A list from an earlier run would no longer match */
+    const auto checksums = get_checksums_path( options.output );
+
+    if ( not options.checksums ) {
+        std::error_code ignored;
+        fs::remove( checksums, ignored );
+
+    } else if ( not write_checksums( *index, checksums ))
+        fmt::println( stderr, "Cannot write checksums '{}'", checksums.string() );
+
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/tree.hpp"
+#include "staging/manifest.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace archive {
+
+    // ---- WRITER OPTIONS ----
+    //
+    struct Options {
+        std::string           compress_type;
+        std::int64_t          compress_level;
+        std::int64_t          threads;        /* 0 = all cores */
+        std::int64_t          long_window;    /* zstd windowLog, 0 = off */
+        std::string           io_backend;     /* "threads" or "uring"    */
+        std::string           project_name;   /* prefix of every entry */
+        std::filesystem::path output;
+        // +
+        bool                     dedup    = false;    /* copies -> hardlinks */
+        const staging::Manifest *manifest = nullptr;  /* known sizes/hashes  */
+        // +
+        /* Gets the relative paths left out because they could not be read */
+        std::vector<std::string> *skipped = nullptr;
+        // +
+        /* Gets the xxh64 of every file archived, by relative path */
+        std::unordered_map<std::string, std::uint64_t> *hashes = nullptr;
+        // +
+        bool skip_incompressible = false;   /* media, archives: level 0 */
+        bool seekable            = false;   /* frames + footer index    */
+        bool checksums           = false;   /* <output>.xxh64 alongside */
+        // +
+        /* Bytes read ahead plus written behind, 0 = all stages inline */
+        std::size_t memory_budget = 0;
+    };
+
+
+    // ---- MAIN FUNCTIONS ----
+    //
+    [[nodiscard]]
+    std::string get_extension( const std::string &compress_type );
+    // +
+    bool write_tree( const DirTree &tree, const Options &options );
+}
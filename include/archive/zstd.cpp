@@ -0,0 +1,181 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/zstd.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+bool archive::ZstdSink::is_valid_level( std::int64_t level ) {
+    return level >= ZSTD_minCLevel()
+       and level <= ZSTD_maxCLevel();
+}
+
+
+bool archive::ZstdSink::is_valid_window_log( std::int64_t window_log ) {
+    const auto bounds = ZSTD_cParam_getBounds( ZSTD_c_windowLog );
+
+    return window_log == 0
+        or ( window_log >= bounds.lowerBound
+             and window_log <= bounds.upperBound );
+}
+
+
+bool archive::ZstdSink::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+bool archive::ZstdSink::check( std::size_t code, const char *what ) {
+    if ( not ZSTD_isError( code ))
+        return true;
+
+    fmt::println( stderr, "\x1b[1;31mError\x1b[0m: zstd: {}: {}",
+        what,
+        ZSTD_getErrorName( code )
+    );
+
+    _has_errors = true;
+    return false;
+}
+
+
+bool archive::ZstdSink::set_parameter( ZSTD_cParameter param, int value ) {
+    return check(
+        ZSTD_CCtx_setParameter( context, param, value ),
+        "invalid parameter"
+    );
+}
+
+
+bool archive::ZstdSink::compress( ZSTD_inBuffer &input,
+                                  ZSTD_EndDirective mode
+) {
+    std::size_t remaining = 0;
+
+    do {
+        ZSTD_outBuffer output { buffer.data(), buffer.size(), 0 };
+
+        remaining = ZSTD_compressStream2( context, &output, &input, mode );
+
+        if ( not check( remaining, "compression failed" ))
+            return false;
+
+        if ( output.pos > 0
+            and not next.write({ buffer.data(), output.pos }) )
+        {
+            _has_errors = true;
+            return false;
+        }
+
+    /* end/flush: until nothing is left buffered, else until input used */
+    } while ( mode != ZSTD_e_continue ? remaining != 0
+                                      : input.pos < input.size );
+
+    return true;
+}
+
+
+bool archive::ZstdSink::write( std::span<const std::byte> data ) {
+    if ( _has_errors )
+        return false;
+
+    ZSTD_inBuffer input { data.data(), data.size(), 0 };
+
+    return compress( input, ZSTD_e_continue );
+}
+
+
+bool archive::ZstdSink::set_stored( bool _stored ) {
+    if ( _has_errors )
+        return false;
+
+    if ( _stored == stored )
+        return true;
+
+    stored = _stored;
+
+    ZSTD_inBuffer input { nullptr, 0, 0 };
+
+    if ( not compress( input, multithreaded ? ZSTD_e_flush : ZSTD_e_end ))
+        return false;
+
+    return set_parameter( ZSTD_c_compressionLevel,
+        stored ? ZSTD_minCLevel() : level
+    );
+}
+
+
+bool archive::ZstdSink::finish( void ) {
+    if ( _has_errors )
+        return false;
+
+    ZSTD_inBuffer input { nullptr, 0, 0 };
+
+    return compress( input, ZSTD_e_end ) and next.finish();
+}
+
+
+archive::ZstdSink::ZstdSink( Sink &_next, const Params &_params )
+  : next    { _next },
+    context { ZSTD_createCCtx() },
+    level   { _params.level },
+    buffer  ( ZSTD_CStreamOutSize() )
+{
+    if ( context == nullptr ) {
+        fmt::println( stderr,
+            "\x1b[1;31mError\x1b[0m: zstd: cannot create context"
+        );
+
+        _has_errors = true;
+        return;
+    }
+
+    if ( not set_parameter( ZSTD_c_compressionLevel, _params.level )
+      or not set_parameter( ZSTD_c_checksumFlag, 1 ))
+        return;
+
+
+    /* A libzstd built without ZSTD_MULTITHREAD rejects nbWorkers */
+    if ( _params.workers > 1 ) {
+        const auto status = ZSTD_CCtx_setParameter(
+            context,
+            ZSTD_c_nbWorkers,
+            static_cast<int>( _params.workers )
+        );
+
+        multithreaded = not ZSTD_isError( status );
+
+        if ( not multithreaded )
+            fmt::println( stderr,
+                "zstd: multithreading unavailable, using one thread"
+            );
+    }
+
+
+    if ( _params.window_log > 0 ) {
+        if ( not set_parameter( ZSTD_c_enableLongDistanceMatching, 1 )
+          or not set_parameter( ZSTD_c_windowLog, _params.window_log ))
+            return;
+    }
+}
+
+
+archive::ZstdSink::~ZstdSink() {
+    ZSTD_freeCCtx( context );
+}
+
+
+ZSTD_DCtx *archive::create_zstd_reader( void ) {
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+
+    if ( context != nullptr )
+        ZSTD_DCtx_setParameter( context,
+            ZSTD_d_windowLogMax,
+            ZSTD_dParam_getBounds( ZSTD_d_windowLogMax ).upperBound
+        );
+
+    return context;
+}
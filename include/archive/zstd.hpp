@@ -0,0 +1,115 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "archive/sink.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <zstd.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <vector>
+
+
+namespace archive {
+
+    // ---- ZSTD SINK ----
+    //
+    // Streaming zstd frame writer. Threading and long distance matching
+    // are delegated to libzstd itself (ZSTD_c_nbWorkers / ZSTD_c_enableLDM).
+    //
+    // Stored stretches drop to the fastest level, which leaves literals
+    // uncompressed. With workers the level changes at the next job of
+    // the same frame; a single-threaded context only takes a new level
+    // between frames, so the frame is closed there (zstd reads
+    // concatenated frames as one stream).
+    //
+    class ZstdSink final : public Sink {
+    public:
+        // ---- PARAMETERS ----
+        //
+        struct Params {
+            int          level;        /* negative values = fast modes  */
+            std::size_t  workers;      /* 1 = compress on calling thread */
+            int          window_log;   /* 0 = no long distance matching */
+        };
+
+
+        // ---- CONSTRUCTORS ----
+        //
+        ZstdSink( Sink &_next, const Params &_params );
+        ~ZstdSink() override;
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        ZstdSink( const ZstdSink& ) = delete;
+        ZstdSink& operator=( const ZstdSink& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        bool write ( std::span<const std::byte> data ) override;
+        bool finish( void ) override;
+        // +
+        bool set_stored( bool _stored ) override;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        [[nodiscard]]
+        bool has_errors( void ) const override;
+
+
+        // ---- HELPERS ----
+        //
+        [[nodiscard]]
+        static bool is_valid_level( std::int64_t level );
+        // +
+        /* 0 (no long distance matching) or a windowLog libzstd accepts */
+        [[nodiscard]]
+        static bool is_valid_window_log( std::int64_t window_log );
+
+
+    private:
+        // ---- MAIN MEMBERS ----
+        //
+        Sink      &next;
+        ZSTD_CCtx *context;
+        // +
+        int  level;
+        bool multithreaded = false;
+        bool stored        = false;
+
+
+        // ---- BUFFER STATE ----
+        //
+        std::vector<std::byte> buffer;
+
+
+        // ---- ERROR STATE ----
+        //
+        bool _has_errors = false;
+
+
+        // ---- COMPRESSION HANDLING ----
+        //
+        bool check        ( std::size_t code, const char *what );
+        bool set_parameter( ZSTD_cParameter param, int value );
+        bool compress     ( ZSTD_inBuffer &input, ZSTD_EndDirective mode );
+    };
+
+
+    // ---- ZSTD DECOMPRESSION ----
+    //
+    /* Accepts every window the format allows, not just the 128 MiB
+     * default: archives written with a large `long_window` stay
+     * readable. Null when out of memory */
+    [[nodiscard]]
+    ZSTD_DCtx *create_zstd_reader( void );
+}
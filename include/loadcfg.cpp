@@ -1,10 +1,18 @@
 // ---- LOCAL INCLUDES ----
 //
 #include "loadcfg.hpp"
+#include "archive/extract.hpp"
+#include "archive/verify.hpp"
+#include "archive/writer.hpp"
+#include "archive/zstd.hpp"
+#include "parsing/cache.hpp"
 #include "parsing/lexer.hpp"
 #include "parsing/parser.hpp"
 #include "parsing/token.hpp"
 #include "parsing/tree.hpp"
+#include "staging/copy.hpp"
+#include "staging/manifest.hpp"
+#include "utilities/hash.hpp"
 
 
 // ---- EXTERNAL INCLUDES ----
@@ -14,11 +22,14 @@
 
 // ---- STANDARD INCLUDES ----
 //
+#include <algorithm>
+#include <array>
 #include <span>
 #include <ranges>
 #include <string>
 #include <string_view>
 #include <filesystem>
+#include <unordered_map>
 #include <vector>
 
 
@@ -33,7 +44,10 @@ namespace {
             constexpr std::string_view executable_name = "comprexxion";
         #endif
 
-        fmt::println( "Usage: {} -c <config file>", executable_name );
+        fmt::println( "Usage: {} [-f] [-b] [-c <config file>]", executable_name );
+        fmt::println( "       {} -x <archive> [<member>] [-o <directory>]", executable_name );
+        fmt::println( "       {} -l <archive>", executable_name );
+        fmt::println( "       {} --verify <archive> [<directory>]", executable_name );
     }
 
 
@@ -91,6 +105,90 @@ namespace {
                 std::int32_t( 4 )
             }
         },
+        {
+            /* zstd long distance matching window (log2), 0 = disabled */
+            "long_window"   , {
+                TOKEN::VALID_NUMBER,
+                std::int32_t( 0 )
+            }
+        },
+        {
+            /* worker threads for compression, 0 = one per core */
+            "threads"       , {
+                TOKEN::VALID_NUMBER,
+                std::int32_t( 0 )
+            }
+        },
+        {
+            /* concurrent copies while staging, 0 = one per core */
+            "copy_jobs"     , {
+                TOKEN::VALID_NUMBER,
+                std::int32_t( 0 )
+            }
+        },
+        {
+            /* MiB the archive stages may hold in flight, 0 = no pipeline */
+            "memory_budget" , {
+                TOKEN::VALID_NUMBER,
+                std::int32_t( 256 )
+            }
+        },
+        {
+            /* "uring" batches staging I/O through io_uring when available */
+            "io_backend"    , {
+                TOKEN::STRING,
+                std::string ( "threads" )
+            }
+        },
+        {
+            /* how staged files are materialized: copy/hardlink/symlink/auto */
+            "link_mode"     , {
+                TOKEN::STRING,
+                std::string ( "copy" )
+            }
+        },
+        {
+            /* "staged": copy into project_name/ first, "direct": archive only */
+            "archive_mode"  , {
+                TOKEN::STRING,
+                std::string ( "staged" )
+            }
+        },
+        {
+            /* "on" drops what the .gitignore files found by '*' ignore */
+            "gitignore"     , {
+                TOKEN::STRING,
+                std::string ( "off" )
+            }
+        },
+        {
+            /* "on" stores files with identical contents once, as hardlinks */
+            "dedup"         , {
+                TOKEN::STRING,
+                std::string ( "off" )
+            }
+        },
+        {
+            /* "on" stores already compressed files (media, archives) as is */
+            "skip_incompressible", {
+                TOKEN::STRING,
+                std::string ( "on" )
+            }
+        },
+        {
+            /* "on" compresses in independent frames behind a footer index */
+            "seekable"      , {
+                TOKEN::STRING,
+                std::string ( "off" )
+            }
+        },
+        {
+            /* "on" writes the xxh64 of every file next to the archive */
+            "checksums"     , {
+                TOKEN::STRING,
+                std::string ( "on" )
+            }
+        },
         {
             "structure"       , {
                 TOKEN::PATHS_BLOCK,
@@ -101,73 +199,254 @@ namespace {
     };
 
 
-    void create_structure( void ) {
-        namespace fs = std::filesystem;
+    bool parse_config( const std::string &filepath ) {
+        Lexer  lexer  { filepath };
+        Parser parser { lexer, identifiers_on_top };
 
-        struct DirFrame {
-            DirTree::children_node_t::const_iterator begin;
-            DirTree::children_node_t::const_iterator end  ;
-        };
 
-        std::vector<DirFrame> stack;
+        if ( lexer.has_errors() || parser.has_errors() ) {
+            return false;
+        }
+
+
+        /* '*' directories are scanned once every option is known */
+        std::get<std::shared_ptr<DirTree>>(
+            identifiers_on_top["structure"].second
+        )->expand_selections(
+            std::get<std::string>( identifiers_on_top["gitignore"].second ) == "on"
+        );
+
+
+        #ifdef DEBUG
+            parser.print_config();
+        #endif
+
+        return true;
+    }
+
+
+    /* With -b, a valid compiled cache replaces lexing, parsing and every
+     * '*' scan; otherwise the config is parsed and the cache refreshed */
+    bool load_config( const std::string &filepath, bool use_cache, bool force ) {
+        /* A pipe has nothing stable to key the cache on */
+        if ( not use_cache or filepath == "-" )
+            return parse_config( filepath );
+
+        const ConfigCache cache { filepath };
+
+        if ( not force and cache.load( identifiers_on_top ) == ConfigCache::Errors::NONE ) {
+            #ifdef DEBUG
+                fmt::println( "config loaded from {}", cache.get_path().string() );
+            #endif
+            return true;
+        }
+
+        if ( not parse_config( filepath ))
+            return false;
+
+        if ( cache.save( identifiers_on_top ) != ConfigCache::Errors::NONE )
+            fmt::println( stderr, "Cannot write config cache '{}'",
+                cache.get_path().string()
+            );
+
+        return true;
+    }
+
 
+    bool create_structure( const staging::Changes &changes ) {
         const auto tree_ptr = std::get<std::shared_ptr<DirTree>>(
                 identifiers_on_top["structure"].second
             );
 
+        const staging::Options options {
+            .target = std::get<std::string>(
+                identifiers_on_top["project_name"].second
+            ),
+            .jobs   = std::get<std::int64_t>(
+                identifiers_on_top["copy_jobs"].second
+            ),
+            .io_backend = std::get<std::string>(
+                identifiers_on_top["io_backend"].second
+            ),
+            .link_mode  = std::get<std::string>(
+                identifiers_on_top["link_mode"].second
+            ),
+            .changes    = &changes
+        };
 
-        const auto &tree         = *tree_ptr;
-        const auto &root_node    = tree.get_root();
-        const auto &project_name = std::get<std::string>(
-            identifiers_on_top["project_name"].second
+        return staging::create_structure( *tree_ptr, options );
+    }
+
+
+    /* Ranges the parser cannot check, caught before any work is done */
+    bool check_options( void ) {
+        const auto window_log = std::get<std::int64_t>(
+            identifiers_on_top["long_window"].second
         );
 
+        if ( not archive::ZstdSink::is_valid_window_log( window_log )) {
+            const auto bounds = ZSTD_cParam_getBounds( ZSTD_c_windowLog );
 
-        fs::create_directory( project_name );
+            fmt::println( stderr,
+                "\x1b[1;31mError\x1b[0m: Invalid long_window {} (0 or {}..{})",
+                window_log,
+                bounds.lowerBound,
+                bounds.upperBound
+            );
+            return false;
+        }
 
+        return true;
+    }
 
-        stack.push_back( DirFrame {
-            .begin = root_node.get_children().begin(),
-            .end   = root_node.get_children().end  ()
-        });
 
+    /* Options that change what ends up staged or archived, not just how
+     * fast: when they differ from the last run nothing can be reused */
+    std::uint64_t get_options_hash( void ) {
+        constexpr std::array<std::string_view, 10> output_options {
+            "project_name",
+            "archive_mode",
+            "link_mode",
+            "compress_type",
+            "compress_level",
+            "long_window",
+            "dedup",
+            "skip_incompressible",
+            "seekable",
+            "checksums"
+        };
 
-        while ( not stack.empty() ) {
-            auto &[it, it_end] = stack.back();
+        std::string options;
 
-            if ( it == it_end ) {
-                stack.pop_back();
-                continue;
-            }
+        for ( const auto key : output_options ) {
+            const auto &value = identifiers_on_top[ key ].second;
+
+            if ( const auto *text = std::get_if<std::string>( &value ))
+                options += fmt::format( "{}={}\n", key, *text );
+            else
+                options += fmt::format( "{}={}\n", key, std::get<std::int64_t>( value ));
+        }
 
-            const auto &node = *( it->second );
+        utils::Xxh64 hash;
+        hash.update( std::as_bytes( std::span( options )));
 
-            const fs::path source_path = node.get_full_path();
-            const fs::path target_path = fs::path( project_name ) / source_path;
+        return hash.digest();
+    }
 
-            if ( not fs::exists( source_path ) ) {
-                fmt::println("File not found: {}", source_path.string());
-                ++it;
-                continue;
-            }
 
+    staging::Changes find_changes( const std::filesystem::path &manifest_path,
+                                   bool force
+    ) {
+        const auto tree_ptr = std::get<std::shared_ptr<DirTree>>(
+                identifiers_on_top["structure"].second
+            );
 
-            it++;
+        staging::Manifest previous;
 
-            if ( node.is_directory() ) {
-                fs::create_directory( target_path );
-                fmt::println("created: {}", target_path.string());
+        if ( previous.load( manifest_path ) != staging::Manifest::Errors::NONE ) {
+            fmt::println( stderr, "Ignoring unreadable manifest '{}'",
+                manifest_path.string()
+            );
+            previous = {};
+        }
 
-                stack.push_back( DirFrame {
-                    .begin = node.get_children().begin(),
-                    .end   = node.get_children().end  ()
-                });
+        const auto options = get_options_hash();
 
-            } else {
-                fs::copy_file( source_path, target_path );
-                fmt::println("copied: {}", target_path.string());
-            }
+        /* Other options: every staged file and the archive are stale */
+        auto changes = staging::diff_tree(
+            *tree_ptr,
+            previous,
+            std::get<std::int64_t>( identifiers_on_top["copy_jobs"].second ),
+            force or previous.get_options() != options
+        );
+
+        changes.current.set_options( options );
+        return changes;
+    }
+
+
+    bool compress_structure( staging::Changes &changes, bool force ) {
+        namespace fs = std::filesystem;
+
+        const auto tree_ptr = std::get<std::shared_ptr<DirTree>>(
+                identifiers_on_top["structure"].second
+            );
+
+        const auto &project_name = std::get<std::string>(
+            identifiers_on_top["project_name"].second
+        );
+
+        const auto &compress_type = std::get<std::string>(
+            identifiers_on_top["compress_type"].second
+        );
+
+        std::vector<std::string>                       skipped;
+        std::unordered_map<std::string, std::uint64_t> hashes;
+
+        const archive::Options options {
+            .compress_type  = compress_type,
+            .compress_level = std::get<std::int64_t>(
+                identifiers_on_top["compress_level"].second
+            ),
+            .threads        = std::get<std::int64_t>(
+                identifiers_on_top["threads"].second
+            ),
+            .long_window    = std::get<std::int64_t>(
+                identifiers_on_top["long_window"].second
+            ),
+            .io_backend     = std::get<std::string>(
+                identifiers_on_top["io_backend"].second
+            ),
+            .project_name   = project_name,
+            .output         = project_name
+                + archive::get_extension( compress_type ),
+            .dedup          = std::get<std::string>(
+                identifiers_on_top["dedup"].second
+            ) == "on",
+            .manifest       = &changes.current,
+            .skipped        = &skipped,
+            .hashes         = &hashes,
+            .skip_incompressible = std::get<std::string>(
+                identifiers_on_top["skip_incompressible"].second
+            ) == "on",
+            .seekable       = std::get<std::string>(
+                identifiers_on_top["seekable"].second
+            ) == "on",
+            .checksums      = std::get<std::string>(
+                identifiers_on_top["checksums"].second
+            ) == "on",
+            .memory_budget  = static_cast<std::size_t>( std::max<std::int64_t>(
+                std::get<std::int64_t>( identifiers_on_top["memory_budget"].second ),
+                0
+            )) * 1024 * 1024
+        };
+
+        /* The archive is one stream: rebuilt whole, or kept as is */
+        if ( not force and changes.empty() and fs::exists( options.output )) {
+            fmt::println("archive up to date: {}", options.output.string());
+            return true;
         }
+
+        if ( not archive::write_tree( *tree_ptr, options ))
+            return false;
+
+        /* Not in the archive: the next run must see them as new */
+        for ( const auto &relative : skipped )
+            changes.current.erase( relative );
+
+        /* New and resized files were not hashed by diff_tree */
+        for ( const auto &[relative, hash] : hashes ) {
+            const auto *record = changes.current.find( relative );
+
+            if ( record == nullptr or record->directory )
+                continue;
+
+            auto updated = *record;
+            updated.hash = hash;
+            changes.current.insert( relative, updated );
+        }
+
+        return true;
     }
 }
 
@@ -180,36 +459,106 @@ bool cfg::loadcfg( int argc, char *argv[] ) {
                 return std::string_view( arg );
             });
 
-    std::string filepath { "comprexxion.txt" };
+    std::string filepath  { "comprexxion.txt" };
+    bool        force     = false;
+    bool        use_cache = false;
+    // +
+    std::string extract_from;
+    std::string extract_member;
+    std::string extract_to { "." };
+    std::string list_from;
+    std::string verify_from;
+    std::string verify_in;
+
+    for ( std::size_t i = 1; i < args.size(); i++ ) {
+        /* -f: rebuild everything instead of trusting the manifest */
+        if ( args[i] == "-f" ) {
+            force = true;
+
+        /* -b: reuse the compiled config while it is still valid */
+        } else if ( args[i] == "-b" ) {
+            use_cache = true;
+
+        /* Check if the filepath is specified, "-" reads stdin */
+        } else if ( args[i] == "-c" and i + 1 < args.size() ) {
+            filepath = args[ ++i ];
+
+        /* -x: restore an archive instead of building one */
+        } else if ( args[i] == "-x" and i + 1 < args.size() ) {
+            extract_from = args[ ++i ];
+
+            /* An optional member path follows the archive */
+            if ( i + 1 < args.size() and not args[ i + 1 ].starts_with( '-' ))
+                extract_member = args[ ++i ];
+
+        } else if ( args[i] == "-o" and i + 1 < args.size() ) {
+            extract_to = args[ ++i ];
+
+        /* -l: list an archive's members */
+        } else if ( args[i] == "-l" and i + 1 < args.size() ) {
+            list_from = args[ ++i ];
+
+        /* --verify: rehash the archive contents, or a copy of them */
+        } else if ( args[i] == "--verify" and i + 1 < args.size() ) {
+            verify_from = args[ ++i ];
+
+            if ( i + 1 < args.size() and not args[ i + 1 ].starts_with( '-' ))
+                verify_in = args[ ++i ];
+
+        } else {
+            usage();
+            return false;
+        }
+    }
+
+
+    /* Extraction, listing and verification need no config file */
+    if ( not list_from.empty() )
+        return archive::list_archive( list_from );
 
-    // TODO: Add support for the -f (force) flag to remove the previous project if it exists
+    if ( not verify_from.empty() )
+        return archive::verify_archive({
+            .archive   = verify_from,
+            .directory = verify_in,
+            .threads   = 0
+        });
+
+    if ( not extract_from.empty() )
+        return archive::extract_archive({
+            .archive = extract_from,
+            .output  = extract_to,
+            .threads = 0,
+            .member  = extract_member
+        });
 
-    /* Check if the filepath is specified */
-    if ( args.size() == 3 and args[1] == "-c" ) {
-        filepath = args[2];
 
-    } else if ( args.size() != 1 ) {
-        usage();
+    if ( not load_config( filepath, use_cache, force ) or not check_options() )
         return false;
-    }
 
 
-    Lexer  lexer  { filepath };
-    Parser parser { lexer, identifiers_on_top };
+    const auto &archive_mode = std::get<std::string>(
+        identifiers_on_top["archive_mode"].second
+    );
 
+    const auto &project_name = std::get<std::string>(
+        identifiers_on_top["project_name"].second
+    );
 
-    if ( lexer.has_errors() || parser.has_errors() ) {
-        return false;
-    }
+    /* State of the last successful run, next to its outputs */
+    const auto manifest_path = "." + project_name + ".manifest";
+    auto       changes       = find_changes( manifest_path, force );
 
 
-    #ifdef DEBUG
-        parser.print_config();
-    #endif
+    /* The archive reads the sources directly, staging is optional */
+    if ( archive_mode == "staged" and not create_structure( changes ))
+        return false;
 
+    if ( not compress_structure( changes, force ))
+        return false;
 
-    create_structure();
 
+    if ( changes.current.save( manifest_path ) != staging::Manifest::Errors::NONE )
+        fmt::println( stderr, "Cannot write manifest '{}'", manifest_path );
 
     return true;
 }
@@ -0,0 +1,377 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/cache.hpp"
+#include "utilities/hash.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+
+    /* Bumped whenever the layout or the identifier set changes */
+    constexpr std::string_view MAGIC   = "CXCACHE";
+    constexpr std::uint32_t    VERSION = 6;
+
+
+    enum class ValueKind : std::uint8_t {
+        STRING,
+        NUMBER,
+        TREE
+    };
+
+
+    /* Appends native-endian fields: the cache never leaves this host */
+    class Writer {
+    public:
+        template <typename T>
+        void put( T value ) {
+            buffer.append( reinterpret_cast<const char *>( &value ), sizeof( T ));
+        }
+
+        void put_string( std::string_view value ) {
+            put( static_cast<std::uint32_t>( value.size() ));
+            buffer.append( value );
+        }
+
+        [[nodiscard]]
+        const std::string &get_buffer( void ) const {
+            return buffer;
+        }
+
+    private:
+        std::string buffer;
+    };
+
+
+    /* Bounds-checked reads over the mapping, `failed` sticks */
+    class Reader {
+    public:
+        Reader( const char *_data, std::size_t _size )
+          : data { _data },
+            size { _size }
+        {}
+
+        template <typename T>
+        T get( void ) {
+            T value {};
+
+            if ( failed or size - offset < sizeof( T )) {
+                failed = true;
+                return value;
+            }
+
+            std::memcpy( &value, data + offset, sizeof( T ));
+            offset += sizeof( T );
+
+            return value;
+        }
+
+        std::string_view get_string( void ) {
+            const auto length = get<std::uint32_t>();
+
+            if ( failed or size - offset < length ) {
+                failed = true;
+                return {};
+            }
+
+            const std::string_view value { data + offset, length };
+            offset += length;
+
+            return value;
+        }
+
+        [[nodiscard]]
+        bool ok( void ) const {
+            return not failed;
+        }
+
+    private:
+        const char  *data;
+        std::size_t  size;
+        std::size_t  offset = 0;
+        bool         failed = false;
+    };
+
+
+    /* Read-only mapping released on scope exit */
+    struct Mapping {
+        const char  *data = nullptr;
+        std::size_t  size = 0;
+
+        ~Mapping() {
+            if ( data != nullptr )
+                ::munmap( const_cast<char *>( data ), size );
+        }
+    };
+
+
+    std::int64_t get_mtime( const fs::path &path, bool &found ) {
+        struct stat info {};
+
+        found = ::stat( path.c_str(), &info ) == 0;
+
+        return info.st_mtim.tv_sec * 1'000'000'000LL + info.st_mtim.tv_nsec;
+    }
+}
+
+
+/* --------------------- CONFIGCACHE:: IMPLEMENTATION --------------------- */
+
+bool ConfigCache::config_hash( std::uint64_t &hash ) const {
+    std::error_code ec;
+    hash = utils::hash_file( config, ec );
+
+    return not ec;
+}
+
+
+bool ConfigCache::stamps_hold( const DirTree &tree ) {
+    const fs::path root { tree.get_root().get_name() };
+
+    for ( const auto &[node, mtime, gitignore_mtime] : tree.stamps ) {
+        const auto directory = root / tree.nodes[ node ].get_full_path();
+        bool found;
+
+        if ( get_mtime( directory, found ) != mtime or not found )
+            return false;
+
+        /* An edited .gitignore keeps its directory's mtime */
+        if ( gitignore_mtime > 0
+             and ( get_mtime( directory / ".gitignore", found ) != gitignore_mtime
+                   or not found ))
+            return false;
+    }
+
+    return true;
+}
+
+
+ConfigCache::Errors ConfigCache::load( Parser::ident_map_t &identifiers ) const {
+    std::uint64_t hash;
+
+    if ( not config_hash( hash ))
+        return Errors::OPEN_FAILED;
+
+
+    const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 )
+        return Errors::OPEN_FAILED;
+
+    struct stat info {};
+    Mapping     mapping;
+
+    if ( ::fstat( fd, &info ) == 0 and info.st_size > 0 ) {
+        void *data = ::mmap( nullptr,
+            static_cast<std::size_t>( info.st_size ),
+            PROT_READ, MAP_PRIVATE, fd, 0
+        );
+
+        if ( data != MAP_FAILED ) {
+            mapping.data = static_cast<const char *>( data );
+            mapping.size = static_cast<std::size_t>( info.st_size );
+        }
+    }
+
+    ::close( fd );
+
+    if ( mapping.data == nullptr )
+        return Errors::BAD_FORMAT;
+
+
+    Reader reader { mapping.data, mapping.size };
+
+    if ( reader.get_string() != MAGIC or reader.get<std::uint32_t>() != VERSION )
+        return Errors::BAD_FORMAT;
+
+    if ( reader.get<std::uint64_t>() != hash
+         or reader.get_string() != fs::current_path().string() )
+        return Errors::STALE;
+
+
+    /* Decoded aside, `identifiers` only changes once all of it holds */
+    std::vector<std::pair<std::string_view, Parser::ident_value_t>> values;
+
+    const auto count = reader.get<std::uint32_t>();
+
+    for ( std::uint32_t i = 0; i < count and reader.ok(); i++ ) {
+        const auto name = reader.get_string();
+        const auto kind = reader.get<ValueKind>();
+
+        if ( not identifiers.contains( name ))
+            return Errors::BAD_FORMAT;
+
+        switch ( kind ) {
+            case ValueKind::STRING:
+                values.emplace_back( name, std::string( reader.get_string() ));
+                break;
+
+            case ValueKind::NUMBER:
+                values.emplace_back( name, reader.get<std::int64_t>() );
+                break;
+
+            case ValueKind::TREE: {
+                auto tree = std::make_shared<DirTree>(
+                    std::string( reader.get_string() )
+                );
+
+                /* Stored in index order: parents always come first */
+                const auto nodes = reader.get<std::uint32_t>();
+
+                for ( std::uint32_t node = 1; node < nodes and reader.ok(); node++ ) {
+                    const auto parent = reader.get<std::uint32_t>();
+                    const auto type   = reader.get<DirTree::NodeType>();
+                    const auto child  = reader.get_string();
+
+                    if ( not reader.ok() or parent >= tree->nodes.size()
+                         or type > DirTree::NodeType::IS_FILE
+                         or tree->insert_child( parent, child, type )
+                            != DirTree::Errors::NONE )
+                        return Errors::BAD_FORMAT;
+                }
+
+                const auto stamps = reader.get<std::uint32_t>();
+
+                for ( std::uint32_t stamp = 0; stamp < stamps and reader.ok(); stamp++ ) {
+                    const auto node            = reader.get<std::uint32_t>();
+                    const auto mtime           = reader.get<std::int64_t>();
+                    const auto gitignore_mtime = reader.get<std::int64_t>();
+
+                    if ( node >= tree->nodes.size() )
+                        return Errors::BAD_FORMAT;
+
+                    tree->stamps.push_back({ node, mtime, gitignore_mtime });
+                }
+
+                if ( not stamps_hold( *tree ))
+                    return Errors::STALE;
+
+                values.emplace_back( name, std::move( tree ));
+                break;
+            }
+
+            default:
+                return Errors::BAD_FORMAT;
+        }
+    }
+
+    if ( not reader.ok() )
+        return Errors::BAD_FORMAT;
+
+
+    for ( auto &[name, value] : values )
+        identifiers.find( name )->second.second = std::move( value );
+
+    return Errors::NONE;
+}
+
+
+ConfigCache::Errors ConfigCache::save(
+    const Parser::ident_map_t &identifiers
+) const {
+    std::uint64_t hash;
+
+    if ( not config_hash( hash ))
+        return Errors::OPEN_FAILED;
+
+
+    Writer writer;
+
+    writer.put_string( MAGIC );
+    writer.put( VERSION );
+    writer.put( hash );
+    writer.put_string( fs::current_path().string() );
+    writer.put( static_cast<std::uint32_t>( identifiers.size() ));
+
+    for ( const auto &[name, entry] : identifiers ) {
+        writer.put_string( name );
+
+        if ( const auto *text = std::get_if<std::string>( &entry.second )) {
+            writer.put( ValueKind::STRING );
+            writer.put_string( *text );
+
+        } else if ( const auto *number = std::get_if<std::int64_t>( &entry.second )) {
+            writer.put( ValueKind::NUMBER );
+            writer.put( *number );
+
+        } else {
+            const auto &tree = *std::get<std::shared_ptr<DirTree>>( entry.second );
+
+            writer.put( ValueKind::TREE );
+            writer.put_string( tree.get_root().get_name() );
+            writer.put( static_cast<std::uint32_t>( tree.nodes.size() ));
+
+            for ( std::size_t node = 1; node < tree.nodes.size(); node++ ) {
+                writer.put( tree.nodes[ node ].parent );
+                writer.put( tree.nodes[ node ].type );
+                writer.put_string( tree.nodes[ node ].get_name() );
+            }
+
+            writer.put( static_cast<std::uint32_t>( tree.stamps.size() ));
+
+            for ( const auto &[node, mtime, gitignore_mtime] : tree.stamps ) {
+                writer.put( node );
+                writer.put( mtime );
+                writer.put( gitignore_mtime );
+            }
+        }
+    }
+
+
+    /* Write aside and rename, a crash never leaves half a cache */
+    auto temporary = path;
+    temporary += ".tmp";
+
+    std::FILE *file = std::fopen( temporary.c_str(), "wb" );
+
+    if ( file == nullptr )
+        return Errors::OPEN_FAILED;
+
+    const auto &buffer  = writer.get_buffer();
+    const bool  written = std::fwrite( buffer.data(), 1, buffer.size(), file )
+                          == buffer.size();
+
+    if ( std::fclose( file ) != 0 or not written ) {
+        std::error_code ignored;
+        fs::remove( temporary, ignored );
+        return Errors::WRITE_FAILED;
+    }
+
+    std::error_code ec;
+    fs::rename( temporary, path, ec );
+
+    return ec ? Errors::WRITE_FAILED : Errors::NONE;
+}
+
+
+const std::filesystem::path &ConfigCache::get_path( void ) const {
+    return path;
+}
+
+
+ConfigCache::ConfigCache( const std::filesystem::path &_config )
+  : config { _config },
+    path   { _config.parent_path()
+             / ( "." + _config.filename().string() + ".cache" ) }
+{}
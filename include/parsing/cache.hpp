@@ -0,0 +1,71 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/parser.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+
+
+// ---- CONFIG CACHE ----
+//
+// Compiled form of a parsed configuration: every identifier value and
+// the expanded DirTree, stored next to the config as
+// `.<config name>.cache` and read back with one mmap.
+//
+// It is only trusted while the config hashes the same, the working
+// directory is the same and every directory a '*' expansion listed
+// (plus its .gitignore, when honored) keeps its mtime.
+//
+class ConfigCache {
+public:
+    // ---- CONSTRUCTORS ----
+    //
+    explicit ConfigCache( const std::filesystem::path &_config );
+
+
+    // ---- ERRORS TYPES ----
+    //
+    enum class Errors : std::uint8_t {
+        NONE,
+        OPEN_FAILED,
+        BAD_FORMAT,
+        STALE,
+        WRITE_FAILED
+    };
+
+
+    // ---- PERSISTENCE ----
+    //
+    /* `identifiers` is only modified when the whole cache is valid */
+    Errors load( Parser::ident_map_t &identifiers ) const;
+    // +
+    [[nodiscard]]
+    Errors save( const Parser::ident_map_t &identifiers ) const;
+
+
+    // ---- GETTERS ----
+    //
+    [[nodiscard]]
+    const std::filesystem::path &get_path( void ) const;
+
+
+private:
+    // ---- MAIN MEMBERS ----
+    //
+    std::filesystem::path config;
+    std::filesystem::path path;
+
+
+    // ---- KEY HELPERS ----
+    //
+    [[nodiscard]]
+    bool config_hash( std::uint64_t &hash ) const;
+    // +
+    [[nodiscard]]
+    static bool stamps_hold( const DirTree &tree );
+};
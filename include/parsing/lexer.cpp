@@ -1,18 +1,31 @@
 // ---- LOCAL INCLUDES ----
 #include "parsing/lexer.hpp"
+#include "utilities/byte_scan.hpp"
 
 
 // ---- EXTERNAL INCLUDES ----
 #include <fmt/core.h>
 
 
+// ---- STANDARD INCLUDES ----
+#include <cerrno>
+#include <cstring>
+
+
+// ---- SYSTEM INCLUDES ----
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
 bool Lexer::has_errors( void ) const {
     return _has_errors;
 }
 
 
-Token Lexer::make_token( const Token::Type  type,
-                         const std::string &value
+Token Lexer::make_token( const Token::Type      type,
+                         const std::string_view value
 ) {
     size_t char_pos = column - value.length();
 
@@ -27,54 +40,123 @@ Token Lexer::make_token( const Token::Type  type,
 }
 
 
-bool Lexer::load_prev_buffer() {
-    using std::streamoff, std::streampos;
-
-    if ( not file or eof_flag )
+bool Lexer::fill_buffer() {
+    if ( fd < 0 || eof_flag )
         return false;
 
-    streamoff back    = static_cast<streamoff>(BUFFER_SIZE * 2);
-    streampos new_pos = file_pos - back;
+    ssize_t count;
 
-    if (new_pos < 0)
-        return false;
-
-    file.seekg( new_pos );
+    do {
+        count = ::read( fd, buffer.data(), BUFFER_SIZE );
+    } while ( count < 0 and errno == EINTR );
 
-    if ( not file )
-        return false;
+    buffer_len = count > 0 ? static_cast<std::size_t>( count ) : 0;
+    buffer_pos = 0;
 
-    return fill_buffer();
+    return buffer_len > 0;
 }
 
 
-bool Lexer::fill_buffer() {
-    if ( not file || eof_flag )
-        return false;
+void Lexer::advance() {
+    /* Buffered input: the character left behind belongs to the token */
+    if ( mapping == nullptr and next_offset > 0 and not eof_flag )
+        pending.push_back( curr_char );
 
-    file_pos = file.tellg();
+    curr_offset = next_offset;
 
-    file.read( buffer.data(), BUFFER_SIZE );
+    if ( mapping != nullptr ) {
+        if ( next_offset == mapping_size ) {
+            eof_flag = true;
+            return;
+        }
 
-    buffer_len = static_cast<std::size_t>( file.gcount());
-    buffer_pos = 0;
+        curr_char = mapping[ next_offset ];
 
-    return buffer_len > 0;
+    } else {
+        if ( buffer_pos >= buffer_len and not fill_buffer() ) {
+            eof_flag = true;
+            return;
+        }
+
+        curr_char = buffer[ buffer_pos++ ];
+    }
+
+    next_offset++;
+    column++;
 }
 
 
-void Lexer::advance() {
-    if ( buffer_pos >= buffer_len ) {
-        if ( not fill_buffer()) {
-            eof_flag = true;
-            return;
+void Lexer::skip_until( char a, char b, char c ) {
+    while ( not eof_flag ) {
+        /* From curr_char to the end of what is already in memory */
+        const std::string_view window = mapping != nullptr
+            ? std::string_view( mapping + curr_offset, mapping_size - curr_offset )
+            : std::string_view( buffer.data() + buffer_pos - 1,
+                                buffer_len - buffer_pos + 1 );
+
+        const auto found = a == b and b == c
+            ? utils::find_byte( window, a )
+            : utils::find_any ( window, a, b, c );
+
+        /* Jump over everything but the last candidate in one step */
+        const auto skip = found == std::string_view::npos
+            ? window.size() - 1
+            : found;
+
+        if ( mapping == nullptr ) {
+            pending.append( window.data(), skip );
+            buffer_pos += skip;
         }
+
+        curr_offset += skip;
+        next_offset += skip;
+        column      += skip;
+        curr_char    = window[ skip ];
+
+        if ( found != std::string_view::npos )
+            return;
+
+        /* Last character of the window: move on, refilling if needed */
+        advance();
+
+        if ( not eof_flag and ( curr_char == a or curr_char == b or curr_char == c ))
+            return;
     }
+}
 
-    curr_char = buffer.at( buffer_pos );
 
-    buffer_pos++;
-    column++;
+void Lexer::begin_token() {
+    pending.clear();
+    pending_start = curr_offset;
+}
+
+
+std::size_t Lexer::mark() const {
+    return curr_offset;
+}
+
+
+std::string_view Lexer::slice( std::size_t start ) {
+    const auto length = curr_offset - start;
+
+    if ( mapping != nullptr )
+        return { mapping + start, length };
+
+
+    /* Chunks never move, so earlier slices stay valid */
+    if ( chunk_used + length > CHUNK_SIZE ) {
+        chunks.push_back(
+            std::make_unique<char[]>( std::max( length, CHUNK_SIZE ))
+        );
+        chunk_used = 0;
+    }
+
+    char *text = chunks.back().get() + chunk_used;
+
+    std::memcpy( text, pending.data() + ( start - pending_start ), length );
+    chunk_used = length > CHUNK_SIZE ? CHUNK_SIZE : chunk_used + length;
+
+    return { text, length };
 }
 
 
@@ -99,6 +181,8 @@ Token Lexer::get_next_token() {
         }
 
 
+        begin_token();
+
         if ( is_identifier_char( curr_char ))
             return tokenize_identifier();
 
@@ -122,27 +206,24 @@ Token Lexer::get_next_token() {
 
 Token Lexer::tokenize_number() {
     using enum Token::Type;
-    std::string value;
+    const auto start = mark();
 
-    while ( is_digit( curr_char )) {
-        value += curr_char;
+    while ( is_digit( curr_char ) and not eof_flag )
         advance();
-    }
 
-    if ( is_identifier_char( curr_char )) {
+    if ( is_identifier_char( curr_char ) and not eof_flag ) {
         while (
             is_identifier_char( curr_char ) || is_digit( curr_char )
         ) {
-            value += curr_char;
             advance();
 
             if ( eof_flag ) break;
         }
 
-        return make_token( INVALID_NUMBER, value );
+        return make_token( INVALID_NUMBER, slice( start ));
     }
 
-    return make_token( VALID_NUMBER, value );
+    return make_token( VALID_NUMBER, slice( start ));
 }
 
 
@@ -150,30 +231,31 @@ Token Lexer::tokenize_string() {
     using TOKEN = Token::Type;
 
     const char quote_type = curr_char;
-    std::string value;
+    const auto quote      = mark();
     advance();
 
+    /* Escapes are kept as written, the value is the raw content */
+    const auto start = mark();
+
     while ( not eof_flag && curr_char != quote_type ) {
         if ( curr_char == '\n' ) break;
 
         if ( curr_char == '\\' ) {
-            value += curr_char;
-
             advance();
             if ( eof_flag )
                 break;
 
-            value += curr_char;
+            advance();
             continue;
         }
 
-        value += curr_char;
-
-        advance();
+        skip_until( quote_type, '\\', '\n' );
     }
 
     if ( eof_flag || curr_char != quote_type )
-        return make_token( TOKEN::UNCLOSED_STRING, "\"" + value );
+        return make_token( TOKEN::UNCLOSED_STRING, slice( quote ));
+
+    const auto value = slice( start );
 
     advance();
     return make_token( TOKEN::STRING, value );
@@ -182,20 +264,30 @@ Token Lexer::tokenize_string() {
 
 Token Lexer::tokenize_symbol() {
     using enum Token::Type;
-    std::string symbol( 1, curr_char );
+    const auto start  = mark();
+    const char symbol = curr_char;
 
     advance();
 
-    switch ( symbol.at(0) ) {
+    switch ( symbol ) {
         case ':':
-            return make_token( ASSIGN, symbol );
+            return make_token( ASSIGN, slice( start ));
 
         case '-':
+            /* "-<digits>" is a negative number, "-d"/"-f" an indicator */
+            if ( is_digit( curr_char )) {
+                const auto number = tokenize_number();
+
+                return make_token( number.get_type(), slice( start ));
+            }
+
+            return make_token( PATH_INDICATOR, slice( start ));
+
         case '+':
-            return make_token( PATH_INDICATOR, symbol );
+            return make_token( PATH_INDICATOR, slice( start ));
 
         default:
-            return make_token( SYMBOL, symbol );
+            return make_token( SYMBOL, slice( start ));
     }
 }
 
@@ -203,19 +295,20 @@ Token Lexer::tokenize_symbol() {
 Token Lexer::tokenize_indent() {
     using enum Token::Type;
 
-    std::string indent_value;
+    const auto start = mark();
 
     bool has_spaces = false;
     bool has_tabs   = false;
 
-    while ( is_indent_char( curr_char )) {
+    while ( is_indent_char( curr_char ) and not eof_flag ) {
         if ( curr_char == ' '  ) has_spaces = true;
         if ( curr_char == '\t' ) has_tabs   = true;
 
-        indent_value += curr_char;
         advance();
     }
 
+    const auto indent_value = slice( start );
+
     if ( has_spaces && has_tabs )
         return make_token( INDENT_MIXED, indent_value );
 
@@ -228,22 +321,20 @@ Token Lexer::tokenize_indent() {
 
 
 void Lexer::skip_comment() {
-    while ( curr_char != '\n' && not eof_flag )
-        advance();
+    skip_until( '\n', '\n', '\n' );
 }
 
 
 Token Lexer::tokenize_identifier() {
-    std::string identifier;
+    const auto start = mark();
 
     while (is_identifier_char(curr_char)) {
-        identifier += curr_char;
         advance();
 
         if ( eof_flag ) break;
     }
 
-    return make_token( Token::Type::IDENTIFIER, identifier );
+    return make_token( Token::Type::IDENTIFIER, slice( start ));
 }
 
 
@@ -263,20 +354,52 @@ bool Lexer::is_indent_char ( const char &c ) {
 
 
 Lexer::Lexer ( const std::filesystem::path &_filepath )
-  : filepath { _filepath },
-    file     { _filepath, std::ios::in | std::ios::binary }
+  : filepath { _filepath == "-" ? "/dev/stdin" : _filepath }
 {
-    if ( file.is_open() ) {
-        buffer.resize( BUFFER_SIZE, 0 );
-        advance();
+    fd = ::open( filepath.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        _has_errors = true;
+
+        fmt::println( stderr, "File \"{}\"",
+                std::filesystem::absolute( filepath ).string()
+            );
+
+        fmt::println( stderr, "Error: {}", std::strerror( errno ));
         return;
     }
 
-    _has_errors = true;
 
-    fmt::println( stderr, "File \"{}\"",
-            std::filesystem::absolute( _filepath ).string()
-        );
+    /* Only a non-empty regular file can be mapped */
+    struct stat info {};
+
+    if ( ::fstat( fd, &info ) == 0 and S_ISREG( info.st_mode )
+         and info.st_size > 0 ) {
+        const auto size = static_cast<std::size_t>( info.st_size );
+        void      *data = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if ( data != MAP_FAILED ) {
+            ::madvise( data, size, MADV_SEQUENTIAL );
+
+            mapping      = static_cast<const char *>( data );
+            mapping_size = size;
+
+            ::close( fd );
+            fd = -1;
+        }
+    }
+
+    if ( mapping == nullptr )
+        buffer.resize( BUFFER_SIZE, 0 );
+
+    advance();
+}
+
+
+Lexer::~Lexer () {
+    if ( mapping != nullptr )
+        ::munmap( const_cast<char *>( mapping ), mapping_size );
 
-    fmt::println( stderr, "Error: {}", std::strerror( errno ));
+    if ( fd >= 0 )
+        ::close( fd );
 }
@@ -7,16 +7,35 @@
 
 // ---- STANDARD INCLUDES ----
 //
-#include <fstream>
 #include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 
+// ---- LEXER ----
+//
+// A regular file is mapped whole and token values are slices of the
+// mapping, no text is copied. Pipes and stdin ("-") cannot be mapped:
+// they are read through a small buffer and each token's text is copied
+// once into chunks owned by the lexer.
+//
+// Either way token values stay valid for the lexer's lifetime.
+//
 class Lexer {
 public:
     // ---- CONSTRUCTORS ----
     //
     explicit Lexer(const std::filesystem::path &_filepath);
+    // +
+    ~Lexer();
+
+
+    // ---- PROHIBIT COPY ----
+    //
+    Lexer( const Lexer& ) = delete;
+    Lexer& operator=( const Lexer& ) = delete;
 
 
     // ---- INPUT FILE PATH ----
@@ -44,9 +63,12 @@ public:
 
 
 private:
-    // ---- FILE STREAM ----
+    // ---- INPUT SOURCE ----
     //
-    std::ifstream file;
+    int fd = -1;
+    // +
+    const char  *mapping      = nullptr;   /* whole file, mapped mode */
+    std::size_t  mapping_size = 0;
 
 
     // ---- ERROR STATE ----
@@ -63,6 +85,9 @@ private:
     // +
     char  curr_char { '\0'  };
     bool  eof_flag  { false };
+    // +
+    std::size_t curr_offset = 0;   /* of curr_char in the input */
+    std::size_t next_offset = 0;
 
 
     // ---- BUFFER STATE ----
@@ -70,20 +95,46 @@ private:
     static constexpr std::size_t BUFFER_SIZE = 4096;
     std::vector<char> buffer;
     // +
-    std::size_t    buffer_pos = 0;
-    std::size_t    buffer_len = 0;
-    std::streampos file_pos   = 0;
+    std::size_t buffer_pos = 0;
+    std::size_t buffer_len = 0;
+
+
+    // ---- BUFFERED TOKEN TEXT ----
+    //
+    // Characters consumed since the current token began, from offset
+    // `pending_start`; slices are copied into fixed-size chunks.
+    //
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+    // +
+    std::string pending;
+    std::size_t pending_start = 0;
+    // +
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::size_t                          chunk_used = CHUNK_SIZE;
 
 
     // ---- BUFFER HANDLING ----
     //
-    bool fill_buffer     ( void );
-    bool load_prev_buffer( void );
+    bool fill_buffer( void );
 
 
     // ---- NAVIGATION METHODS ----
     //
     void advance ( void );
+    // +
+    /* Stops on the next `a`, `b` or `c` (or EOF) without looking at
+     * the characters in between one by one */
+    void skip_until( char a, char b, char c );
+
+
+    // ---- TOKEN TEXT ----
+    //
+    void begin_token( void );
+    // +
+    [[nodiscard]]
+    std::size_t      mark ( void ) const;
+    [[nodiscard]]
+    std::string_view slice( std::size_t start );
 
 
     // ---- SCANNING METHODS ----
@@ -99,7 +150,7 @@ private:
 
     // --- Creation Token:
     Token make_token(
-        const Token::Type  type,
-        const std::string &value
+        const Token::Type      type,
+        const std::string_view value
     );
 };
@@ -0,0 +1,659 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/matcher.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <mutex>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* A pathological "{a,b}{c,d}..." must not explode the rule count */
+    constexpr std::size_t MAX_EXPANSIONS = 256;
+
+
+    /* Index of the '}' closing the '{' at `open`, npos if unbalanced */
+    std::size_t closing_brace( std::string_view text, std::size_t open ) {
+        std::size_t depth = 0;
+
+        for ( std::size_t i = open; i < text.size(); i++ ) {
+            if ( text[i] == '\\' ) {
+                i++;
+                continue;
+            }
+
+            if ( text[i] == '{' )
+                depth++;
+
+            if ( text[i] == '}' and --depth == 0 )
+                return i;
+        }
+
+        return std::string_view::npos;
+    }
+
+
+    /* "{a,b}c" -> "ac", "bc". Braces without a top-level comma stay */
+    void expand_braces( std::string_view text,
+                        std::vector<std::string> &out
+    ) {
+        std::size_t open = std::string_view::npos;
+
+        for ( std::size_t i = 0; i < text.size(); i++ ) {
+            if ( text[i] == '\\' ) {
+                i++;
+                continue;
+            }
+
+            if ( text[i] == '{' ) {
+                open = i;
+                break;
+            }
+        }
+
+        const auto close = open == std::string_view::npos
+            ? std::string_view::npos
+            : closing_brace( text, open );
+
+        if ( close == std::string_view::npos ) {
+            if ( out.size() < MAX_EXPANSIONS )
+                out.emplace_back( text );
+            return;
+        }
+
+
+        const auto prefix = text.substr( 0, open );
+        const auto body   = text.substr( open + 1, close - open - 1 );
+        const auto suffix = text.substr( close + 1 );
+
+        std::vector<std::string_view> alternatives;
+        std::size_t depth = 0, start = 0;
+
+        for ( std::size_t i = 0; i < body.size(); i++ ) {
+            if ( body[i] == '\\' ) {
+                i++;
+                continue;
+            }
+
+            if ( body[i] == '{' ) depth++;
+            if ( body[i] == '}' ) depth--;
+
+            if ( body[i] == ',' and depth == 0 ) {
+                alternatives.push_back( body.substr( start, i - start ));
+                start = i + 1;
+            }
+        }
+
+        if ( alternatives.empty() ) {
+            /* Literal braces: keep them, expand whatever follows */
+            std::vector<std::string> rest;
+            expand_braces( suffix, rest );
+
+            for ( const auto &tail : rest ) {
+                if ( out.size() < MAX_EXPANSIONS )
+                    out.push_back( std::string( text.substr( 0, close + 1 )) + tail );
+            }
+            return;
+        }
+
+        alternatives.push_back( body.substr( start ));
+
+        for ( const auto alternative : alternatives ) {
+            expand_braces(
+                std::string( prefix ) + std::string( alternative )
+                    + std::string( suffix ),
+                out
+            );
+        }
+    }
+}
+
+
+/* --------------------- PATHMATCHER:: IMPLEMENTATION --------------------- */
+
+void PathMatcher::add_exclusion( std::string_view path, bool directory ) {
+    add_rule( path,
+        directory ? Applies::DIRECTORIES : Applies::FILES,
+        false,
+        true
+    );
+}
+
+
+void PathMatcher::add_gitignore( std::string_view contents ) {
+    while ( not contents.empty() ) {
+        const auto newline = contents.find( '\n' );
+        auto       line    = contents.substr( 0, newline );
+
+        contents.remove_prefix(
+            newline == std::string_view::npos ? contents.size() : newline + 1
+        );
+
+        if ( line.ends_with( '\r' ))
+            line.remove_suffix( 1 );
+
+        /* Trailing blanks are dropped unless escaped */
+        while ( line.ends_with( ' ' ) and not line.ends_with( "\\ " ))
+            line.remove_suffix( 1 );
+
+        if ( line.empty() or line.front() == '#' )
+            continue;
+
+
+        bool negated = false;
+
+        if ( line.front() == '!' ) {
+            negated = true;
+            line.remove_prefix( 1 );
+        }
+
+        auto applies = Applies::BOTH;
+
+        if ( line.ends_with( '/' )) {
+            applies = Applies::DIRECTORIES;
+
+            while ( line.ends_with( '/' ))
+                line.remove_suffix( 1 );
+        }
+
+        /* A slash anywhere but at the end anchors the rule */
+        add_rule( line, applies, negated, line.find( '/' ) != line.npos );
+    }
+}
+
+
+void PathMatcher::add_rule( std::string_view pattern,
+                            Applies applies,
+                            bool negated,
+                            bool anchored
+) {
+    std::vector<std::string> expanded;
+    expand_braces( pattern, expanded );
+
+    for ( const auto &text : expanded ) {
+        Rule rule { {}, applies, negated };
+
+        /* Unanchored: the rule may start at any depth */
+        if ( not anchored )
+            rule.components.push_back({ true, 0 });
+
+        std::string_view rest { text };
+
+        while ( not rest.empty() ) {
+            const auto slash     = rest.find( '/' );
+            const auto component = rest.substr( 0, slash );
+
+            rest.remove_prefix(
+                slash == std::string_view::npos ? rest.size() : slash + 1
+            );
+
+            if ( component.empty() or component == "." )
+                continue;
+
+            /* Consecutive "**" are the same as one */
+            if ( component == "**" ) {
+                if ( rule.components.empty()
+                     or not rule.components.back().any_depth )
+                    rule.components.push_back({ true, 0 });
+                continue;
+            }
+
+            rule.components.push_back({ false, intern_glob( component ) });
+        }
+
+        /* A pattern naming the selected directory itself excludes nothing */
+        if ( rule.components.empty() or
+             ( rule.components.size() == 1 and rule.components[0].any_depth ))
+            continue;
+
+        rules.push_back( std::move( rule ));
+    }
+}
+
+
+std::uint32_t PathMatcher::intern_glob( std::string_view text ) {
+    if ( const auto found = glob_ids.find( std::string( text ));
+         found != glob_ids.end() )
+        return found->second;
+
+    using Kind = GlobToken::Kind;
+
+    glob_t glob;
+
+    for ( std::size_t i = 0; i < text.size(); i++ ) {
+        const char c = text[i];
+
+        if ( c == '*' ) {
+            /* "a**b" inside a component is a plain star */
+            if ( glob.empty() or glob.back().kind != Kind::STAR )
+                glob.push_back({ Kind::STAR });
+            continue;
+        }
+
+        if ( c == '?' ) {
+            glob.push_back({ Kind::ANY });
+            continue;
+        }
+
+        if ( c == '\\' and i + 1 < text.size() ) {
+            glob.push_back({ Kind::LITERAL, static_cast<unsigned char>( text[ ++i ] ) });
+            continue;
+        }
+
+        if ( c == '[' ) {
+            std::bitset<256> set;
+            std::size_t j      = i + 1;
+            bool        negate = false;
+
+            if ( j < text.size() and ( text[j] == '!' or text[j] == '^' )) {
+                negate = true;
+                j++;
+            }
+
+            /* A ']' right after the opening is a member, not the end */
+            for ( bool first = true;
+                  j < text.size() and ( first or text[j] != ']' );
+                  first = false
+            ) {
+                unsigned char low = static_cast<unsigned char>( text[j] );
+
+                if ( low == '\\' and j + 1 < text.size() )
+                    low = static_cast<unsigned char>( text[ ++j ] );
+
+                unsigned char high = low;
+
+                if ( j + 2 < text.size() and text[ j + 1 ] == '-'
+                     and text[ j + 2 ] != ']' ) {
+                    high = static_cast<unsigned char>( text[ j + 2 ] );
+                    j   += 2;
+                }
+
+                for ( unsigned value = low; value <= high; value++ )
+                    set.set( value );
+
+                j++;
+            }
+
+            /* Unterminated: the '[' is a literal */
+            if ( j < text.size() ) {
+                if ( negate )
+                    set.flip();
+
+                glob.push_back({
+                    Kind::CLASS,
+                    0,
+                    static_cast<std::uint32_t>( sets.size() )
+                });
+
+                sets.push_back( set );
+                i = j;
+                continue;
+            }
+        }
+
+        glob.push_back({ Kind::LITERAL, static_cast<unsigned char>( c ) });
+    }
+
+
+    const auto id = static_cast<std::uint32_t>( globs.size() );
+
+    globs.push_back( std::move( glob ));
+    glob_ids.emplace( std::string( text ), id );
+
+    return id;
+}
+
+
+void PathMatcher::build_automaton( void ) {
+    using Kind = GlobToken::Kind;
+
+    /* Bytes every token treats alike share a class: "*.o" needs three
+     * columns ('.', 'o', anything else), not 256 */
+    std::map<std::vector<bool>, std::uint8_t> signatures;
+
+    for ( unsigned byte = 0; byte < 256; byte++ ) {
+        std::vector<bool> signature;
+
+        for ( const auto &glob : globs ) {
+            for ( const auto &token : glob ) {
+                if ( token.kind == Kind::LITERAL )
+                    signature.push_back( token.literal == byte );
+                else if ( token.kind == Kind::CLASS )
+                    signature.push_back( sets[ token.set ].test( byte ));
+            }
+        }
+
+        const auto [found, inserted] = signatures.emplace(
+            std::move( signature ),
+            static_cast<std::uint8_t>( signatures.size() )
+        );
+
+        automaton.byte_class[ byte ] = found->second;
+    }
+
+    automaton.classes = signatures.size();
+
+    automaton.table.clear();
+    automaton.accepting.clear();
+    automaton.positions.clear();
+    automaton.ids.clear();
+
+    (void)intern_glob_state( {} );    /* DEAD: no glob can match anymore */
+
+    glob_positions_t start;
+
+    for ( std::uint32_t glob = 0; glob < globs.size(); glob++ )
+        start.push_back( std::uint64_t( glob ) << 32 );
+
+    close_globs( start );
+    automaton.start = intern_glob_state( std::move( start ));
+}
+
+
+void PathMatcher::close_globs( glob_positions_t &positions ) const {
+    using Kind = GlobToken::Kind;
+
+    for ( std::size_t i = 0; i < positions.size(); i++ ) {
+        const auto glob  = static_cast<std::uint32_t>( positions[i] >> 32 );
+        const auto index = static_cast<std::uint32_t>( positions[i] );
+
+        /* A star may match nothing: the next token is live too */
+        if ( index < globs[ glob ].size()
+             and globs[ glob ][ index ].kind == Kind::STAR )
+            positions.push_back( positions[i] + 1 );
+    }
+
+    std::sort( positions.begin(), positions.end() );
+    positions.erase( std::unique( positions.begin(), positions.end() ),
+                     positions.end() );
+}
+
+
+std::uint32_t PathMatcher::intern_glob_state( glob_positions_t positions ) const {
+    const auto [found, inserted] = automaton.ids.emplace(
+        positions, static_cast<std::uint32_t>( automaton.positions.size() )
+    );
+
+    if ( not inserted )
+        return found->second;
+
+    std::vector<std::uint32_t> accepting;
+
+    for ( const auto position : positions ) {
+        const auto glob  = static_cast<std::uint32_t>( position >> 32 );
+        const auto index = static_cast<std::uint32_t>( position );
+
+        if ( index == globs[ glob ].size() )
+            accepting.push_back( glob );
+    }
+
+    /* The dead state loops on itself, every other edge is built on use */
+    automaton.table.resize(
+        ( automaton.positions.size() + 1 ) * automaton.classes,
+        found->second == Automaton::DEAD ? Automaton::DEAD : Automaton::UNKNOWN
+    );
+
+    automaton.accepting.push_back( std::move( accepting ));
+    automaton.positions.push_back( std::move( positions ));
+
+    return found->second;
+}
+
+
+std::uint32_t PathMatcher::advance_automaton( std::uint32_t state,
+                                              std::uint8_t cls,
+                                              unsigned char byte
+) const {
+    using Kind = GlobToken::Kind;
+
+    /* Subset construction over (glob, token index) positions, one
+     * edge at a time. Any byte of the class stands for all of them */
+    glob_positions_t next;
+
+    for ( const auto position : automaton.positions[ state ] ) {
+        const auto glob  = static_cast<std::uint32_t>( position >> 32 );
+        const auto index = static_cast<std::uint32_t>( position );
+
+        if ( index == globs[ glob ].size() )
+            continue;
+
+        const auto &token = globs[ glob ][ index ];
+
+        const bool consumed =
+               token.kind == Kind::ANY
+            or token.kind == Kind::STAR
+            or ( token.kind == Kind::LITERAL and token.literal == byte )
+            or ( token.kind == Kind::CLASS and sets[ token.set ].test( byte ));
+
+        if ( not consumed )
+            continue;
+
+        /* A star stays put, everything else moves on */
+        next.push_back( token.kind == Kind::STAR
+            ? position
+            : position + 1
+        );
+    }
+
+    close_globs( next );
+
+    const auto target = intern_glob_state( std::move( next ));
+    automaton.table[ state * automaton.classes + cls ] = target;
+
+    return target;
+}
+
+
+void PathMatcher::compile( void ) {
+    build_automaton();
+
+    /* State 0: every rule waiting for its first component */
+    positions_t start;
+
+    for ( std::uint64_t rule = 0; rule < rules.size(); rule++ )
+        start.push_back( rule << 32 );
+
+    close_positions( start );
+
+    states.clear();
+    state_ids.clear();
+    transitions.clear();
+
+    (void)intern_state( std::move( start ));
+}
+
+
+std::uint32_t PathMatcher::walk_automaton( std::string_view name ) const {
+    std::uint32_t state = automaton.start;
+
+    for ( const char c : name ) {
+        state = automaton.table[
+            state * automaton.classes
+            + automaton.byte_class[ static_cast<unsigned char>( c ) ]
+        ];
+
+        if ( state == Automaton::DEAD or state == Automaton::UNKNOWN )
+            break;
+    }
+
+    return state;
+}
+
+
+std::uint32_t PathMatcher::run_automaton( std::string_view name ) const {
+    std::uint32_t state = automaton.start;
+
+    for ( const char c : name ) {
+        const auto byte = static_cast<unsigned char>( c );
+        const auto cls  = automaton.byte_class[ byte ];
+
+        const auto next = automaton.table[ state * automaton.classes + cls ];
+
+        state = next == Automaton::UNKNOWN
+            ? advance_automaton( state, cls, byte )
+            : next;
+
+        if ( state == Automaton::DEAD )
+            break;
+    }
+
+    return state;
+}
+
+
+void PathMatcher::close_positions( positions_t &positions ) const {
+    for ( std::size_t i = 0; i < positions.size(); i++ ) {
+        const auto rule  = static_cast<std::uint32_t>( positions[i] >> 32 );
+        const auto index = static_cast<std::uint32_t>( positions[i] );
+
+        const auto &components = rules[ rule ].components;
+
+        /* "**" may span no directory at all */
+        if ( components[ index ].any_depth and index + 1 < components.size() )
+            positions.push_back( positions[i] + 1 );
+    }
+
+    std::sort( positions.begin(), positions.end() );
+    positions.erase( std::unique( positions.begin(), positions.end() ),
+                     positions.end() );
+}
+
+
+PathMatcher::state_t PathMatcher::intern_state( positions_t positions ) const {
+    if ( positions.empty() )
+        return NO_STATE;
+
+    const auto [found, inserted] = state_ids.emplace(
+        positions, static_cast<state_t>( states.size() )
+    );
+
+    if ( inserted )
+        states.push_back( std::move( positions ));
+
+    return found->second;
+}
+
+
+PathMatcher::Transition PathMatcher::compute( state_t state,
+                                              std::uint32_t matched
+) const {
+    const auto &accepting = automaton.accepting[ matched ];
+
+    const auto matches = [&]( std::uint32_t glob ) {
+        return std::binary_search( accepting.begin(), accepting.end(), glob );
+    };
+
+    positions_t next;
+
+    /* Rules are ordered: the last one matching decides */
+    std::int64_t last_file = -1, last_directory = -1;
+
+    const auto record = [&]( std::uint32_t rule ) {
+        if ( rules[ rule ].applies != Applies::DIRECTORIES )
+            last_file = std::max<std::int64_t>( last_file, rule );
+
+        if ( rules[ rule ].applies != Applies::FILES )
+            last_directory = std::max<std::int64_t>( last_directory, rule );
+    };
+
+
+    for ( const auto position : states[ state ] ) {
+        const auto rule  = static_cast<std::uint32_t>( position >> 32 );
+        const auto index = static_cast<std::uint32_t>( position );
+
+        const auto &components = rules[ rule ].components;
+        const auto &component  = components[ index ];
+
+        if ( component.any_depth ) {
+            /* A trailing "**": everything below matches */
+            if ( index + 1 == components.size() )
+                record( rule );
+
+            next.push_back( position );
+            continue;
+        }
+
+        if ( not matches( component.glob ))
+            continue;
+
+        if ( index + 1 == components.size() )
+            record( rule );
+        else
+            next.push_back( position + 1 );
+    }
+
+    close_positions( next );
+
+
+    const auto verdict = [&]( std::int64_t rule ) {
+        if ( rule < 0 )
+            return Verdict::NONE;
+
+        return rules[ rule ].negated ? Verdict::INCLUDE : Verdict::EXCLUDE;
+    };
+
+    return {
+        intern_state( std::move( next )),
+        verdict( last_file ),
+        verdict( last_directory )
+    };
+}
+
+
+PathMatcher::state_t PathMatcher::start( void ) const {
+    return states.empty() ? NO_STATE : 0;
+}
+
+
+PathMatcher::Step PathMatcher::step( state_t state,
+                                     std::string_view name,
+                                     bool directory
+) const {
+    if ( state == NO_STATE )
+        return { NO_STATE, Verdict::NONE };
+
+    const auto key_of = [&]( std::uint32_t matched ) {
+        return ( std::uint64_t( state ) << 32 ) | matched;
+    };
+
+    const auto pick = [&]( const Transition &transition ) {
+        /* A file has no children: its next state never matters */
+        return Step {
+            directory ? transition.next : NO_STATE,
+            directory ? transition.directories : transition.files
+        };
+    };
+
+    {
+        std::shared_lock lock { mutex };
+
+        const auto matched = walk_automaton( name );
+
+        if ( matched != Automaton::UNKNOWN ) {
+            if ( const auto found = transitions.find( key_of( matched ));
+                 found != transitions.end() )
+                return pick( found->second );
+        }
+    }
+
+    std::unique_lock lock { mutex };
+
+    const auto matched = run_automaton( name );
+
+    auto [found, inserted] = transitions.try_emplace( key_of( matched ));
+
+    if ( inserted )
+        found->second = compute( state, matched );
+
+    return pick( found->second );
+}
+
+
+bool PathMatcher::empty( void ) const {
+    return rules.empty();
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// ---- PATH MATCHER ----
+//
+// A set of path rules (the '-' lines of a '*' block, or one .gitignore
+// file) compiled into a two-level automaton:
+//
+//  - every distinct component glob ("*.o", "test_?", "{a,b}" after
+//    expansion) goes into one byte-level DFA, so an entry name is run
+//    through it once to learn all the globs it matches;
+//  - positions inside the rules (which component comes next, "**"
+//    spanning directories) form the states a walker keeps per
+//    directory.
+//
+// Both levels are determinized lazily and cached: only states some
+// name actually reaches are built, so a set of "*a*b*" globs cannot
+// blow up into the exponential DFA of every possible name.
+//
+// NO_STATE means no rule can match below, so that subtree needs no
+// more lookups. Rules later in the list win (gitignore '!' negation).
+//
+class PathMatcher {
+public:
+    // ---- TYPES ----
+    //
+    using state_t = std::uint32_t;
+    // +
+    static constexpr state_t NO_STATE = std::numeric_limits<state_t>::max();
+    // +
+    enum class Verdict : std::uint8_t {
+        NONE,       /* no rule matched            */
+        EXCLUDE,
+        INCLUDE     /* matched by a negated rule  */
+    };
+    // +
+    struct Step {
+        state_t next;
+        Verdict verdict;
+    };
+
+
+    // ---- CONSTRUCTORS ----
+    //
+    PathMatcher() = default;
+
+
+    // ---- PROHIBIT COPY ----
+    //
+    PathMatcher( const PathMatcher& ) = delete;
+    PathMatcher& operator=( const PathMatcher& ) = delete;
+
+
+    // ---- COMPILATION ----
+    //
+    /* Config exclusion, anchored at the selected directory */
+    void add_exclusion( std::string_view path, bool directory );
+    // +
+    /* Every rule of a .gitignore file, anchored at its directory */
+    void add_gitignore( std::string_view contents );
+    // +
+    /* Must run once after the last add_*() and before matching */
+    void compile( void );
+
+
+    // ---- MATCHING ----
+    //
+    [[nodiscard]]
+    state_t start( void ) const;
+    // +
+    [[nodiscard]]
+    Step step( state_t state,
+               std::string_view name,
+               bool directory ) const;
+    // +
+    [[nodiscard]]
+    bool empty( void ) const;
+
+
+private:
+    // ---- GLOB TOKENS ----
+    //
+    struct GlobToken {
+        enum class Kind : std::uint8_t {
+            LITERAL,    /* one byte                    */
+            ANY,        /* '?'                         */
+            STAR,       /* '*', any run of bytes       */
+            CLASS       /* '[...]', one byte of a set  */
+        };
+
+        Kind          kind;
+        unsigned char literal = 0;
+        std::uint32_t set     = 0;   /* index into `sets` */
+    };
+    // +
+    using glob_t = std::vector<GlobToken>;
+
+
+    // ---- RULES ----
+    //
+    enum class Applies : std::uint8_t {
+        FILES,
+        DIRECTORIES,
+        BOTH
+    };
+    // +
+    struct Component {
+        bool          any_depth;     /* "**" */
+        std::uint32_t glob;
+    };
+    // +
+    struct Rule {
+        std::vector<Component> components;
+        Applies                applies;
+        bool                   negated;
+    };
+
+
+    // ---- BYTE-LEVEL DFA ----
+    //
+    /* (glob << 32 | token index), sorted */
+    using glob_positions_t = std::vector<std::uint64_t>;
+    // +
+    struct Automaton {
+        std::array<std::uint8_t, 256> byte_class {};
+        std::size_t                   classes = 1;
+        // +
+        std::vector<std::uint32_t>              table;      /* state x class */
+        std::vector<std::vector<std::uint32_t>> accepting;  /* sorted globs  */
+        // +
+        std::vector<glob_positions_t>             positions;  /* per state */
+        std::map<glob_positions_t, std::uint32_t> ids;
+        // +
+        static constexpr std::uint32_t DEAD    = 0;
+        static constexpr std::uint32_t UNKNOWN = std::numeric_limits<std::uint32_t>::max();
+        std::uint32_t                  start   = DEAD;
+    };
+
+
+    // ---- DIRECTORY-LEVEL STATES ----
+    //
+    /* (rule << 32 | component index), sorted */
+    using positions_t = std::vector<std::uint64_t>;
+    // +
+    struct Transition {
+        state_t next;
+        Verdict files;
+        Verdict directories;
+    };
+
+
+    // ---- COMPILED RULES ----
+    //
+    std::vector<Rule>                     rules;
+    std::vector<glob_t>                   globs;
+    std::vector<std::bitset<256>>         sets;
+    std::map<std::string, std::uint32_t>  glob_ids;
+
+
+    // ---- LAZY DETERMINIZATION ----
+    //
+    /* Scanner threads share the matcher: readers take the lock shared
+     * and only a cache miss takes it exclusively */
+    mutable std::shared_mutex                            mutex;
+    mutable Automaton                                    automaton;
+    mutable std::vector<positions_t>                     states;
+    mutable std::map<positions_t, state_t>               state_ids;
+    mutable std::unordered_map<std::uint64_t, Transition> transitions;
+
+
+    // ---- COMPILATION HELPERS ----
+    //
+    void add_rule( std::string_view pattern,
+                   Applies applies,
+                   bool negated,
+                   bool anchored );
+    // +
+    std::uint32_t intern_glob( std::string_view text );
+    // +
+    void build_automaton( void );
+
+
+    // ---- MATCHING HELPERS ----
+    //
+    /* Only follows built states, UNKNOWN on a missing one (shared lock) */
+    [[nodiscard]]
+    std::uint32_t walk_automaton( std::string_view name ) const;
+    // +
+    /* Builds the states it is missing (exclusive lock) */
+    [[nodiscard]]
+    std::uint32_t run_automaton( std::string_view name ) const;
+    // +
+    void          close_globs      ( glob_positions_t &positions ) const;
+    std::uint32_t intern_glob_state( glob_positions_t positions ) const;
+    // +
+    std::uint32_t advance_automaton( std::uint32_t state,
+                                     std::uint8_t cls,
+                                     unsigned char byte ) const;
+    // +
+    void    close_positions( positions_t &positions ) const;
+    state_t intern_state   ( positions_t positions ) const;
+    // +
+    Transition compute( state_t state, std::uint32_t matched ) const;
+};
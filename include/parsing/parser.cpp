@@ -14,8 +14,30 @@
 //
 #include <charconv>
 #include <cstdint>
+#include <map>
 #include <string>
 #include <unordered_set>
+#include <vector>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* Identifiers whose string value must be one of a fixed set */
+    const std::map<std::string_view, std::vector<std::string_view>>
+    allowed_values {
+        { "archive_mode" , { "staged", "direct" } },
+        { "checksums"    , { "off"   , "on"     } },
+        { "compress_type", { "gzip"  , "zstd"   } },
+        { "dedup"        , { "off"   , "on"     } },
+        { "gitignore"    , { "off"   , "on"     } },
+        { "io_backend"   , { "threads", "uring" } },
+        { "link_mode"    , { "copy", "hardlink", "symlink", "auto" } },
+        { "seekable"     , { "off"   , "on"     } },
+        { "skip_incompressible", { "off", "on" } },
+    };
+}
 
 
 bool Parser::has_errors() const {
@@ -101,7 +123,7 @@ bool Parser::parsing() {
         }
 
 
-        const std::string identifier = token.get_value();
+        const std::string identifier { token.get_value() };
 
 
         if ( not main_identifiers.contains( identifier) )
@@ -144,9 +166,9 @@ Parser::validate_data_type( std::string_view identifier ) {
     /* consume assign token */
     advance();
 
-    ident_value_t raw_value   = token.get_value();
-    std::string   value_str   = token.get_value();
-    Token::Type   type_expect = main_identifiers.at(identifier).first;
+    ident_value_t    raw_value   = std::string( token.get_value() );
+    std::string_view value_str   = token.get_value();
+    Token::Type      type_expect = main_identifiers.at(identifier).first;
 
 
     if ( type_expect == PATHS_BLOCK and is_token( NEWLINE )) {
@@ -159,7 +181,7 @@ Parser::validate_data_type( std::string_view identifier ) {
     }
 
 
-    if ( is_token( STRING ) ) {
+    if ( is_token( STRING ) and type_expect != VALID_NUMBER ) {
         if ( token.get_value().empty() ) {
             report_error( "The value for '{}' cannot be an empty string.",
                 identifier
@@ -177,11 +199,14 @@ Parser::validate_data_type( std::string_view identifier ) {
             // TODO: Check if the string is a valid path
         }
 
+        if ( not validate_choice( identifier, value_str ))
+            return {};
+
         return raw_value;
     }
 
 
-    if ( is_token( VALID_NUMBER ) ) {
+    if ( is_token( VALID_NUMBER ) and type_expect == VALID_NUMBER ) {
         auto valid_int32 = parse_int32( value_str );
 
         if ( not valid_int32 ) {
@@ -193,9 +218,9 @@ Parser::validate_data_type( std::string_view identifier ) {
     }
 
 
-    std::string typestr { token.get_typestr() };
+    std::string typestr { token.get_typestr( type_expect ) };
 
-    report_error( "Expected valid {} for '{}' but got '{}'.",
+    report_error( "Expected {} for '{}' but got '{}'.",
         get_lowercase( typestr ),
         identifier,
         value_str
@@ -205,6 +230,34 @@ Parser::validate_data_type( std::string_view identifier ) {
 }
 
 
+bool Parser::validate_choice( std::string_view identifier,
+                              std::string_view value
+) {
+    const auto choices = allowed_values.find( identifier );
+
+    if ( choices == allowed_values.end() )
+        return true;
+
+    for ( const auto &choice : choices->second ) {
+        if ( choice == value )
+            return true;
+    }
+
+    std::string expected;
+
+    for ( const auto &choice : choices->second ) {
+        if ( not expected.empty() ) expected += ", ";
+        expected += "'" + std::string( choice ) + "'";
+    }
+
+    return report_error( "Invalid value '{}' for '{}', expected one of: {}.",
+        value,
+        identifier,
+        expected
+    );
+}
+
+
 std::string Parser::normalize_path( std::string_view path ) {
     // TODO: Remove extra trailing slashes "/"
     return std::string(path);
@@ -244,6 +297,10 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
 
     NodeType last_node_type = NodeType::IS_FILE;
     bool path_select_all = false;
+    bool last_excluded   = false;
+
+    /* Indent level of the entries inside the last '*' block, 0 if none */
+    std::size_t select_all_level = 0;
 
 
     while ( not is_token( END_OF_FILE )) {
@@ -291,6 +348,12 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
             );
 
 
+        if ( last_excluded and curr_indent_level > last_indent_level )
+            return report_error( indent_token,
+                "Excluded paths cannot contain entries."
+            );
+
+
         if ( last_node_type != NodeType::IS_DIRECTORY ) {
             if ( curr_indent_level > last_indent_level ) {
                 return report_error( indent_token,
@@ -310,20 +373,15 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
 
 
         const char type_indicator = token.get_value()[0];
+        const bool excluded       = type_indicator == '-';
 
 
-        // TODO: add support for excluded paths
-        if ( type_indicator == '-' ) {
-            return report_error(
-                "Invalid path indicator: '{}'",
-                token.get_value()
-            );
+        /* Leaving a '*' block: its level and deeper no longer apply */
+        if ( select_all_level > 0 and curr_indent_level < select_all_level )
+            select_all_level = 0;
 
-        }
-
-
-        /* reject '+' if previous directory used '*' */
-        if ( curr_indent_level > last_indent_level and path_select_all )
+        /* reject '+' inside a block whose directory used '*' */
+        if ( not excluded and select_all_level > 0 )
             return report_error(
                 "Redundant usage: '+' is not allowed within a block with '*'."
             );
@@ -339,7 +397,7 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
             );
 
 
-        const std::string path_identifier = token.get_value();
+        const std::string_view path_identifier = token.get_value();
 
 
         if ( path_identifier != "f" and path_identifier != "d" ) {
@@ -378,6 +436,13 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
                 );
             }
 
+            /* An excluded directory already takes all its content */
+            if ( excluded ) {
+                return report_error(
+                    "The '*' symbol is not valid for excluded paths."
+                );
+            }
+
             path_select_all = true;
             advance();
 
@@ -393,14 +458,30 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
         else skip_empty_lines();
 
 
+        /* Files never become the current node, only directories do */
         if ( curr_indent_level <= last_indent_level )
-            tree.ascend_levels(last_indent_level - curr_indent_level + 1);
+            tree.ascend_levels(
+                last_indent_level - curr_indent_level
+                + ( last_node_type == NodeType::IS_DIRECTORY ? 1 : 0 )
+            );
 
 
         const auto  path_name = normalize_path(path_token.get_value());
         const auto &curr_node = tree.get_curr_node();
 
 
+        /* Exclusions prune the '*' scan of the current directory, an
+         * explicitly included path always wins over them */
+        if ( excluded ) {
+            (void)tree.exclude( path_name, curr_node_type );
+
+            last_indent_level = curr_indent_level;
+            last_node_type    = NodeType::IS_FILE;
+            last_excluded     = true;
+            continue;
+        }
+
+
         if ( curr_node.get_children().contains( path_name ) )
             return report_error( path_token,
                 "Path '{}' duplicate.",
@@ -418,14 +499,16 @@ bool Parser::parse_paths_block( ident_value_t &raw_value ) {
             (void)tree.go_to_child( path_name);
 
 
-        if ( path_select_all )
-            tree.select_all_of(
-                tree.get_curr_node()
-            );
+        /* Scanned once the whole config (and its exclusions) is known */
+        if ( path_select_all ) {
+            tree.select_all();
+            select_all_level = curr_indent_level + 1;
+        }
 
 
         last_indent_level = curr_indent_level;
         last_node_type    = curr_node_type   ;
+        last_excluded     = false;
     }
 
     raw_value = std::move(tree_ptr);
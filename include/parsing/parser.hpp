@@ -108,6 +108,9 @@ private:
     validate_data_type( std::string_view identifier );
     // +
     bool validate_basename( std::string_view string ) const;
+    // +
+    bool validate_choice  ( std::string_view identifier,
+                            std::string_view value );
 
 
     // ---- REPORTING METHODS ----
@@ -0,0 +1,358 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/scanner.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    using NodeType = DirTree::NodeType;
+
+
+    /* Record layout returned by getdents64 */
+    struct linux_dirent64 {
+        ino64_t        d_ino;
+        off64_t        d_off;
+        unsigned short d_reclen;
+        unsigned char  d_type;
+        char           d_name[1];   /* NUL-terminated, d_reclen long */
+    };
+
+
+    constexpr std::size_t DIRENT_BUFFER = 64 * 1024;
+
+
+    /* The original walker followed symlinks: a link to a directory is
+     * listed as a directory, a dangling one as a file */
+    NodeType resolve_type( int dir_fd, const char *name ) {
+        struct stat info {};
+
+        if ( ::fstatat( dir_fd, name, &info, 0 ) == 0 and S_ISDIR( info.st_mode ))
+            return NodeType::IS_DIRECTORY;
+
+        return NodeType::IS_FILE;
+    }
+}
+
+
+DirScanner::Listing &DirScanner::new_listing( const Listing *parent,
+                                              PathMatcher::state_t state,
+                                              std::vector<Ignore> ignores
+) {
+    std::lock_guard lock { mutex };
+
+    auto &listing = listings.emplace_back();
+    listing.parent  = parent;
+    listing.state   = state;
+    listing.ignores = std::move( ignores );
+
+    return listing;
+}
+
+
+void DirScanner::enqueue( Listing &listing, std::string path ) {
+    pool.submit( [this, &listing, path = std::move( path )] {
+        (void)list_directory( listing, path );
+    });
+}
+
+
+bool DirScanner::list_directory( Listing &listing, const std::string &path ) {
+    const int fd = ::open( path.c_str(),
+        O_RDONLY | O_DIRECTORY | O_CLOEXEC
+    );
+
+    if ( fd < 0 ) {
+        fmt::println( stderr, "Cannot read directory '{}': {}",
+            path,
+            std::strerror( errno )
+        );
+        return false;
+    }
+
+
+    struct stat self {};
+
+    if ( ::fstat( fd, &self ) == 0 ) {
+        listing.device = self.st_dev;
+        listing.inode  = self.st_ino;
+        listing.mtime  = self.st_mtim.tv_sec * 1'000'000'000LL
+                       + self.st_mtim.tv_nsec;
+    }
+
+    /* 0 until one is read: creating it later changes `mtime` anyway */
+    if ( gitignore )
+        listing.gitignore_mtime = 0;
+
+    /* A followed symlink may point back at one of its own ancestors */
+    for ( const auto *above = listing.parent; above; above = above->parent ) {
+        if ( above->device == listing.device and above->inode == listing.inode ) {
+            fmt::println( stderr, "Skipping directory loop at '{}'", path );
+            ::close( fd );
+            return false;
+        }
+    }
+
+
+    std::array<char, DIRENT_BUFFER> buffer;
+    bool has_gitignore = false;
+
+    while ( true ) {
+        const auto count = ::syscall( SYS_getdents64, fd,
+            buffer.data(),
+            buffer.size()
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count <= 0 )
+            break;
+
+
+        for ( long offset = 0; offset < count; ) {
+            const auto *record = reinterpret_cast<const linux_dirent64 *>(
+                buffer.data() + offset
+            );
+            offset += record->d_reclen;
+
+            const std::string_view name { record->d_name };
+
+            if ( name == "." or name == ".." )
+                continue;
+
+
+            NodeType type = NodeType::IS_FILE;
+
+            switch ( record->d_type ) {
+                case DT_DIR:
+                    type = NodeType::IS_DIRECTORY;
+                    break;
+
+                case DT_LNK:
+                case DT_UNKNOWN:
+                    type = resolve_type( fd, record->d_name );
+                    break;
+
+                default:
+                    break;
+            }
+
+            if ( name == ".gitignore" and type == NodeType::IS_FILE )
+                has_gitignore = true;
+
+
+            listing.entries.push_back( Entry {
+                .offset = static_cast<std::uint32_t>( listing.names.size() ),
+                .length = static_cast<std::uint32_t>( name.size() ),
+                .type   = type
+            });
+
+            listing.names.append( name );
+        }
+    }
+
+
+    /* Its rules cover the entries listed next to it */
+    if ( gitignore and has_gitignore ) {
+        if ( const auto *rules = read_gitignore( fd, path, listing.gitignore_mtime ))
+            listing.ignores.push_back({ rules, rules->start() });
+    }
+
+    ::close( fd );
+
+
+    /* Pruned here: excluded directories are never opened */
+    struct Subdirectory {
+        std::string          path;
+        PathMatcher::state_t state;
+        std::vector<Ignore>  ignores;
+    };
+
+    std::vector<Subdirectory> subdirectories;
+    std::size_t kept = 0;
+
+    for ( const auto &entry : listing.entries ) {
+        const auto name      = listing.get_name( entry );
+        const bool directory = entry.type == NodeType::IS_DIRECTORY;
+
+        /* Git never tracks its own metadata */
+        if ( gitignore and directory and name == ".git" )
+            continue;
+
+        PathMatcher::state_t state;
+        std::vector<Ignore>  ignores;
+
+        if ( not keep_entry( listing, name, directory, state, ignores ))
+            continue;
+
+        listing.entries[ kept++ ] = entry;
+
+        if ( directory )
+            subdirectories.push_back({
+                path + '/' + std::string( name ),
+                state,
+                std::move( ignores )
+            });
+    }
+
+    listing.entries.resize( kept );
+
+
+    /* Queue the children only once this listing stops growing */
+    std::size_t next = 0;
+
+    for ( auto &entry : listing.entries ) {
+        if ( entry.type != NodeType::IS_DIRECTORY )
+            continue;
+
+        auto &[child_path, child_state, child_ignores] = subdirectories[ next++ ];
+        auto &child = new_listing( &listing,
+            child_state,
+            std::move( child_ignores )
+        );
+
+        entry.listing = &child;
+        enqueue( child, std::move( child_path ));
+    }
+
+    return true;
+}
+
+
+bool DirScanner::keep_entry( const Listing &listing,
+                             std::string_view name,
+                             bool directory,
+                             PathMatcher::state_t &state,
+                             std::vector<Ignore> &ignores
+) const {
+    using Verdict = PathMatcher::Verdict;
+
+    /* Config exclusions are final, no .gitignore can bring one back */
+    const auto step = matcher->step( listing.state, name, directory );
+    state = step.next;
+
+    if ( step.verdict == Verdict::EXCLUDE )
+        return false;
+
+
+    /* Deeper .gitignore files come later and override outer ones */
+    auto verdict = Verdict::NONE;
+
+    for ( const auto &[rules, current] : listing.ignores ) {
+        const auto ignore_step = rules->step( current, name, directory );
+
+        if ( ignore_step.verdict != Verdict::NONE )
+            verdict = ignore_step.verdict;
+
+        if ( ignore_step.next != PathMatcher::NO_STATE )
+            ignores.push_back({ rules, ignore_step.next });
+    }
+
+    return verdict != Verdict::EXCLUDE;
+}
+
+
+const PathMatcher *DirScanner::read_gitignore( int dir_fd,
+                                               const std::string &path,
+                                               std::int64_t &mtime
+) {
+    const int fd = ::openat( dir_fd, ".gitignore", O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        fmt::println( stderr, "Cannot read '{}/.gitignore': {}",
+            path,
+            std::strerror( errno )
+        );
+        return nullptr;
+    }
+
+
+    struct stat info {};
+
+    if ( ::fstat( fd, &info ) == 0 )
+        mtime = info.st_mtim.tv_sec * 1'000'000'000LL + info.st_mtim.tv_nsec;
+
+
+    std::string contents;
+    std::array<char, 16 * 1024> chunk;
+
+    while ( true ) {
+        const auto count = ::read( fd, chunk.data(), chunk.size() );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count <= 0 )
+            break;
+
+        contents.append( chunk.data(), static_cast<std::size_t>( count ));
+    }
+
+    ::close( fd );
+
+
+    PathMatcher *rules;
+
+    {
+        std::lock_guard lock { mutex };
+        rules = &ignore_files.emplace_back();
+    }
+
+    rules->add_gitignore( contents );
+    rules->compile();
+
+    return rules->empty() ? nullptr : rules;
+}
+
+
+const DirScanner::Listing *DirScanner::scan(
+    const std::filesystem::path &root,
+    const PathMatcher *excluded,
+    bool _gitignore
+) {
+    static const PathMatcher no_rules;
+
+    matcher   = excluded != nullptr ? excluded : &no_rules;
+    gitignore = _gitignore;
+
+    auto &listing = new_listing( nullptr, matcher->start(), {} );
+    auto  path    = root.string();
+
+    /* Children are joined with '/', drop the node's trailing one */
+    while ( path.size() > 1 and path.back() == '/' )
+        path.pop_back();
+
+    if ( not list_directory( listing, path ))
+        return nullptr;
+
+    pool.wait_idle();
+    return &listing;
+}
+
+
+DirScanner::DirScanner( std::size_t _workers )
+  : pool { _workers }
+{}
@@ -0,0 +1,136 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/matcher.hpp"
+#include "parsing/tree.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <sys/types.h>
+
+
+// ---- DIRECTORY SCANNER ----
+//
+// Lists a directory tree with getdents64, one task per directory on a
+// thread pool: every subdirectory found is queued right away, so wide
+// trees keep all workers busy. Entry types come from d_type; a stat is
+// only issued for symlinks and for filesystems reporting DT_UNKNOWN.
+//
+// Entries rejected by the optional PathMatcher are dropped while
+// listing, so an excluded directory is never opened. With `gitignore`
+// set, every .gitignore found is compiled once and applies to its own
+// directory and below, the deepest one deciding (as git does).
+//
+// Results are plain listings, the caller merges them into its DirTree
+// on one thread.
+//
+class DirScanner {
+public:
+    // ---- LISTINGS ----
+    //
+    struct Listing;
+    // +
+    struct Entry {
+        std::uint32_t     offset;            /* into Listing::names */
+        std::uint32_t     length;
+        DirTree::NodeType type;
+        const Listing    *listing = nullptr; /* set for directories */
+    };
+    // +
+    struct Ignore {
+        const PathMatcher   *matcher;
+        PathMatcher::state_t state;
+    };
+    // +
+    struct Listing {
+        std::string        names;
+        std::vector<Entry> entries;
+        // +
+        const Listing *parent = nullptr;
+        dev_t          device = 0;
+        ino_t          inode  = 0;
+        // +
+        std::int64_t   mtime           = 0;    /* nanoseconds           */
+        std::int64_t   gitignore_mtime = -1;   /* -1: not honored       */
+        // +
+        PathMatcher::state_t state = PathMatcher::NO_STATE;
+        std::vector<Ignore>  ignores;    /* outermost .gitignore first */
+
+        [[nodiscard]]
+        std::string_view get_name( const Entry &entry ) const {
+            return std::string_view( names ).substr( entry.offset, entry.length );
+        }
+    };
+
+
+    // ---- CONSTRUCTORS ----
+    //
+    explicit DirScanner( std::size_t _workers );
+
+
+    // ---- PROHIBIT COPY ----
+    //
+    DirScanner( const DirScanner& ) = delete;
+    DirScanner& operator=( const DirScanner& ) = delete;
+
+
+    // ---- MAIN METHODS ----
+    //
+    /* Blocks until the whole tree is listed, nullptr if `root` cannot
+     * be opened. Listings live as long as the scanner. */
+    const Listing *scan( const std::filesystem::path &root,
+                         const PathMatcher *excluded = nullptr,
+                         bool gitignore = false );
+
+
+private:
+    // ---- MAIN MEMBERS ----
+    //
+    utils::ThreadPool   pool;
+    std::deque<Listing> listings;   /* stable addresses while growing */
+    std::mutex          mutex;
+    // +
+    const PathMatcher  *matcher   = nullptr;
+    bool                gitignore = false;
+    // +
+    std::deque<PathMatcher> ignore_files;   /* one per .gitignore read */
+
+
+    // ---- WORKER TASKS ----
+    //
+    bool list_directory( Listing &listing, const std::string &path );
+    void enqueue       ( Listing &listing, std::string path );
+    // +
+    Listing &new_listing( const Listing *parent,
+                          PathMatcher::state_t state,
+                          std::vector<Ignore> ignores );
+
+
+    // ---- RULE HELPERS ----
+    //
+    /* Advances every matcher of `listing` past `name` */
+    [[nodiscard]]
+    bool keep_entry( const Listing &listing,
+                     std::string_view name,
+                     bool directory,
+                     PathMatcher::state_t &state,
+                     std::vector<Ignore> &ignores ) const;
+    // +
+    const PathMatcher *read_gitignore( int dir_fd,
+                                       const std::string &path,
+                                       std::int64_t &mtime );
+};
@@ -2,7 +2,7 @@
 #include "token.hpp"
 
 
-const std::string &Token::get_value() const {
+std::string_view Token::get_value() const {
     return this->value;
 }
 
@@ -53,7 +53,7 @@ Token::Token (
     const Token::Type &_type  ,
     const std::size_t &_line  ,
     const std::size_t &_column,
-    const std::string &_value
+    std::string_view   _value
 )
   : type   { _type   },
     line   { _line   },
@@ -35,7 +35,7 @@ public:
 
     // ---- GETTERS ----
     //
-    [[nodiscard]] const std::string& get_value () const;
+    [[nodiscard]] std::string_view   get_value () const;
     [[nodiscard]] std::size_t        get_line  () const;
     [[nodiscard]] std::size_t        get_column() const;
     [[nodiscard]] Type               get_type  () const;
@@ -50,7 +50,7 @@ public:
     Token ( const Token::Type &_type  ,
             const std::size_t &_line  ,
             const std::size_t &_column,
-            const std::string &_value  );
+            std::string_view   _value  );
     // +
     Token();
 
@@ -60,5 +60,5 @@ private:
     Token::Type type  ;
     std::size_t line  ;
     std::size_t column;
-    std::string value ;
+    std::string_view value;   /* into the lexer's input */
 };
@@ -1,6 +1,8 @@
 // ---- LOCAL INCLUDES ----
 //
 #include "parsing/tree.hpp"
+#include "parsing/scanner.hpp"
+#include "utilities/thread_pool.hpp"
 
 
 // ---- EXTERNAL INCLUDES ----
@@ -10,97 +12,160 @@
 
 // ---- STANDARD INCLUDES ----
 //
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <filesystem>
-#include <stack>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* Fibonacci hashing: spreads (parent, name) pairs over the table */
+    constexpr std::uint64_t GOLDEN_RATIO = 0x9E3779B97F4A7C15ULL;
+}
 
 
 /* ----------------------- DIRTREE:: IMPLEMENTATION ----------------------- */
 
 DirTree::Errors DirTree::add_child(
-    const std::string &name,
+    std::string_view name,
     NodeType type
 ) {
-    return (*curr_node).add_child( name, type );
+    return insert_child( curr_node, name, type );
 }
 
 
 DirTree::Errors DirTree::go_to_parent() {
     /* if curr_node is root */
-    if ( not (*curr_node).has_parent() )
+    if ( not nodes[ curr_node ].has_parent() )
         return Errors::NO_SUCH_PARENT;
 
-    curr_node = (*curr_node).get_parent();
+    curr_node = nodes[ curr_node ].parent;
     return Errors::NONE;
 }
 
 
 void DirTree::ascend_levels( size_t levels ) {
-    while ( levels --> 0 and (*curr_node).has_parent() )
+    while ( levels --> 0 and nodes[ curr_node ].has_parent() )
         (void)go_to_parent();
 }
 
 
-DirTree::Errors DirTree::go_to_child( const std::string& name ) {
-    const auto &node = (*curr_node).get_children().find(name);
+DirTree::Errors DirTree::go_to_child( std::string_view name ) {
+    const index_t name_id = names.find( name );
+    const index_t child   = name_id == NO_NODE
+        ? NO_NODE
+        : find_child( curr_node, name_id );
 
-    if ( node == (*curr_node).get_children().end() )
+    if ( child == NO_NODE )
         return Errors::NO_SUCH_CHILD;
 
 
-    curr_node = (*node).second.get();
+    curr_node = child;
     return Errors::NONE;
 }
 
 
-DirTree::Errors DirTree::select_all_of( const Node& node ) {
+void DirTree::select_all( void ) {
+    selections.push_back({ curr_node, std::make_unique<PathMatcher>() });
+}
+
+
+DirTree::Errors DirTree::exclude( std::string_view path, NodeType type ) {
+    /* Outside a '*' block only listed paths are included anyway */
+    if ( selections.empty() or selections.back().node != curr_node )
+        return Errors::NONE;
+
+    selections.back().excluded->add_exclusion( path,
+        type == NodeType::IS_DIRECTORY
+    );
+    return Errors::NONE;
+}
+
+
+void DirTree::expand_selections( bool gitignore ) {
+    const auto saved = curr_node;
+
+    /* A missing directory is reported later, when it is staged */
+    for ( const auto &selection : selections ) {
+        selection.excluded->compile();
+
+        (void)select_all_of( nodes[ selection.node ],
+            selection.excluded.get(),
+            gitignore
+        );
+    }
+
+    selections.clear();
+    curr_node = saved;
+}
+
+
+DirTree::Errors DirTree::select_all_of( const Node& node,
+                                        const PathMatcher *excluded,
+                                        bool gitignore
+) {
     namespace fs = std::filesystem;
 
     if ( not node.is_directory() )
         return Errors::INVALID_TYPE;
 
-    if ( not fs::exists( node.get_name() ))
-        return Errors::INVALID_PATH;
 
+    /* `node` may move while children are added: keep its index */
+    const auto selected = static_cast<index_t>( &node - nodes.data() );
+    const auto path     = fs::path( get_root().get_name() )
+                        / node.get_full_path();
+
+    DirScanner scanner { utils::ThreadPool::resolve_workers( 0 ) };
+
+    const auto *listing = scanner.scan( path, excluded, gitignore );
 
-    const auto firstIterator = fs::directory_iterator( node.get_name() );
+    if ( listing == nullptr )
+        return Errors::INVALID_PATH;
 
 
-    std::stack<fs::directory_iterator> stack {{
-        firstIterator
-    }};
+    /* Merge on this thread, parents before their children */
+    struct DirFrame {
+        const DirScanner::Listing *listing;
+        std::size_t                next;
+        index_t                    parent;
+    };
 
+    std::vector<DirFrame> stack {{ listing, 0, selected }};
+    stamps.push_back({ selected, listing->mtime, listing->gitignore_mtime });
 
     while ( not stack.empty() ) {
-        auto &dirEntry = stack.top();
+        auto &[current, next, parent] = stack.back();
 
-        if ( dirEntry == fs::directory_iterator{} ) {
-            stack.pop();
-            (void)go_to_parent();
+        if ( next == ( *current ).entries.size() ) {
+            stack.pop_back();
             continue;
         }
 
+        const auto &entry = ( *current ).entries[ next++ ];
 
-        const auto path_name = dirEntry->path().filename().string();
-        const auto type_path = dirEntry->is_directory()
-            ? NodeType::IS_DIRECTORY
-            : NodeType::IS_FILE;
-
+        if ( insert_child( parent, ( *current ).get_name( entry ), entry.type )
+             != Errors::NONE )
+            continue;
 
-        if ( add_child( path_name, type_path )  != Errors::NONE )
+        if ( entry.listing == nullptr )
             continue;
 
+        const auto child = static_cast<index_t>( nodes.size() - 1 );
 
-        if ( dirEntry->is_directory() ) {
-            go_to_child( path_name );
-            stack.push( fs::directory_iterator( dirEntry->path() ) );
-        }
+        stamps.push_back({
+            child,
+            entry.listing->mtime,
+            entry.listing->gitignore_mtime
+        });
 
-        dirEntry++;
+        stack.push_back({ entry.listing, 0, child });
     }
 
-    go_to_child( node.get_name() );
+    curr_node = selected;
 
     return Errors::NONE;
 }
@@ -192,32 +257,134 @@ std::filesystem::path DirTree::get_full_path_of( const Node& node ) {
         current_node = (*current_node).get_parent();
     }
 
-    std::filesystem::path full_path;
+    std::string full_path;
 
     for ( auto it = path_parts.rbegin(); it != path_parts.rend(); it++ ) {
-        full_path /= *it;
+        full_path = join_path( full_path, *it );
     }
 
     return full_path;
 }
 
 
+std::string DirTree::join_path( std::string_view parent,
+                                std::string_view name
+) {
+    std::string joined { parent };
+
+    /* Same result as path::operator/ for relative components */
+    if ( not joined.empty() and not joined.ends_with( '/' ))
+        joined.push_back( '/' );
+
+    joined.append( name );
+    return joined;
+}
+
+
+const DirTree::Node& DirTree::get_root( void ) const {
+    return nodes.front();
+}
+
+
+const DirTree::Node& DirTree::get_curr_node( void ) const {
+    return nodes[ curr_node ];
+}
+
+
+std::size_t DirTree::probe_child( index_t parent, index_t name ) const {
+    const std::size_t mask = child_slots.size() - 1;
+
+    const std::uint64_t key = ( std::uint64_t( parent ) << 32 ) | name;
+    std::size_t slot = static_cast<std::size_t>(
+        ( key * GOLDEN_RATIO ) >> 32
+    ) & mask;
+
+    /* Linear probing: stop at the match or at the first empty slot */
+    while ( child_slots[ slot ] != NO_NODE ) {
+        const auto &node = nodes[ child_slots[ slot ] ];
+
+        if ( node.parent == parent and node.name == name )
+            break;
+
+        slot = ( slot + 1 ) & mask;
+    }
+
+    return slot;
+}
+
+
+DirTree::index_t DirTree::find_child( index_t parent, index_t name ) const {
+    if ( child_slots.empty() )
+        return NO_NODE;
+
+    return child_slots[ probe_child( parent, name ) ];
+}
+
+
+void DirTree::grow_children( void ) {
+    child_slots.assign( std::max<std::size_t>( 64, child_slots.size() * 2 ),
+                        NO_NODE );
+
+    /* Every node but the root is someone's child */
+    for ( index_t index = 1; index < nodes.size(); index++ ) {
+        const auto &node = nodes[ index ];
+        child_slots[ probe_child( node.parent, node.name ) ] = index;
+    }
+}
+
+
+DirTree::Errors DirTree::insert_child( index_t parent,
+                                       std::string_view name,
+                                       NodeType type
+) {
+    if ( not nodes[ parent ].is_directory() )
+        return Errors::EXPECTED_DIRECTORY;
+
+    const index_t name_id = names.intern( name );
+
+    if ( find_child( parent, name_id ) != NO_NODE )
+        return Errors::ALREADY_EXISTS;
+
+
+    const auto index = static_cast<index_t>( nodes.size() );
+
+    nodes.emplace_back( this, name_id, type, parent );
+
+    /* Keep the table at most half full */
+    if ( nodes.size() * 2 > child_slots.size() )
+        grow_children();
+    else
+        child_slots[ probe_child( parent, name_id ) ] = index;
+
+
+    auto &owner = nodes[ parent ];
+
+    if ( owner.last_child == NO_NODE )
+        owner.first_child = index;
+    else
+        nodes[ owner.last_child ].next_sibling = index;
+
+    owner.last_child = index;
+
+    return Errors::NONE;
+}
+
+
 DirTree::DirTree ()
-  : root      { std::make_unique<Node>( "./", NodeType::IS_DIRECTORY ) },
-    curr_node { root.get() }
+  : DirTree( "./" )
 {
     namespace fs = std::filesystem;
 
-    if ( not fs::exists( (*root).get_name() ) ) {
+    if ( not fs::exists( get_root().get_name() ) ) {
         curr_error = Errors::INVALID_PATH;
     }
 }
 
 
 DirTree::DirTree (const std::string &_root_name)
-  : root      { std::make_unique<Node>( _root_name, NodeType::IS_DIRECTORY ) },
-    curr_node { root.get() }
-{}
+{
+    nodes.emplace_back( this, names.intern( _root_name ), NodeType::IS_DIRECTORY );
+}
 
 
 /* -------------------- DIRTREE::NODE:: IMPLEMENTATION -------------------- */
@@ -228,73 +395,191 @@ bool DirTree::Node::is_directory( void ) const {
 }
 
 
-const DirTree::Node& DirTree::get_root( void ) const {
-    return *root.get();
+std::string   DirTree::Node::get_full_path( void ) const {
+    return get_full_path_of( *this );
 }
 
 
-const DirTree::Node& DirTree::get_curr_node( void ) const {
-    return *curr_node;
+bool DirTree::Node::has_parent( void ) const {
+    return this->parent != NO_NODE;
 }
 
 
-std::string   DirTree::Node::get_full_path( void ) const {
-    return get_full_path_of( *this );
+DirTree::NodeType DirTree::Node::get_type( void ) const {
+    return type;
 }
 
 
-bool DirTree::Node::has_parent( void ) const {
-    return this->parent != nullptr;
+std::string_view DirTree::Node::get_name( void ) const {
+    return ( *tree ).names.get( name );
 }
 
 
-const std::string &DirTree::Node::get_name( void ) const {
-    return name;
+DirTree::children_node_t DirTree::Node::get_children( void ) const {
+    return { tree, static_cast<index_t>( this - ( *tree ).nodes.data() ) };
 }
 
 
-const DirTree::children_node_t &DirTree::Node::get_children( void ) const {
-    return children;
+const DirTree::Node *DirTree::Node::get_parent( void ) const {
+    if ( not has_parent() )
+        return nullptr;
+
+    return &( *tree ).nodes[ parent ];
 }
 
 
-DirTree::Node *DirTree::Node::get_parent( void ) const {
-    return parent;
+DirTree::Node::Node (
+    const DirTree *_tree  ,
+    index_t        _name  ,
+    NodeType       _type  ,
+    index_t        _parent
+)
+  : tree   { _tree   },
+    name   { _name   },
+    parent { _parent },
+    type   { _type   }
+{}
+
+
+/* ------------------ DIRTREE::CHILDREN:: IMPLEMENTATION ------------------ */
+
+
+DirTree::Children::Children( const DirTree *_tree, index_t _parent )
+  : tree   { _tree   },
+    parent { _parent }
+{}
+
+
+DirTree::Children::const_iterator DirTree::Children::begin( void ) const {
+    return { tree, ( *tree ).nodes[ parent ].first_child };
 }
 
 
-DirTree::Errors DirTree::Node::add_child (
-    const std::string &_name,
-    NodeType _type
-) {
-    auto &current_node = *this;
+DirTree::Children::const_iterator DirTree::Children::end( void ) const {
+    return { tree, NO_NODE };
+}
 
-    if ( not current_node.is_directory() )
-        return Errors::EXPECTED_DIRECTORY;
 
-    else if ( current_node.children.contains(name) )
-        return Errors::ALREADY_EXISTS;
+bool DirTree::Children::empty( void ) const {
+    return ( *tree ).nodes[ parent ].first_child == NO_NODE;
+}
 
 
-    current_node.children.insert( {
-        _name,
-        std::make_unique<Node>(
-            _name,
-            _type,
-            &current_node
-        )
-    });
+bool DirTree::Children::contains( std::string_view name ) const {
+    const index_t name_id = ( *tree ).names.find( name );
 
-    return Errors::NONE;
+    return name_id != NO_NODE
+       and ( *tree ).find_child( parent, name_id ) != NO_NODE;
 }
 
 
-DirTree::Node::Node (
-    const std::string &_name ,
-    NodeType           _type ,
-    Node              *_parent
-)
-  : name   { _name   },
-    type   { _type   },
-    parent { _parent }
+DirTree::Children::const_iterator::const_iterator( const DirTree *_tree,
+                                                   index_t _index )
+  : tree  { _tree  },
+    index { _index }
 {}
+
+
+DirTree::Children::value_type
+DirTree::Children::const_iterator::operator*( void ) const {
+    const auto &node = ( *tree ).nodes[ index ];
+
+    return { node.get_name(), &node };
+}
+
+
+const DirTree::Children::value_type *
+DirTree::Children::const_iterator::operator->( void ) const {
+    current = **this;
+    return &current;
+}
+
+
+DirTree::Children::const_iterator &
+DirTree::Children::const_iterator::operator++( void ) {
+    index = ( *tree ).nodes[ index ].next_sibling;
+    return *this;
+}
+
+
+DirTree::Children::const_iterator
+DirTree::Children::const_iterator::operator++( int ) {
+    auto previous = *this;
+    ++*this;
+    return previous;
+}
+
+
+bool DirTree::Children::const_iterator::operator==(
+    const const_iterator &other
+) const {
+    return index == other.index;
+}
+
+
+/* ------------------ DIRTREE::NAMETABLE:: IMPLEMENTATION ----------------- */
+
+
+std::size_t DirTree::NameTable::probe( std::string_view name ) const {
+    const std::size_t mask = slots.size() - 1;
+
+    std::size_t slot = std::hash<std::string_view>{}( name ) & mask;
+
+    while ( slots[ slot ] != NO_NODE and names[ slots[ slot ]] != name )
+        slot = ( slot + 1 ) & mask;
+
+    return slot;
+}
+
+
+void DirTree::NameTable::grow( void ) {
+    slots.assign( std::max<std::size_t>( 64, slots.size() * 2 ), NO_NODE );
+
+    for ( index_t id = 0; id < names.size(); id++ )
+        slots[ probe( names[ id ] ) ] = id;
+}
+
+
+DirTree::index_t DirTree::NameTable::find( std::string_view name ) const {
+    if ( slots.empty() )
+        return NO_NODE;
+
+    return slots[ probe( name ) ];
+}
+
+
+DirTree::index_t DirTree::NameTable::intern( std::string_view name ) {
+    if ( const index_t id = find( name ); id != NO_NODE )
+        return id;
+
+
+    /* Names never straddle chunks, oversized ones get their own */
+    if ( chunks.empty() or chunk_used + name.size() > CHUNK_SIZE ) {
+        chunks.push_back(
+            std::make_unique<char[]>( std::max( CHUNK_SIZE, name.size() ))
+        );
+        chunk_used = 0;
+    }
+
+    char *stored = chunks.back().get() + chunk_used;
+
+    std::memcpy( stored, name.data(), name.size() );
+    chunk_used += name.size();
+
+
+    const auto id = static_cast<index_t>( names.size() );
+
+    names.emplace_back( stored, name.size() );
+
+    if ( names.size() * 2 > slots.size() )
+        grow();
+    else
+        slots[ probe( name ) ] = id;
+
+    return id;
+}
+
+
+std::string_view DirTree::NameTable::get( index_t id ) const {
+    return names[ id ];
+}
@@ -1,12 +1,32 @@
 #pragma once
 
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/matcher.hpp"
+
+
 // ---- STANDARD INCLUDES ----
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
-#include <unordered_map>
-
-
+#include <string_view>
+#include <vector>
+
+
+// ---- DIRECTORY TREE ----
+//
+// Nodes live contiguously in one vector and link to each other by index
+// (parent, first/last child, next sibling); names are interned once per
+// tree. A child lookup by name goes through a flat open-addressing table
+// keyed on (parent, name), so no per-node heap allocation is made.
+//
+// Adding nodes may grow the vector: Node references are only stable
+// while the tree is not modified.
+//
 class DirTree {
 public:
 
@@ -16,6 +36,12 @@ public:
     DirTree( const std::string& _root_name );
 
 
+    // ---- PROHIBIT COPY ----
+    //
+    DirTree( const DirTree& ) = delete;
+    DirTree& operator=( const DirTree& ) = delete;
+
+
     // ---- ERRORS TYPES ----
     //
     enum class Errors : std::uint8_t {
@@ -48,8 +74,8 @@ public:
     //
     [[nodiscard]]
     Errors go_to_parent( void );
-    Errors go_to_child ( const std::string& name );
-    Errors add_child   ( const std::string& name,
+    Errors go_to_child ( std::string_view name );
+    Errors add_child   ( std::string_view name,
                          NodeType type = NodeType::IS_DIRECTORY );
     // +
     void ascend_levels( std::size_t levels );
@@ -70,26 +96,101 @@ public:
 
 private:
 
+    // ---- INDEX TYPES ----
+    //
+    using index_t = std::uint32_t;
+    // +
+    static constexpr index_t NO_NODE = std::numeric_limits<index_t>::max();
+
+
+    struct Node;
+
+
+    // ---- CHILDREN VIEW ----
+    //
+    // Range over the children of one node, in insertion order. Elements
+    // expose `first` (name) and `second` (node pointer), the same shape
+    // the former map of children had.
+    //
+    class Children {
+    public:
+        struct value_type {
+            std::string_view first;
+            const Node      *second;
+        };
+
+
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type   = std::ptrdiff_t;
+            using value_type        = Children::value_type;
+            using pointer           = const value_type*;
+            using reference         = value_type;
+
+            const_iterator() = default;
+            const_iterator( const DirTree *_tree, index_t _index );
+
+            [[nodiscard]]
+            value_type        operator* ( void ) const;
+            const value_type *operator->( void ) const;
+            // +
+            const_iterator &operator++( void );
+            const_iterator  operator++( int );
+            // +
+            bool operator==( const const_iterator &other ) const;
+
+        private:
+            const DirTree *tree  = nullptr;
+            index_t        index = NO_NODE;
+            // +
+            mutable value_type current {};
+        };
+
+
+        Children( const DirTree *_tree, index_t _parent );
+
+        [[nodiscard]]
+        const_iterator begin( void ) const;
+        [[nodiscard]]
+        const_iterator end  ( void ) const;
+        // +
+        [[nodiscard]]
+        bool empty   ( void ) const;
+        [[nodiscard]]
+        bool contains( std::string_view name ) const;
+
+    private:
+        const DirTree *tree;
+        index_t        parent;
+    };
+
+
     struct Node {
     private:
         // ---- BASIC PROPERTIES ----
         //
-        std::string name;
-        NodeType    type;
-        Node     *parent;
+        const DirTree *tree;
+        index_t        name;
+        index_t        parent;
+        NodeType       type;
 
 
-        // ---- CHILDREN MANAGEMENT ----
+        // ---- SIBLING LINKS ----
         //
-        std::unordered_map<
-            std::string /* name of child */,
-            std::unique_ptr<Node>> children {};
+        index_t first_child  = NO_NODE;
+        index_t last_child   = NO_NODE;
+        index_t next_sibling = NO_NODE;
+
+
+        friend class DirTree;
+        friend class ConfigCache;
 
 
     public:
         // ---- TYPEDEFS ----
         //
-        using children_t = decltype( children );
+        using children_t = Children;
 
 
         // ---- HELPER METHODS ----
@@ -110,43 +211,98 @@ private:
         NodeType          get_type      ( void ) const;
         // +
         [[nodiscard]]
-        const std::string &get_name     ( void ) const;
+        std::string_view  get_name      ( void ) const;
         // +
         [[nodiscard]]
-        Node              *get_parent   ( void ) const;
+        const Node        *get_parent   ( void ) const;
         // +
         [[nodiscard]]
-        const children_t  &get_children ( void ) const;
-
-
-        // ---- CHILDREN MANAGEMENT ----
-        //
-        Errors add_child( const std::string& _name,
-                          NodeType _type);
+        children_t        get_children  ( void ) const;
 
 
         // ---- CONSTRUCTOR ----
         //
-        Node ( const std::string &_name,
+        Node ( const DirTree *_tree,
+               index_t _name,
                NodeType _type,
-               Node *_parent = nullptr );
+               index_t _parent = NO_NODE );
 
 
         // ---- PROHIBIT COPY ----
         //
         Node( const Node& ) = delete;
         Node& operator=( const Node& ) = delete;
+        // +
+        Node( Node&& ) = default;
+        Node& operator=( Node&& ) = default;
     };
 
 
-    // ---- ROOT OF TREE ----
+    // ---- NAME TABLE ----
     //
-    std::unique_ptr<Node> root;
+    // Each distinct name is copied once into fixed-size chunks and given
+    // an id; nodes only store that id.
+    //
+    class NameTable {
+    public:
+        [[nodiscard]]
+        index_t intern( std::string_view name );
+        // +
+        [[nodiscard]]
+        index_t find  ( std::string_view name ) const;
+        // +
+        [[nodiscard]]
+        std::string_view get( index_t id ) const;
+
+    private:
+        static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        std::size_t                          chunk_used = 0;
+        // +
+        std::vector<std::string_view> names;
+        std::vector<index_t>          slots;    /* open addressing */
+
+        [[nodiscard]]
+        std::size_t probe( std::string_view name ) const;
+        void        grow ( void );
+    };
+
+
+    // ---- SCAN STAMPS ----
+    //
+    // mtime of every directory a '*' expansion listed, and of its
+    // .gitignore (-1 when not honored). While all of them hold, scanning
+    // again would add the same nodes.
+    //
+    struct Stamp {
+        index_t      node;
+        std::int64_t mtime;
+        std::int64_t gitignore_mtime;
+    };
+
+
+    // ---- PENDING '*' SELECTIONS ----
+    //
+    struct Selection {
+        index_t                      node;
+        std::unique_ptr<PathMatcher> excluded;
+    };
+
+
+    // ---- NODE STORAGE ----
+    //
+    std::vector<Node>    nodes;
+    NameTable            names;
+    std::vector<index_t> child_slots;   /* (parent, name) -> node */
+    // +
+    std::vector<Selection> selections;
+    std::vector<Stamp>     stamps;
 
 
     // ---- CURRENT NODE ----
     //
-    Node* curr_node;
+    index_t curr_node = 0;
 
 
     // ---- ERROR STATE ----
@@ -154,9 +310,27 @@ private:
     Errors curr_error = Errors::NONE;
 
 
+    /* Serializes nodes and stamps as they are stored */
+    friend class ConfigCache;
+
+
+    // ---- STORAGE HELPERS ----
+    //
+    [[nodiscard]]
+    index_t     find_child ( index_t parent, index_t name ) const;
+    [[nodiscard]]
+    std::size_t probe_child( index_t parent, index_t name ) const;
+    // +
+    Errors insert_child( index_t parent,
+                         std::string_view name,
+                         NodeType type );
+    void   grow_children( void );
+
+
 public:
     // ---- TYPEDEFS ----
     //
+    using node_t          = Node;
     using children_node_t = Node::children_t;
 
     // ---- GETTERS ----
@@ -165,8 +339,27 @@ public:
     const Node& get_curr_node( void ) const;
     // +
     static std::filesystem::path get_full_path_of( const Node& node );
+    // +
+    /* Relative path of `name` inside `parent`, walkers build it as they
+     * descend instead of asking every node for its full path */
+    static std::string join_path( std::string_view parent,
+                                  std::string_view name );
 
     // ---- ACTIONS ----
     //
-    Errors select_all_of( const Node& node );
+    Errors select_all_of( const Node& node,
+                          const PathMatcher *excluded = nullptr,
+                          bool gitignore = false );
+
+
+    // ---- DEFERRED '*' EXPANSION ----
+    //
+    // The parser marks '*' directories and records the exclusions of
+    // their block; expand_selections() then scans each one once, with
+    // its exclusions compiled in, once the whole config is known
+    // (`gitignore` also honors the .gitignore files met on the way).
+    //
+    void   select_all( void );
+    Errors exclude   ( std::string_view path, NodeType type );
+    void   expand_selections( bool gitignore = false );
 };
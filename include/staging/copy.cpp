@@ -0,0 +1,585 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "staging/copy.hpp"
+#include "staging/kernel_copy.hpp"
+#include "staging/uring_copy.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+    using Node = DirTree::node_t;
+
+
+    // ---- LINK MODES ----
+    //
+    enum class LinkMode : std::uint8_t {
+        COPY,       /* always copy the data                          */
+        HARDLINK,   /* hardlink, error when crossing a device        */
+        SYMLINK,    /* absolute symlink to the source                */
+        AUTO        /* hardlink on the same device, copy otherwise   */
+    };
+    // +
+    LinkMode parse_link_mode( std::string_view mode ) {
+        if ( mode == "hardlink" ) return LinkMode::HARDLINK;
+        if ( mode == "symlink"  ) return LinkMode::SYMLINK;
+        if ( mode == "auto"     ) return LinkMode::AUTO;
+
+        return LinkMode::COPY;
+    }
+
+
+    // ---- DIRECTORY HANDLE ----
+    //
+    // Source and target directories of one node, opened once. Children
+    // are resolved relative to these fds, so the kernel never walks the
+    // full path again; the last task holding the handle closes them.
+    //
+    struct DirHandle {
+        int         source = -1;
+        int         target = -1;
+        std::string relative;       /* "" for the project root */
+        // +
+        std::atomic<std::size_t> *open = nullptr;   /* live handle count */
+
+        DirHandle() = default;
+
+        DirHandle( const DirHandle& ) = delete;
+        DirHandle& operator=( const DirHandle& ) = delete;
+
+        ~DirHandle() {
+            if ( source >= 0 ) ::close( source );
+            if ( target >= 0 ) ::close( target );
+
+            if ( open != nullptr )
+                open->fetch_sub( 1, std::memory_order_relaxed );
+        }
+    };
+    // +
+    using handle_t = std::shared_ptr<const DirHandle>;
+
+
+    // ---- FILE DESCRIPTOR BUDGET ----
+    //
+    /* Left for the copies themselves, the pool and the standard streams */
+    constexpr rlim_t RESERVED_FDS   = 64;
+    constexpr rlim_t FDS_PER_WORKER = 4;    /* source, target, splice pipe */
+
+
+    /* Queued directories keep their fds open: allow as many as we may,
+     * returns how many handles (two fds each) may be held at once */
+    std::size_t raise_fd_limit( std::size_t workers ) {
+        struct rlimit limit {};
+
+        if ( ::getrlimit( RLIMIT_NOFILE, &limit ) != 0 )
+            return 0;
+
+        if ( limit.rlim_cur < limit.rlim_max ) {
+            limit.rlim_cur = limit.rlim_max;
+
+            if ( ::setrlimit( RLIMIT_NOFILE, &limit ) != 0 )
+                ::getrlimit( RLIMIT_NOFILE, &limit );
+        }
+
+        if ( limit.rlim_cur == RLIM_INFINITY )
+            return SIZE_MAX;
+
+        const auto reserved = RESERVED_FDS + FDS_PER_WORKER * workers;
+
+        if ( limit.rlim_cur <= reserved )
+            return 0;
+
+        return static_cast<std::size_t>(( limit.rlim_cur - reserved ) / 2 );
+    }
+
+
+    std::error_code last_error( void ) {
+        return { errno, std::generic_category() };
+    }
+
+
+    // ---- COPY ENGINE ----
+    //
+    // Threaded backend: every directory task creates its directory and
+    // then queues its children, so the pool always sees parents before
+    // their contents.
+    //
+    // io_uring backend: directories are created in tree order on the
+    // calling thread, then all files go through one ring.
+    //
+    class CopyEngine {
+    public:
+        CopyEngine( const fs::path         &_root,
+                    const fs::path         &_target,
+                    LinkMode                _link_mode,
+                    const staging::Changes *_changes )
+          : root      { _root      },
+            target    { _target    },
+            link_mode { _link_mode },
+            changes   { _changes   }
+        {}
+
+
+        bool run( const Node &root_node, std::size_t workers ) {
+            const auto handle = open_root();
+
+            if ( handle == nullptr )
+                return false;
+
+            max_handles = raise_fd_limit( workers );
+            pool.emplace( workers );
+
+            enqueue_children( root_node, handle );
+            pool->wait_idle();
+
+            print_summary( copier.get_summary() );
+            return failures.load() == 0;
+        }
+
+
+        bool run( const Node &root_node, staging::UringCopier &uring ) {
+            const auto handle = open_root();
+
+            if ( handle == nullptr )
+                return false;
+
+            std::vector<staging::CopyJob> jobs;
+            collect_jobs( root_node, *handle, jobs );
+
+            const auto failed = uring.run( jobs,
+                [&]( const staging::CopyJob &job, std::error_code ec ) {
+                    if ( ec == std::errc::no_such_file_or_directory
+                         and not fs::exists( job.source ))
+                        fmt::println("File not found: {}", job.source.string());
+                    else
+                        report( job.target, ec );
+                }
+            );
+
+            files += jobs.size() - failed;
+
+            print_summary( fmt::format( "io_uring {}", jobs.size() - failed ));
+            return failures.load() == 0;
+        }
+
+
+    private:
+        const fs::path root;
+        const fs::path target;
+        const LinkMode link_mode;
+        dev_t          target_dev = 0;
+        // +
+        const staging::Changes *changes;
+        // +
+        std::optional<utils::ThreadPool> pool;
+        staging::KernelCopier            copier;
+
+        std::atomic<std::size_t> directories { 0 };
+        std::atomic<std::size_t> files       { 0 };
+        std::atomic<std::size_t> failures    { 0 };
+        std::atomic<std::size_t> hardlinks   { 0 };
+        std::atomic<std::size_t> symlinks    { 0 };
+        std::atomic<std::size_t> unchanged   { 0 };
+        std::size_t              removed     = 0;
+        // +
+        std::atomic<std::size_t> open_handles { 0 };
+        std::size_t              max_handles  = SIZE_MAX;
+
+
+        void report( const fs::path &path, const std::error_code &ec ) {
+            failures++;
+
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: '{}': {}",
+                path.string(),
+                ec.message()
+            );
+        }
+
+
+        bool make_target( void ) {
+            std::error_code ec;
+
+            /* Re-staging unlinks targets: they must not be the sources */
+            if ( fs::equivalent( root, target, ec )) {
+                fmt::println( stderr,
+                    "\x1b[1;31mError\x1b[0m: '{}' is the project root itself",
+                    target.string()
+                );
+                failures++;
+                return false;
+            }
+
+            fs::create_directory( target, ec );
+
+            if ( ec ) {
+                report( target, ec );
+                return false;
+            }
+
+            remove_vanished();
+            return true;
+        }
+
+
+        handle_t open_root( void ) {
+            if ( not make_target() )
+                return nullptr;
+
+            auto handle = std::make_shared<DirHandle>();
+
+            handle->source = ::open( root.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+
+            if ( handle->source < 0 ) {
+                report( root, last_error() );
+                return nullptr;
+            }
+
+            handle->target = ::open( target.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+
+            if ( handle->target < 0 ) {
+                report( target, last_error() );
+                return nullptr;
+            }
+
+            struct stat info {};
+
+            if ( ::fstat( handle->target, &info ) == 0 )
+                target_dev = info.st_dev;
+
+            return handle;
+        }
+
+
+        void print_summary( const std::string &methods ) {
+            std::string links;
+
+            if ( hardlinks > 0 )
+                links += fmt::format( "hardlink {}, ", hardlinks.load() );
+
+            if ( symlinks > 0 )
+                links += fmt::format( "symlink {}, ", symlinks.load() );
+
+            std::string incremental;
+
+            if ( changes != nullptr )
+                incremental = fmt::format( ", {} unchanged, {} removed",
+                    unchanged.load(),
+                    removed
+                );
+
+            fmt::println("staged: {} ({} directories, {} files{}; {}{})",
+                target.string(),
+                directories.load(),
+                files.load(),
+                incremental,
+                links,
+                methods
+            );
+        }
+
+
+        void remove_vanished( void ) {
+            if ( changes == nullptr )
+                return;
+
+            /* Deepest paths come first, directories are empty by then */
+            for ( const auto &relative : changes->vanished ) {
+                std::error_code ec;
+
+                if ( fs::remove( target / relative, ec ))
+                    removed++;
+            }
+        }
+
+
+        bool source_missing( const DirHandle &dir, const std::string &name ) {
+            struct stat info {};
+
+            return ::fstatat( dir.source, name.c_str(), &info, 0 ) != 0
+               and errno == ENOENT;
+        }
+
+
+        /* false when the staged copy from a previous run is still good,
+         * otherwise clears the way for a fresh copy */
+        bool needs_staging( const DirHandle   &dir,
+                            const std::string &name,
+                            const std::string &relative
+        ) {
+            if ( changes != nullptr and not changes->changed.contains( relative )) {
+                struct stat info {};
+
+                if ( ::fstatat( dir.target, name.c_str(), &info,
+                                AT_SYMLINK_NOFOLLOW ) == 0 ) {
+                    unchanged++;
+                    return false;
+                }
+            }
+
+            /* Never write through an old target: it may be a link */
+            ::unlinkat( dir.target, name.c_str(), 0 );
+            return true;
+        }
+
+
+        /* true when the file was handled (linked or reported), false
+         * when it still has to be copied */
+        bool try_link( const DirHandle   &dir,
+                       const std::string &name,
+                       const std::string &relative
+        ) {
+            using enum LinkMode;
+
+            if ( link_mode == COPY )
+                return false;
+
+            struct stat info {};
+
+            if ( ::fstatat( dir.source, name.c_str(), &info, 0 ) != 0 ) {
+                fmt::println("File not found: {}", ( root / relative ).string());
+                return true;
+            }
+
+
+            if ( link_mode == SYMLINK ) {
+                std::error_code ec;
+                const auto absolute = fs::absolute( root / relative, ec );
+
+                if ( ec or ::symlinkat( absolute.c_str(),
+                                        dir.target,
+                                        name.c_str() ) != 0 ) {
+                    report( target / relative, ec ? ec : last_error() );
+                    return true;
+                }
+
+                symlinks++;
+                files++;
+                return true;
+            }
+
+
+            /* Device boundary is checked per file: mount points inside
+             * the project may live on another filesystem */
+            if ( info.st_dev != target_dev ) {
+                if ( link_mode == AUTO )
+                    return false;
+
+                report( target / relative,
+                    std::make_error_code( std::errc::cross_device_link )
+                );
+                return true;
+            }
+
+            if ( ::linkat( dir.source, name.c_str(),
+                           dir.target, name.c_str(), 0 ) == 0 ) {
+                hardlinks++;
+                files++;
+                return true;
+            }
+
+            /* Link count limits or filesystems without hardlinks */
+            if ( link_mode == AUTO
+                 and ( errno == EMLINK or errno == EPERM or errno == EXDEV ))
+                return false;
+
+            report( target / relative, last_error() );
+            return true;
+        }
+
+
+        void collect_jobs( const Node &parent,
+                           const DirHandle &dir,
+                           std::vector<staging::CopyJob> &jobs
+        ) {
+            for ( const auto &[name_view, child] : parent.get_children() ) {
+                if ( ( *child ).is_directory() ) {
+                    if ( const auto handle = open_directory( *child, dir ))
+                        collect_jobs( *child, *handle, jobs );
+                    continue;
+                }
+
+                const std::string name { name_view };
+                const auto relative = DirTree::join_path( dir.relative, name );
+
+                if ( needs_staging( dir, name, relative )
+                     and not try_link( dir, name, relative ))
+                    jobs.push_back({ root / relative, target / relative });
+            }
+        }
+
+
+        void enqueue_children( const Node &parent, const handle_t &dir ) {
+            for ( const auto &[name, child] : parent.get_children() ) {
+                const Node *node = child;
+
+                pool->submit( [this, node, dir] {
+                    if ( node->is_directory() )
+                        make_directory( *node, *dir );
+                    else
+                        copy_file( *node, *dir );
+                });
+            }
+        }
+
+
+        handle_t open_directory( const Node &node, const DirHandle &dir ) {
+            const std::string name { node.get_name() };
+
+            auto handle = std::make_shared<DirHandle>();
+            handle->relative = DirTree::join_path( dir.relative, name );
+
+            handle->source = ::openat( dir.source, name.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+
+            if ( handle->source < 0 ) {
+                if ( errno == ENOENT )
+                    fmt::println("File not found: {}",
+                        ( root / handle->relative ).string()
+                    );
+                else
+                    report( root / handle->relative, last_error() );
+
+                return nullptr;
+            }
+
+            if ( ::mkdirat( dir.target, name.c_str(), 0777 ) != 0
+                 and errno != EEXIST ) {
+                report( target / handle->relative, last_error() );
+                return nullptr;
+            }
+
+            handle->target = ::openat( dir.target, name.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+
+            if ( handle->target < 0 ) {
+                report( target / handle->relative, last_error() );
+                return nullptr;
+            }
+
+            handle->open = &open_handles;
+            open_handles.fetch_add( 1, std::memory_order_relaxed );
+
+            directories++;
+            return handle;
+        }
+
+
+        // Queued tasks pin their parent's handle until they run and the
+        // pool is FIFO, so a wide tree would open every directory of a
+        // level at once. Past the fd budget a subtree is copied depth
+        // first on this worker instead, holding one handle per level.
+        //
+        void make_directory( const Node &node, const DirHandle &dir ) {
+            const auto handle = open_directory( node, dir );
+
+            if ( handle == nullptr )
+                return;
+
+            if ( open_handles.load( std::memory_order_relaxed ) < max_handles )
+                enqueue_children( node, handle );
+            else
+                copy_subtree( node, *handle );
+        }
+
+
+        void copy_subtree( const Node &parent, const DirHandle &dir ) {
+            for ( const auto &[name, child] : parent.get_children() ) {
+                if ( not ( *child ).is_directory() ) {
+                    copy_file( *child, dir );
+                    continue;
+                }
+
+                if ( const auto handle = open_directory( *child, dir ))
+                    copy_subtree( *child, *handle );
+            }
+        }
+
+
+        void copy_file( const Node &node, const DirHandle &dir ) {
+            const std::string name { node.get_name() };
+            const auto relative = DirTree::join_path( dir.relative, name );
+
+            if ( not needs_staging( dir, name, relative ))
+                return;
+
+            if ( try_link( dir, name, relative ))
+                return;
+
+            const auto ec = copier.copy_at( dir.source, name.c_str(),
+                                            dir.target, name.c_str() );
+
+            if ( ec ) {
+                if ( ec == std::errc::no_such_file_or_directory
+                     and source_missing( dir, name ))
+                    fmt::println("File not found: {}",
+                        ( root / relative ).string()
+                    );
+                else
+                    report( target / relative, ec );
+                return;
+            }
+
+            files++;
+        }
+    };
+}
+
+
+bool staging::create_structure( const DirTree &tree, const Options &options ) {
+    const auto &root_node = tree.get_root();
+
+    CopyEngine engine {
+        root_node.get_name(),
+        options.target,
+        parse_link_mode( options.link_mode ),
+        options.changes
+    };
+
+    if ( options.io_backend == "uring" ) {
+        UringCopier uring;
+
+        if ( not uring.has_errors() )
+            return engine.run( root_node, uring );
+
+        fmt::println( stderr, "io_uring unavailable, using threads" );
+    }
+
+    return engine.run(
+        root_node,
+        utils::ThreadPool::resolve_workers( options.jobs )
+    );
+}
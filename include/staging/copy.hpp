@@ -0,0 +1,37 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/tree.hpp"
+#include "staging/manifest.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+
+namespace staging {
+
+    // ---- STAGING OPTIONS ----
+    //
+    struct Options {
+        std::filesystem::path target;      /* usually project_name       */
+        std::int64_t          jobs;        /* copy workers, 0 = per core */
+        std::string           io_backend;  /* "threads" or "uring"       */
+        std::string           link_mode;   /* copy/hardlink/symlink/auto */
+        const Changes        *changes = nullptr;   /* incremental run   */
+    };
+
+
+    // ---- MAIN FUNCTIONS ----
+    //
+    // Reproduces the selected tree under `target`. A directory is created
+    // before any of its children is queued, files are copied by a pool of
+    // `jobs` workers. With `changes`, unchanged files already present in
+    // `target` are kept and vanished ones are removed.
+    //
+    bool create_structure( const DirTree &tree, const Options &options );
+}
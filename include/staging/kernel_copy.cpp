@@ -0,0 +1,328 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "staging/kernel_copy.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    /* Largest count Linux accepts in one copy_file_range/sendfile call */
+    constexpr std::uint64_t MAX_CHUNK   = 0x7ffff000;
+    constexpr std::size_t   BUFFER_SIZE = 256 * 1024;
+
+
+    std::error_code make_error( int error ) {
+        return { error, std::generic_category() };
+    }
+}
+
+
+std::string_view staging::KernelCopier::get_method_name( CopyMethod method ) {
+    using enum CopyMethod;
+
+    switch ( method ) {
+        case REFLINK        : return "reflink"        ;
+        case COPY_FILE_RANGE: return "copy_file_range";
+        case SENDFILE       : return "sendfile"       ;
+        case READ_WRITE     : return "read/write"     ;
+        default:
+            return "Unknown";
+    }
+}
+
+
+bool staging::KernelCopier::is_unsupported( int error ) {
+    return error == ENOSYS
+        or error == EOPNOTSUPP
+        or error == ENOTTY
+        or error == EXDEV;
+}
+
+
+bool staging::KernelCopier::can_fall_back( int error ) {
+    /* EINVAL: this file or range only (special file, alignment, ...) */
+    return is_unsupported( error ) or error == EINVAL;
+}
+
+
+int staging::KernelCopier::try_reflink( int in_fd, int out_fd ) {
+    return ::ioctl( out_fd, FICLONE, in_fd ) == 0 ? 0 : errno;
+}
+
+
+int staging::KernelCopier::try_copy_file_range( int in_fd, int out_fd,
+                                                std::uint64_t &offset,
+                                                std::uint64_t  size
+) {
+    while ( offset < size ) {
+        auto in_off  = static_cast<off_t>( offset );
+        auto out_off = static_cast<off_t>( offset );
+
+        const auto count = ::copy_file_range(
+            in_fd , &in_off,
+            out_fd, &out_off,
+            std::min( size - offset, MAX_CHUNK ),
+            0
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count < 0 )
+            return errno;
+
+        /* Source shrank since fstat */
+        if ( count == 0 )
+            break;
+
+        offset += static_cast<std::uint64_t>( count );
+    }
+
+    return 0;
+}
+
+
+int staging::KernelCopier::try_sendfile( int in_fd, int out_fd,
+                                         std::uint64_t &offset,
+                                         std::uint64_t  size
+) {
+    /* sendfile writes at the current position of out_fd */
+    if ( ::lseek( out_fd, static_cast<off_t>( offset ), SEEK_SET ) < 0 )
+        return errno;
+
+    while ( offset < size ) {
+        auto in_off = static_cast<off_t>( offset );
+
+        const auto count = ::sendfile(
+            out_fd, in_fd, &in_off,
+            std::min( size - offset, MAX_CHUNK )
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count < 0 )
+            return errno;
+
+        if ( count == 0 )
+            break;
+
+        offset += static_cast<std::uint64_t>( count );
+    }
+
+    return 0;
+}
+
+
+int staging::KernelCopier::try_read_write( int in_fd, int out_fd,
+                                           std::uint64_t &offset,
+                                           std::uint64_t  size
+) {
+    thread_local std::vector<char> buffer( BUFFER_SIZE );
+
+    while ( offset < size ) {
+        const auto count = ::pread(
+            in_fd,
+            buffer.data(),
+            std::min<std::uint64_t>( size - offset, buffer.size() ),
+            static_cast<off_t>( offset )
+        );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count < 0 )
+            return errno;
+
+        if ( count == 0 )
+            break;
+
+        for ( ssize_t done = 0; done < count; ) {
+            const auto written = ::pwrite(
+                out_fd,
+                buffer.data() + done,
+                static_cast<std::size_t>( count - done ),
+                static_cast<off_t>( offset ) + done
+            );
+
+            if ( written < 0 and errno == EINTR )
+                continue;
+
+            if ( written < 0 )
+                return errno;
+
+            done += written;
+        }
+
+        offset += static_cast<std::uint64_t>( count );
+    }
+
+    return 0;
+}
+
+
+std::error_code staging::KernelCopier::copy( int in_fd,
+                                             int out_fd,
+                                             std::uint64_t size
+) {
+    using enum CopyMethod;
+
+    const auto accept = [&]( CopyMethod method ) {
+        used[ std::size_t( method ) ]++;
+        return std::error_code {};
+    };
+
+    const auto reject = [&]( CopyMethod method, int error ) {
+        if ( is_unsupported( error ))
+            disabled[ std::size_t( method ) ] = true;
+    };
+
+
+    if ( not disabled[ std::size_t( REFLINK ) ] ) {
+        const int error = try_reflink( in_fd, out_fd );
+
+        if ( error == 0 )
+            return accept( REFLINK );
+
+        reject( REFLINK, error );
+    }
+
+
+    /* Later methods resume from wherever the previous one stopped */
+    std::uint64_t offset = 0;
+
+    if ( not disabled[ std::size_t( COPY_FILE_RANGE ) ] ) {
+        const int error = try_copy_file_range( in_fd, out_fd, offset, size );
+
+        if ( error == 0 )
+            return accept( COPY_FILE_RANGE );
+
+        if ( not can_fall_back( error ))
+            return make_error( error );
+
+        reject( COPY_FILE_RANGE, error );
+    }
+
+
+    if ( not disabled[ std::size_t( SENDFILE ) ] ) {
+        const int error = try_sendfile( in_fd, out_fd, offset, size );
+
+        if ( error == 0 )
+            return accept( SENDFILE );
+
+        if ( not can_fall_back( error ))
+            return make_error( error );
+
+        reject( SENDFILE, error );
+    }
+
+
+    const int error = try_read_write( in_fd, out_fd, offset, size );
+
+    if ( error == 0 )
+        return accept( READ_WRITE );
+
+    return make_error( error );
+}
+
+
+std::error_code staging::KernelCopier::copy(
+    const std::filesystem::path &source,
+    const std::filesystem::path &target
+) {
+    return copy_at( AT_FDCWD, source.c_str(), AT_FDCWD, target.c_str() );
+}
+
+
+std::error_code staging::KernelCopier::copy_at( int source_dir,
+                                                const char *source,
+                                                int target_dir,
+                                                const char *target
+) {
+    const int in_fd = ::openat( source_dir, source, O_RDONLY | O_CLOEXEC );
+
+    if ( in_fd < 0 )
+        return make_error( errno );
+
+    struct stat info {};
+
+    if ( ::fstat( in_fd, &info ) != 0 ) {
+        const int error = errno;
+        ::close( in_fd );
+        return make_error( error );
+    }
+
+
+    const int out_fd = ::openat( target_dir, target,
+        O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+        info.st_mode & 07777
+    );
+
+    if ( out_fd < 0 ) {
+        const int error = errno;
+        ::close( in_fd );
+        return make_error( error );
+    }
+
+
+    auto result = copy( in_fd, out_fd, static_cast<std::uint64_t>( info.st_size ));
+
+    /* Same permissions as the source, regardless of umask */
+    if ( not result and ::fchmod( out_fd, info.st_mode & 07777 ) != 0 )
+        result = make_error( errno );
+
+    if ( ::close( out_fd ) != 0 and not result )
+        result = make_error( errno );
+
+    ::close( in_fd );
+
+    if ( result )
+        ::unlinkat( target_dir, target, 0 );
+
+    return result;
+}
+
+
+std::string staging::KernelCopier::get_summary( void ) const {
+    std::string summary;
+
+    for ( std::size_t i = 0; i < METHODS; i++ ) {
+        const auto count = used[i].load();
+
+        if ( count == 0 )
+            continue;
+
+        if ( not summary.empty() )
+            summary += ", ";
+
+        summary += fmt::format( "{} {}",
+            get_method_name( CopyMethod( i )),
+            count
+        );
+    }
+
+    return summary.empty() ? "none" : summary;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+
+namespace staging {
+
+    // ---- COPY METHODS ----
+    //
+    // In order of preference, each one falls back to the next.
+    //
+    enum class CopyMethod : std::uint8_t {
+        REFLINK,            /* ioctl(FICLONE), CoW filesystems only */
+        COPY_FILE_RANGE,    /* in-kernel copy, may offload to the fs  */
+        SENDFILE,           /* in-kernel copy through the page cache  */
+        READ_WRITE,         /* userspace buffer loop                  */
+        COUNT
+    };
+
+
+    // ---- KERNEL COPIER ----
+    //
+    // Copies single files trying the cheapest mechanism first. Methods
+    // that the kernel or filesystem reject as unsupported are remembered
+    // and skipped for the rest of the run. Safe to share between threads.
+    //
+    class KernelCopier {
+    public:
+        // ---- MAIN METHODS ----
+        //
+        std::error_code copy( const std::filesystem::path &source,
+                              const std::filesystem::path &target );
+        // +
+        /* Names resolved relative to open directory fds (or AT_FDCWD) */
+        std::error_code copy_at( int source_dir, const char *source,
+                                 int target_dir, const char *target );
+        // +
+        std::error_code copy( int in_fd, int out_fd, std::uint64_t size );
+
+
+        // ---- REPORTING ----
+        //
+        [[nodiscard]]
+        std::string get_summary( void ) const;
+        // +
+        [[nodiscard]]
+        static std::string_view get_method_name( CopyMethod method );
+
+
+    private:
+        static constexpr auto METHODS = std::size_t( CopyMethod::COUNT );
+
+        // ---- RUN STATE ----
+        //
+        std::array<std::atomic<bool>       , METHODS> disabled {};
+        std::array<std::atomic<std::size_t>, METHODS> used     {};
+
+
+        // ---- METHOD IMPLEMENTATIONS ----
+        //
+        /* Each returns 0 on success, or the errno that stopped it */
+        static int try_reflink        ( int in_fd, int out_fd );
+        static int try_copy_file_range( int in_fd, int out_fd,
+                                        std::uint64_t &offset,
+                                        std::uint64_t  size );
+        static int try_sendfile       ( int in_fd, int out_fd,
+                                        std::uint64_t &offset,
+                                        std::uint64_t  size );
+        static int try_read_write     ( int in_fd, int out_fd,
+                                        std::uint64_t &offset,
+                                        std::uint64_t  size );
+        // +
+        /* Turns the method off for the rest of the run */
+        static bool is_unsupported( int error );
+        // +
+        /* Worth trying the next method for this file */
+        static bool can_fall_back ( int error );
+    };
+}
@@ -0,0 +1,397 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "staging/manifest.hpp"
+#include "utilities/hash.hpp"
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    namespace fs = std::filesystem;
+
+    using Record = staging::Manifest::Record;
+
+
+    constexpr std::string_view MAGIC = "comprexxion-manifest 2";
+
+
+    /* Splits off the next space-separated field and parses it */
+    template <typename T>
+    bool take_number( std::string_view &line, T &value, int base = 10 ) {
+        const auto end    = line.find( ' ' );
+        const auto field  = line.substr( 0, end );
+        const auto result = std::from_chars(
+            field.data(), field.data() + field.size(), value, base
+        );
+
+        if ( result.ec != std::errc {} or end == std::string_view::npos )
+            return false;
+
+        line.remove_prefix( end + 1 );
+        return true;
+    }
+
+
+    Record stat_record( const struct stat &info, bool directory ) {
+        if ( directory )
+            return Record { .directory = true };
+
+        return Record {
+            .size  = static_cast<std::uint64_t>( info.st_size ),
+            .mtime = info.st_mtim.tv_sec * 1'000'000'000LL
+                   + info.st_mtim.tv_nsec,
+            .inode = info.st_ino
+        };
+    }
+}
+
+
+/* ----------------------- MANIFEST:: IMPLEMENTATION ---------------------- */
+
+staging::Manifest::Errors staging::Manifest::load(
+    const std::filesystem::path &path
+) {
+    records.clear();
+    options = 0;
+
+    const std::unique_ptr<std::FILE, decltype( &std::fclose )> file {
+        std::fopen( path.c_str(), "r" ),
+        &std::fclose
+    };
+
+    if ( file == nullptr )
+        return errno == ENOENT ? Errors::NONE : Errors::OPEN_FAILED;
+
+
+    std::string line;
+    bool        header = true;
+
+    for ( int c = std::fgetc( file.get() ); c != EOF;
+              c = std::fgetc( file.get() )
+    ) {
+        if ( c != '\n' ) {
+            line.push_back( static_cast<char>( c ));
+            continue;
+        }
+
+        if ( header ) {
+            std::string_view rest { line };
+
+            if ( not rest.starts_with( MAGIC ))
+                return Errors::BAD_FORMAT;
+
+            rest.remove_prefix( MAGIC.size() );
+
+            if ( not rest.starts_with( ' ' ))
+                return Errors::BAD_FORMAT;
+
+            rest.remove_prefix( 1 );
+
+            /* The options hash is the last field: no trailing separator */
+            const auto result = std::from_chars(
+                rest.data(), rest.data() + rest.size(), options, 16
+            );
+
+            if ( result.ec != std::errc {}
+                 or result.ptr != rest.data() + rest.size() )
+                return Errors::BAD_FORMAT;
+
+            header = false;
+            line.clear();
+            continue;
+        }
+
+
+        std::string_view rest { line };
+        Record record {};
+
+        if ( rest.size() < 2 or ( rest[0] != 'F' and rest[0] != 'D' ))
+            return Errors::BAD_FORMAT;
+
+        record.directory = rest[0] == 'D';
+        rest.remove_prefix( 2 );
+
+        if ( not take_number( rest, record.size      )
+          or not take_number( rest, record.mtime     )
+          or not take_number( rest, record.inode     )
+          or not take_number( rest, record.hash, 16  )
+          or rest.empty() )
+            return Errors::BAD_FORMAT;
+
+        records.insert_or_assign( std::string( rest ), record );
+        line.clear();
+    }
+
+    return header ? Errors::BAD_FORMAT : Errors::NONE;
+}
+
+
+staging::Manifest::Errors staging::Manifest::save(
+    const std::filesystem::path &path
+) const {
+    /* Write aside and rename, a crash never leaves half a manifest */
+    auto temporary = path;
+    temporary += ".tmp";
+
+    std::FILE *file = std::fopen( temporary.c_str(), "w" );
+
+    if ( file == nullptr )
+        return Errors::OPEN_FAILED;
+
+    fmt::print( file, "{} {:x}\n", MAGIC, options );
+
+    for ( const auto &[relative, record] : records ) {
+        /* The format is line based, such names are simply re-staged */
+        if ( relative.find( '\n' ) != std::string::npos )
+            continue;
+
+        fmt::print( file, "{} {} {} {} {:x} {}\n",
+            record.directory ? 'D' : 'F',
+            record.size,
+            record.mtime,
+            record.inode,
+            record.hash,
+            relative
+        );
+    }
+
+    const bool written = std::ferror( file ) == 0;
+
+    if ( std::fclose( file ) != 0 or not written ) {
+        std::error_code ignored;
+        fs::remove( temporary, ignored );
+        return Errors::WRITE_FAILED;
+    }
+
+    std::error_code ec;
+    fs::rename( temporary, path, ec );
+
+    return ec ? Errors::WRITE_FAILED : Errors::NONE;
+}
+
+
+const staging::Manifest::Record *staging::Manifest::find(
+    const std::string &relative
+) const {
+    const auto it = records.find( relative );
+
+    return it == records.end() ? nullptr : &it->second;
+}
+
+
+void staging::Manifest::insert( const std::string &relative,
+                                const Record &record
+) {
+    records.insert_or_assign( relative, record );
+}
+
+
+void staging::Manifest::erase( const std::string &relative ) {
+    records.erase( relative );
+}
+
+
+const staging::Manifest::records_t &staging::Manifest::get_records(
+    void
+) const {
+    return records;
+}
+
+
+std::uint64_t staging::Manifest::get_options( void ) const {
+    return options;
+}
+
+
+void staging::Manifest::set_options( std::uint64_t _options ) {
+    options = _options;
+}
+
+
+staging::Changes staging::diff_tree( const DirTree  &tree,
+                                     const Manifest &previous,
+                                     std::int64_t    jobs,
+                                     bool            force
+) {
+    struct DirFrame {
+        DirTree::children_node_t::const_iterator begin;
+        DirTree::children_node_t::const_iterator end  ;
+        std::string                              relative;
+        int                                      fd;
+    };
+
+    /* Files to hash, filled in by the pool once the walk is done. Each
+     * has a previous record of the same size */
+    struct Pending {
+        std::string relative;
+        Record      record;
+        bool        readable = true;
+    };
+
+    Changes              changes;
+    std::vector<Pending> pending;
+    std::vector<DirFrame> stack;
+
+    const auto &root_node = tree.get_root();
+    const fs::path root_path = root_node.get_name();
+
+    const int root_fd = ::open( root_path.c_str(),
+        O_RDONLY | O_DIRECTORY | O_CLOEXEC
+    );
+
+    if ( root_fd >= 0 )
+        stack.push_back( DirFrame {
+            .begin    = root_node.get_children().begin(),
+            .end      = root_node.get_children().end  (),
+            .relative = {},
+            .fd       = root_fd
+        });
+
+
+    /* Stats are relative to the parent's fd, not the whole path */
+    while ( not stack.empty() ) {
+        auto &[it, it_end, parent, dir_fd] = stack.back();
+
+        if ( it == it_end ) {
+            ::close( dir_fd );
+            stack.pop_back();
+            continue;
+        }
+
+        const auto &[name_view, child] = *it;
+        it++;
+
+        const std::string name { name_view };
+        auto relative = DirTree::join_path( parent, name );
+
+        const bool directory = ( *child ).is_directory();
+        struct stat info {};
+
+        if ( directory ) {
+            const int fd = ::openat( dir_fd, name.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC
+            );
+
+            /* Missing sources are reported by the staging step itself */
+            if ( fd < 0 )
+                continue;
+
+            ::fstat( fd, &info );
+
+            if ( force or previous.find( relative ) == nullptr )
+                changes.changed.insert( relative );
+
+            changes.current.insert( relative, stat_record( info, true ));
+
+            stack.push_back( DirFrame {
+                .begin    = ( *child ).get_children().begin(),
+                .end      = ( *child ).get_children().end  (),
+                .relative = std::move( relative ),
+                .fd       = fd
+            });
+            continue;
+        }
+
+
+        if ( ::fstatat( dir_fd, name.c_str(), &info, 0 ) != 0 )
+            continue;
+
+        auto record = stat_record( info, false );
+
+
+        const auto *old = previous.find( relative );
+
+        const bool same_size = not force
+            and old != nullptr
+            and not old->directory
+            and old->size == record.size;
+
+        if ( same_size
+             and old->mtime == record.mtime
+             and old->inode == record.inode )
+        {
+            record.hash = old->hash;
+            changes.current.insert( relative, record );
+            continue;
+        }
+
+        /* New or resized files are changed whatever they hold; the
+         * archive reads them anyway and its hash completes the record */
+        if ( not same_size ) {
+            changes.changed.insert( relative );
+            changes.current.insert( relative, record );
+            continue;
+        }
+
+        pending.push_back({ relative, record });
+    }
+
+
+    /* Only touched files of the same size are read, to tell whether
+     * their contents really changed; spread them over workers */
+    {
+        utils::ThreadPool pool { utils::ThreadPool::resolve_workers( jobs ) };
+
+        for ( auto &file : pending ) {
+            pool.submit( [&root_path, &file] {
+                std::error_code ec;
+
+                file.record.hash = utils::hash_file(
+                    root_path / file.relative, ec
+                );
+                file.readable = not ec;
+            });
+        }
+
+        pool.wait_idle();
+    }
+
+    for ( const auto &file : pending ) {
+        const auto *old = previous.find( file.relative );
+
+        const bool same_contents = file.readable
+            and old->hash != 0
+            and old->hash == file.record.hash;
+
+        if ( not same_contents )
+            changes.changed.insert( file.relative );
+
+        changes.current.insert( file.relative, file.record );
+    }
+
+
+    for ( const auto &[relative, record] : previous.get_records() ) {
+        if ( changes.current.find( relative ) == nullptr )
+            changes.vanished.push_back( relative );
+    }
+
+    /* Children sort after their parent: reverse order removes them first */
+    std::sort( changes.vanished.rbegin(), changes.vanished.rend() );
+
+    return changes;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "parsing/tree.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace staging {
+
+    // ---- STATE MANIFEST ----
+    //
+    // What the previous run saw for every selected path (relative to the
+    // project root), and a hash of the options that shaped its outputs.
+    // Persisted as a text file, one record per line after the header:
+    //
+    //   comprexxion-manifest 2 <options hash>
+    //   F <size> <mtime ns> <inode> <xxh64> <path>
+    //   D 0 0 0 0 <path>
+    //
+    class Manifest {
+    public:
+        // ---- RECORD ----
+        //
+        struct Record {
+            std::uint64_t size      = 0;
+            std::int64_t  mtime     = 0;    /* nanoseconds since epoch */
+            std::uint64_t inode     = 0;
+            std::uint64_t hash      = 0;    /* 0 = not computed */
+            bool          directory = false;
+        };
+        // +
+        using records_t = std::unordered_map<std::string, Record>;
+
+
+        // ---- ERRORS TYPES ----
+        //
+        enum class Errors : std::uint8_t {
+            NONE,
+            OPEN_FAILED,
+            BAD_FORMAT,
+            WRITE_FAILED
+        };
+
+
+        // ---- PERSISTENCE ----
+        //
+        /* A missing file leaves the manifest empty and is not an error */
+        Errors load( const std::filesystem::path &path );
+        // +
+        [[nodiscard]]
+        Errors save( const std::filesystem::path &path ) const;
+
+
+        // ---- RECORDS ----
+        //
+        [[nodiscard]]
+        const Record *find( const std::string &relative ) const;
+        // +
+        void insert( const std::string &relative, const Record &record );
+        // +
+        void erase( const std::string &relative );
+        // +
+        [[nodiscard]]
+        const records_t &get_records( void ) const;
+
+
+        // ---- OPTIONS ----
+        //
+        /* 0 when unknown: never equal to a real hash in practice */
+        [[nodiscard]]
+        std::uint64_t get_options( void ) const;
+        // +
+        void set_options( std::uint64_t _options );
+
+
+    private:
+        records_t     records;
+        std::uint64_t options = 0;
+    };
+
+
+    // ---- CHANGE SET ----
+    //
+    struct Changes {
+        Manifest current;
+        // +
+        std::unordered_set<std::string> changed;   /* new or modified    */
+        std::vector<std::string>        vanished;  /* deepest path first */
+
+        [[nodiscard]]
+        bool empty( void ) const {
+            return changed.empty() and vanished.empty();
+        }
+    };
+
+
+    // ---- MAIN FUNCTIONS ----
+    //
+    // Stats every path of `tree` and compares it with `previous`. Files
+    // whose size, mtime and inode all match are trusted as unchanged; new
+    // or resized files are changed without being read, their hash is left
+    // for the caller to fill in once the archive has read them. Only a
+    // file of the same size with another mtime or inode is hashed by
+    // `jobs` workers, so a touched but identical file is still recognised.
+    // With `force` every path counts as changed and nothing is hashed.
+    //
+    Changes diff_tree( const DirTree  &tree,
+                       const Manifest &previous,
+                       std::int64_t    jobs,
+                       bool            force = false );
+}
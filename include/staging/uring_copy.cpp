@@ -0,0 +1,272 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "staging/uring_copy.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cerrno>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+
+bool staging::UringCopier::has_errors( void ) const {
+    return _has_errors;
+}
+
+
+io_uring_sqe *staging::UringCopier::prepare( Slot &slot,
+                                             std::uint8_t opcode,
+                                             Step step
+) {
+    /* The ring has two entries per slot, a slot never uses more */
+    auto *sqe = ring.get_sqe();
+
+    sqe->opcode    = opcode;
+    sqe->user_data = static_cast<std::uint64_t>( &slot - slots.data() );
+
+    slot.step = step;
+    return sqe;
+}
+
+
+void staging::UringCopier::start( Slot &slot, const CopyJob &job ) {
+    slot.job     = &job;
+    slot.in_fd   = slot.out_fd = -1;
+    slot.error   = 0;
+    slot.offset  = 0;
+    slot.closing = 0;
+    slot.created = false;
+
+    if ( slot.buffer.empty() )
+        slot.buffer.resize( BUFFER_SIZE );
+
+    auto *sqe = prepare( slot, IORING_OP_OPENAT, Step::OPEN_IN );
+
+    sqe->fd         = AT_FDCWD;
+    sqe->addr       = reinterpret_cast<std::uint64_t>( job.source.c_str() );
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+}
+
+
+void staging::UringCopier::read( Slot &slot ) {
+    auto *sqe = prepare( slot, IORING_OP_READ, Step::READ );
+
+    sqe->fd   = slot.in_fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>( slot.buffer.data() );
+    sqe->len  = static_cast<std::uint32_t>( slot.buffer.size() );
+    sqe->off  = slot.offset;
+}
+
+
+void staging::UringCopier::write( Slot &slot ) {
+    auto *sqe = prepare( slot, IORING_OP_WRITE, Step::WRITE );
+
+    sqe->fd   = slot.out_fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(
+        slot.buffer.data() + slot.written
+    );
+    sqe->len  = slot.length - slot.written;
+    sqe->off  = slot.offset + slot.written;
+}
+
+
+void staging::UringCopier::close( Slot &slot ) {
+    const auto mode = static_cast<mode_t>( slot.info.stx_mode & 07777 );
+
+    /* openat applied the umask, restore the exact source permissions */
+    if ( slot.error == 0 and ( mode & umask_bits ) != 0
+         and ::fchmod( slot.out_fd, mode ) != 0 )
+        slot.error = errno;
+
+    slot.step = Step::IDLE;
+
+    for ( const int fd : { slot.in_fd, slot.out_fd } ) {
+        if ( fd < 0 )
+            continue;
+
+        auto *sqe = prepare( slot, IORING_OP_CLOSE, Step::CLOSE );
+        sqe->fd = fd;
+
+        slot.closing++;
+    }
+
+    slot.in_fd = slot.out_fd = -1;
+}
+
+
+bool staging::UringCopier::complete( Slot &slot, int result ) {
+    using enum Step;
+
+    const bool failed = result < 0 and slot.step != CLOSE;
+
+    if ( failed ) {
+        slot.error = -result;
+        close( slot );
+        return slot.step == IDLE;
+    }
+
+
+    switch ( slot.step ) {
+        case OPEN_IN: {
+            slot.in_fd = result;
+
+            auto *sqe = prepare( slot, IORING_OP_STATX, STATX );
+
+            sqe->fd          = slot.in_fd;
+            sqe->addr        = reinterpret_cast<std::uint64_t>( "" );
+            sqe->statx_flags = AT_EMPTY_PATH;
+            sqe->len         = STATX_MODE | STATX_SIZE;
+            sqe->off         = reinterpret_cast<std::uint64_t>( &slot.info );
+            break;
+        }
+
+        case STATX: {
+            auto *sqe = prepare( slot, IORING_OP_OPENAT, OPEN_OUT );
+
+            sqe->fd         = AT_FDCWD;
+            sqe->addr       = reinterpret_cast<std::uint64_t>(
+                slot.job->target.c_str()
+            );
+            sqe->open_flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+            sqe->len        = slot.info.stx_mode & 07777;
+            break;
+        }
+
+        case OPEN_OUT:
+            slot.out_fd  = result;
+            slot.created = true;
+
+            if ( slot.info.stx_size == 0 )
+                close( slot );
+            else
+                read( slot );
+            break;
+
+        case READ:
+            /* EOF earlier than statx said: the source shrank */
+            if ( result == 0 ) {
+                close( slot );
+                break;
+            }
+
+            slot.length  = static_cast<std::uint32_t>( result );
+            slot.written = 0;
+            write( slot );
+            break;
+
+        case WRITE:
+            if ( result == 0 ) {
+                slot.error = EIO;
+                close( slot );
+                break;
+            }
+
+            slot.written += static_cast<std::uint32_t>( result );
+
+            if ( slot.written < slot.length ) {
+                write( slot );
+                break;
+            }
+
+            slot.offset += slot.length;
+
+            if ( slot.offset >= slot.info.stx_size )
+                close( slot );
+            else
+                read( slot );
+            break;
+
+        case CLOSE:
+            if ( --slot.closing == 0 )
+                slot.step = IDLE;
+            else
+                slot.step = CLOSE;
+            break;
+
+        case IDLE:
+            break;
+    }
+
+    return slot.step == IDLE;
+}
+
+
+std::size_t staging::UringCopier::run( const std::vector<CopyJob> &jobs,
+                                       const on_error_t &on_error
+) {
+    std::size_t next     = 0;
+    std::size_t active   = 0;
+    std::size_t failures = 0;
+
+    const auto finish = [&]( Slot &slot ) {
+        active--;
+
+        if ( slot.error == 0 )
+            return;
+
+        /* Do not leave half-written targets behind */
+        if ( slot.created )
+            ::unlink( slot.job->target.c_str() );
+
+        failures++;
+        on_error( *slot.job, { slot.error, std::generic_category() });
+    };
+
+
+    while ( next < jobs.size() or active > 0 ) {
+
+        for ( auto &slot : slots ) {
+            if ( next == jobs.size() )
+                break;
+
+            if ( slot.step != Step::IDLE or slot.job != nullptr )
+                continue;
+
+            start( slot, jobs[ next++ ] );
+            active++;
+        }
+
+
+        if ( const int status = ring.submit_and_wait( 1 ); status < 0 ) {
+            /* The ring itself broke: fail everything still queued */
+            for (; next < jobs.size(); next++, failures++ )
+                on_error( jobs[ next ], { -status, std::generic_category() });
+
+            return failures;
+        }
+
+
+        ring.for_each_cqe( [&]( std::uint64_t user_data, int result ) {
+            auto &slot = slots[ user_data ];
+
+            if ( complete( slot, result )) {
+                finish( slot );
+                slot.job = nullptr;
+            }
+        });
+    }
+
+    return failures;
+}
+
+
+staging::UringCopier::UringCopier()
+  : ring { SLOTS * 2 }
+{
+    _has_errors = not ring.supports({
+        IORING_OP_OPENAT,
+        IORING_OP_STATX,
+        IORING_OP_READ,
+        IORING_OP_WRITE,
+        IORING_OP_CLOSE
+    });
+
+    /* umask can only be read by setting it */
+    umask_bits = ::umask( 0 );
+    ::umask( umask_bits );
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/uring.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <sys/stat.h>
+
+
+namespace staging {
+
+    // ---- COPY JOB ----
+    //
+    struct CopyJob {
+        std::filesystem::path source;
+        std::filesystem::path target;
+    };
+
+
+    // ---- IO_URING COPIER ----
+    //
+    // Copies many files with a fixed number of them in flight. Each slot
+    // walks open -> statx -> open -> (read -> write)* -> close through the
+    // ring, so a single thread keeps dozens of syscalls outstanding.
+    //
+    class UringCopier {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        UringCopier();
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        UringCopier( const UringCopier& ) = delete;
+        UringCopier& operator=( const UringCopier& ) = delete;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        /* io_uring missing or lacking the needed opcodes */
+        [[nodiscard]]
+        bool has_errors( void ) const;
+
+
+        // ---- MAIN METHODS ----
+        //
+        using on_error_t = std::function<void( const CopyJob&,
+                                               std::error_code )>;
+        // +
+        std::size_t run( const std::vector<CopyJob> &jobs,
+                         const on_error_t &on_error );
+
+
+    private:
+        // ---- RING LAYOUT ----
+        //
+        static constexpr unsigned    SLOTS       = 64;
+        static constexpr std::size_t BUFFER_SIZE = 128 * 1024;
+
+
+        // ---- SLOT STATE ----
+        //
+        enum class Step : std::uint8_t {
+            IDLE,
+            OPEN_IN,
+            STATX,
+            OPEN_OUT,
+            READ,
+            WRITE,
+            CLOSE
+        };
+        // +
+        struct Slot {
+            const CopyJob *job  = nullptr;
+            Step           step = Step::IDLE;
+            // +
+            int in_fd  = -1;
+            int out_fd = -1;
+            int error  =  0;
+            // +
+            struct statx info {};
+            std::uint64_t offset  = 0;
+            std::uint32_t length  = 0;
+            std::uint32_t written = 0;
+            unsigned      closing = 0;
+            bool          created = false;
+            // +
+            std::vector<char> buffer;
+        };
+
+
+        // ---- MAIN MEMBERS ----
+        //
+        utils::IoUring           ring;
+        std::array<Slot, SLOTS>  slots;
+        mode_t                   umask_bits = 0;
+        bool                     _has_errors = false;
+
+
+        // ---- STATE MACHINE ----
+        //
+        void start   ( Slot &slot, const CopyJob &job );
+        bool complete( Slot &slot, int result );
+        void close   ( Slot &slot );
+        void read    ( Slot &slot );
+        void write   ( Slot &slot );
+        // +
+        io_uring_sqe *prepare( Slot &slot, std::uint8_t opcode, Step step );
+    };
+}
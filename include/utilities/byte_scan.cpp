@@ -0,0 +1,142 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/byte_scan.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstring>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#if defined( __GNUC__ ) and ( defined( __x86_64__ ) or defined( __i386__ ))
+    #define COMPREXXION_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    using find_any_t = std::size_t (*)( const char *data,
+                                        std::size_t size,
+                                        char a, char b, char c );
+
+
+    std::size_t find_any_scalar( const char *data,
+                                 std::size_t size,
+                                 char a, char b, char c
+    ) {
+        for ( std::size_t i = 0; i < size; i++ ) {
+            if ( data[i] == a or data[i] == b or data[i] == c )
+                return i;
+        }
+
+        return std::string_view::npos;
+    }
+
+
+#ifdef COMPREXXION_X86_SIMD
+
+    __attribute__(( target( "sse2" )))
+    std::size_t find_any_sse2( const char *data,
+                               std::size_t size,
+                               char a, char b, char c
+    ) {
+        const __m128i va = _mm_set1_epi8( a );
+        const __m128i vb = _mm_set1_epi8( b );
+        const __m128i vc = _mm_set1_epi8( c );
+
+        std::size_t i = 0;
+
+        for ( ; i + 16 <= size; i += 16 ) {
+            const __m128i chunk = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>( data + i )
+            );
+
+            const __m128i hits = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( chunk, va ),
+                              _mm_cmpeq_epi8( chunk, vb )),
+                _mm_cmpeq_epi8( chunk, vc )
+            );
+
+            if ( const int mask = _mm_movemask_epi8( hits ); mask != 0 )
+                return i + static_cast<std::size_t>( __builtin_ctz(
+                    static_cast<unsigned>( mask )
+                ));
+        }
+
+        const auto tail = find_any_scalar( data + i, size - i, a, b, c );
+        return tail == std::string_view::npos ? tail : i + tail;
+    }
+
+
+    __attribute__(( target( "avx2" )))
+    std::size_t find_any_avx2( const char *data,
+                               std::size_t size,
+                               char a, char b, char c
+    ) {
+        const __m256i va = _mm256_set1_epi8( a );
+        const __m256i vb = _mm256_set1_epi8( b );
+        const __m256i vc = _mm256_set1_epi8( c );
+
+        std::size_t i = 0;
+
+        for ( ; i + 32 <= size; i += 32 ) {
+            const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>( data + i )
+            );
+
+            const __m256i hits = _mm256_or_si256(
+                _mm256_or_si256( _mm256_cmpeq_epi8( chunk, va ),
+                                 _mm256_cmpeq_epi8( chunk, vb )),
+                _mm256_cmpeq_epi8( chunk, vc )
+            );
+
+            if ( const int mask = _mm256_movemask_epi8( hits ); mask != 0 )
+                return i + static_cast<std::size_t>( __builtin_ctz(
+                    static_cast<unsigned>( mask )
+                ));
+        }
+
+        /* Fewer than 32 bytes left: one SSE2 pass covers most of them */
+        const auto tail = find_any_sse2( data + i, size - i, a, b, c );
+        return tail == std::string_view::npos ? tail : i + tail;
+    }
+
+#endif
+
+
+    find_any_t resolve_find_any( void ) {
+        #ifdef COMPREXXION_X86_SIMD
+            __builtin_cpu_init();
+
+            if ( __builtin_cpu_supports( "avx2" ))
+                return find_any_avx2;
+
+            if ( __builtin_cpu_supports( "sse2" ))
+                return find_any_sse2;
+        #endif
+
+        return find_any_scalar;
+    }
+}
+
+
+std::size_t utils::find_any( std::string_view text, char a, char b, char c ) {
+    static const find_any_t implementation = resolve_find_any();
+
+    return implementation( text.data(), text.size(), a, b, c );
+}
+
+
+std::size_t utils::find_byte( std::string_view text, char a ) {
+    const void *found = std::memchr( text.data(), a, text.size() );
+
+    if ( found == nullptr )
+        return std::string_view::npos;
+
+    return static_cast<std::size_t>( static_cast<const char *>( found ) - text.data() );
+}
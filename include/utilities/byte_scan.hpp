@@ -0,0 +1,24 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstddef>
+#include <string_view>
+
+
+namespace utils {
+
+    // ---- BYTE SCANNING ----
+    //
+    // Index of the first byte of `text` equal to `a`, `b` or `c`, npos
+    // if none. Compares 32 (AVX2) or 16 (SSE2) bytes per step; the
+    // implementation is picked once from the running CPU, with a scalar
+    // fallback on other targets.
+    //
+    [[nodiscard]]
+    std::size_t find_any( std::string_view text, char a, char b, char c );
+    // +
+    /* Single byte: memchr is already vectorized by the C library */
+    [[nodiscard]]
+    std::size_t find_byte( std::string_view text, char a );
+}
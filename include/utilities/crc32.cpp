@@ -0,0 +1,260 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/crc32.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#if defined( __GNUC__ ) and defined( __x86_64__ )
+    #define COMPREXXION_X86_CLMUL
+    #include <immintrin.h>
+#endif
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    using crc32_t = std::uint32_t (*)( std::uint32_t crc,
+                                       const std::byte *data,
+                                       std::size_t size );
+
+
+    /* Reflected 0x04C11DB7 */
+    constexpr std::uint32_t POLYNOMIAL = 0xEDB88320;
+
+
+    // ---- SLICING-BY-8 ----
+    //
+    // tables[0] is the classic byte-at-a-time table; tables[k] advances
+    // a byte's contribution by k more zero bytes, so eight bytes are
+    // looked up independently and xored together.
+    //
+    constexpr auto make_tables( void ) {
+        std::array<std::array<std::uint32_t, 256>, 8> tables {};
+
+        for ( std::uint32_t n = 0; n < 256; n++ ) {
+            std::uint32_t crc = n;
+
+            for ( int bit = 0; bit < 8; bit++ )
+                crc = crc & 1 ? ( crc >> 1 ) ^ POLYNOMIAL : crc >> 1;
+
+            tables[0][n] = crc;
+        }
+
+        for ( std::size_t k = 1; k < tables.size(); k++ ) {
+            for ( std::size_t n = 0; n < 256; n++ ) {
+                const auto previous = tables[ k - 1 ][n];
+                tables[k][n] = ( previous >> 8 ) ^ tables[0][ previous & 0xff ];
+            }
+        }
+
+        return tables;
+    }
+
+    constexpr auto TABLES = make_tables();
+
+
+    /* Any byte order: compilers turn this into a single load */
+    std::uint32_t load_le32( const std::byte *data ) {
+        return  std::uint32_t( data[0] )
+             | ( std::uint32_t( data[1] ) <<  8 )
+             | ( std::uint32_t( data[2] ) << 16 )
+             | ( std::uint32_t( data[3] ) << 24 );
+    }
+
+
+    /* On the inverted register, as the folding code leaves it */
+    std::uint32_t crc32_slice8( std::uint32_t crc,
+                                const std::byte *data,
+                                std::size_t size
+    ) {
+        for ( ; size >= 8; data += 8, size -= 8 ) {
+            const auto low  = load_le32( data ) ^ crc;
+            const auto high = load_le32( data + 4 );
+
+            crc = TABLES[7][   low         & 0xff ]
+                ^ TABLES[6][ ( low  >>  8 ) & 0xff ]
+                ^ TABLES[5][ ( low  >> 16 ) & 0xff ]
+                ^ TABLES[4][   low  >> 24          ]
+                ^ TABLES[3][   high         & 0xff ]
+                ^ TABLES[2][ ( high >>  8 ) & 0xff ]
+                ^ TABLES[1][ ( high >> 16 ) & 0xff ]
+                ^ TABLES[0][   high >> 24          ];
+        }
+
+        for ( ; size > 0; data++, size-- )
+            crc = TABLES[0][ ( crc ^ std::uint32_t( *data )) & 0xff ] ^ ( crc >> 8 );
+
+        return crc;
+    }
+
+
+#ifdef COMPREXXION_X86_CLMUL
+
+    // ---- CARRY-LESS FOLDING ----
+    //
+    // Intel's "Fast CRC Computation Using PCLMULQDQ": four 128-bit lanes
+    // are folded forward 512 bits per step, merged into one lane, folded
+    // down to 64 bits and Barrett-reduced to the 32-bit CRC. Constants
+    // are x^n mod P for the fold distances, bit-reflected. `size` is a
+    // multiple of 16, at least 64.
+    //
+    __attribute__(( target( "pclmul,sse4.1" )))
+    inline __m128i load( const std::byte *at ) {
+        return _mm_loadu_si128( reinterpret_cast<const __m128i *>( at ));
+    }
+
+
+    /* lane.low * k.low ^ lane.high * k.high, plus the next 16 bytes */
+    __attribute__(( target( "pclmul,sse4.1" )))
+    inline __m128i fold( __m128i lane, __m128i k, __m128i next ) {
+        return _mm_xor_si128(
+            _mm_xor_si128( _mm_clmulepi64_si128( lane, k, 0x00 ),
+                           _mm_clmulepi64_si128( lane, k, 0x11 )),
+            next
+        );
+    }
+
+
+    __attribute__(( target( "pclmul,sse4.1" )))
+    std::uint32_t crc32_fold( std::uint32_t crc,
+                              const std::byte *data,
+                              std::size_t size
+    ) {
+        const __m128i by_512 = _mm_set_epi64x( 0x01c6e41596, 0x0154442bd4 );
+        const __m128i by_128 = _mm_set_epi64x( 0x00ccaa009e, 0x01751997d0 );
+        const __m128i by_64  = _mm_set_epi64x( 0          , 0x0163cd6124 );
+        const __m128i barret = _mm_set_epi64x( 0x01f7011641, 0x01db710641 );
+        const __m128i low32  = _mm_setr_epi32( -1, 0, -1, 0 );
+
+        __m128i a = _mm_xor_si128( load( data ), _mm_cvtsi32_si128( int( crc )));
+        __m128i b = load( data + 16 );
+        __m128i c = load( data + 32 );
+        __m128i d = load( data + 48 );
+
+        data += 64;
+        size -= 64;
+
+        for ( ; size >= 64; data += 64, size -= 64 ) {
+            a = fold( a, by_512, load( data      ));
+            b = fold( b, by_512, load( data + 16 ));
+            c = fold( c, by_512, load( data + 32 ));
+            d = fold( d, by_512, load( data + 48 ));
+        }
+
+        a = fold( a, by_128, b );
+        a = fold( a, by_128, c );
+        a = fold( a, by_128, d );
+
+        for ( ; size >= 16; data += 16, size -= 16 )
+            a = fold( a, by_128, load( data ));
+
+
+        /* 128 -> 64 bits */
+        a = _mm_xor_si128( _mm_srli_si128( a, 8 ),
+                           _mm_clmulepi64_si128( a, by_128, 0x10 ));
+
+        a = _mm_xor_si128( _mm_srli_si128( a, 4 ),
+                           _mm_clmulepi64_si128( _mm_and_si128( a, low32 ), by_64, 0x00 ));
+
+        /* Barrett reduction to 32 bits */
+        __m128i t = _mm_clmulepi64_si128( _mm_and_si128( a, low32 ), barret, 0x10 );
+        t = _mm_clmulepi64_si128( _mm_and_si128( t, low32 ), barret, 0x00 );
+
+        return static_cast<std::uint32_t>( _mm_extract_epi32( _mm_xor_si128( a, t ), 1 ));
+    }
+
+
+    std::uint32_t crc32_clmul( std::uint32_t crc,
+                               const std::byte *data,
+                               std::size_t size
+    ) {
+        if ( size >= 64 ) {
+            const auto folded = size & ~std::size_t( 15 );
+
+            crc   = crc32_fold( crc, data, folded );
+            data += folded;
+            size -= folded;
+        }
+
+        return crc32_slice8( crc, data, size );
+    }
+
+#endif
+
+
+    crc32_t resolve_crc32( void ) {
+        #ifdef COMPREXXION_X86_CLMUL
+            __builtin_cpu_init();
+
+            if ( __builtin_cpu_supports( "pclmul" )
+                 and __builtin_cpu_supports( "sse4.1" ))
+                return crc32_clmul;
+        #endif
+
+        return crc32_slice8;
+    }
+
+
+    // ---- COMBINATION ----
+    //
+    // Polynomials mod P, reflected: appending n zero bytes to A is a
+    // multiplication by x^(8n), built from the precomputed x^(2^k).
+    //
+    constexpr std::uint32_t multiply( std::uint32_t a, std::uint32_t b ) {
+        std::uint32_t product = 0;
+
+        for ( std::uint32_t mask = 1u << 31; mask != 0; mask >>= 1 ) {
+            if ( a & mask )
+                product ^= b;
+
+            b = b & 1 ? ( b >> 1 ) ^ POLYNOMIAL : b >> 1;
+        }
+
+        return product;
+    }
+
+
+    /* x^(2^k) mod P, these repeat with a period of 32 */
+    constexpr auto make_powers( void ) {
+        std::array<std::uint32_t, 32> powers {};
+
+        powers[0] = 1u << 30;   /* x^1 */
+
+        for ( std::size_t k = 1; k < powers.size(); k++ )
+            powers[k] = multiply( powers[ k - 1 ], powers[ k - 1 ] );
+
+        return powers;
+    }
+
+    constexpr auto POWERS = make_powers();
+}
+
+
+std::uint32_t utils::crc32( std::uint32_t crc, std::span<const std::byte> data ) {
+    static const crc32_t implementation = resolve_crc32();
+
+    return ~implementation( ~crc, data.data(), data.size() );
+}
+
+
+std::uint32_t utils::crc32_combine( std::uint32_t crc_a,
+                                    std::uint32_t crc_b,
+                                    std::uint64_t length_b
+) {
+    /* x^(8 * length_b): one factor per set bit, starting at x^8 */
+    std::uint32_t shift = 1u << 31;     /* x^0 */
+
+    for ( std::size_t k = 3; length_b != 0; length_b >>= 1, k++ ) {
+        if ( length_b & 1 )
+            shift = multiply( POWERS[ k & 31 ], shift );
+    }
+
+    return multiply( shift, crc_a ) ^ crc_b;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace utils {
+
+    // ---- CRC-32 ----
+    //
+    // The gzip CRC (reflected 0x04C11DB7, as zlib's crc32). Runs of 64
+    // bytes or more are folded 512 bits at a time with carry-less
+    // multiplies (PCLMULQDQ) when the running CPU has them; everything
+    // else goes through slicing-by-8 tables, 8 bytes per step.
+    //
+    // Chained like zlib: start from 0, pass the previous result back in.
+    //
+    [[nodiscard]]
+    std::uint32_t crc32( std::uint32_t crc, std::span<const std::byte> data );
+    // +
+    // CRC of A followed by B, from the CRCs of A and B and the length of
+    // B alone: lets parallel workers checksum their blocks separately.
+    // O(log length), no table rebuilt per call.
+    //
+    [[nodiscard]]
+    std::uint32_t crc32_combine( std::uint32_t crc_a,
+                                 std::uint32_t crc_b,
+                                 std::uint64_t length_b );
+}
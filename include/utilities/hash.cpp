@@ -0,0 +1,204 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/hash.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// ---- INTERNAL LINKAGES ----
+//
+namespace {
+
+    // ---- XXH64 PRIMES ----
+    //
+    constexpr std::uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+    constexpr std::uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr std::uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+    constexpr std::uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr std::uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+
+    /* Little-endian loads, the format is defined that way */
+    std::uint64_t read_le64( const std::byte *data ) {
+        std::uint64_t value;
+        std::memcpy( &value, data, sizeof value );
+
+        if constexpr ( std::endian::native == std::endian::big )
+            value = __builtin_bswap64( value );
+
+        return value;
+    }
+    // +
+    std::uint32_t read_le32( const std::byte *data ) {
+        std::uint32_t value;
+        std::memcpy( &value, data, sizeof value );
+
+        if constexpr ( std::endian::native == std::endian::big )
+            value = __builtin_bswap32( value );
+
+        return value;
+    }
+
+
+    std::uint64_t round( std::uint64_t lane, std::uint64_t input ) {
+        lane += input * PRIME_2;
+        lane  = std::rotl( lane, 31 );
+        return lane * PRIME_1;
+    }
+    // +
+    std::uint64_t merge( std::uint64_t hash, std::uint64_t lane ) {
+        hash ^= round( 0, lane );
+        return hash * PRIME_1 + PRIME_4;
+    }
+
+
+    constexpr std::size_t READ_SIZE = 256 * 1024;
+}
+
+
+/* ------------------------ XXH64:: IMPLEMENTATION ------------------------ */
+
+void utils::Xxh64::update( std::span<const std::byte> data ) {
+    total += data.size();
+
+    /* Top up the partial stripe left by the previous call */
+    if ( buffered > 0 ) {
+        const auto fill = std::min( data.size(), pending.size() - buffered );
+
+        std::memcpy( pending.data() + buffered, data.data(), fill );
+        buffered += fill;
+        data      = data.subspan( fill );
+
+        if ( buffered < pending.size() )
+            return;
+
+        for ( std::size_t i = 0; i < 4; i++ )
+            lanes[i] = round( lanes[i], read_le64( pending.data() + i * 8 ));
+
+        buffered = 0;
+    }
+
+
+    while ( data.size() >= 32 ) {
+        for ( std::size_t i = 0; i < 4; i++ )
+            lanes[i] = round( lanes[i], read_le64( data.data() + i * 8 ));
+
+        data = data.subspan( 32 );
+    }
+
+    std::memcpy( pending.data(), data.data(), data.size() );
+    buffered = data.size();
+}
+
+
+std::uint64_t utils::Xxh64::digest( void ) const {
+    std::uint64_t hash;
+
+    if ( total >= 32 ) {
+        hash = std::rotl( lanes[0],  1 ) + std::rotl( lanes[1],  7 )
+             + std::rotl( lanes[2], 12 ) + std::rotl( lanes[3], 18 );
+
+        for ( const auto lane : lanes )
+            hash = merge( hash, lane );
+
+    } else {
+        hash = seed + PRIME_5;
+    }
+
+    hash += total;
+
+
+    /* Tail: whatever did not fill a full stripe */
+    const std::byte *tail = pending.data();
+    std::size_t      left = buffered;
+
+    for ( ; left >= 8; tail += 8, left -= 8 ) {
+        hash ^= round( 0, read_le64( tail ));
+        hash  = std::rotl( hash, 27 ) * PRIME_1 + PRIME_4;
+    }
+
+    if ( left >= 4 ) {
+        hash ^= std::uint64_t( read_le32( tail )) * PRIME_1;
+        hash  = std::rotl( hash, 23 ) * PRIME_2 + PRIME_3;
+        tail += 4;
+        left -= 4;
+    }
+
+    for ( ; left > 0; tail++, left-- ) {
+        hash ^= std::to_integer<std::uint64_t>( *tail ) * PRIME_5;
+        hash  = std::rotl( hash, 11 ) * PRIME_1;
+    }
+
+
+    /* Final avalanche */
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+
+utils::Xxh64::Xxh64( std::uint64_t _seed )
+  : lanes {
+        _seed + PRIME_1 + PRIME_2,
+        _seed + PRIME_2,
+        _seed,
+        _seed - PRIME_1
+    },
+    seed { _seed }
+{}
+
+
+std::uint64_t utils::hash_file( const std::filesystem::path &path,
+                                std::error_code &ec
+) {
+    ec.clear();
+
+    const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        ec = { errno, std::generic_category() };
+        return 0;
+    }
+
+    ::posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    Xxh64 hasher;
+    std::vector<std::byte> buffer ( READ_SIZE );
+
+    while ( true ) {
+        const auto count = ::read( fd, buffer.data(), buffer.size() );
+
+        if ( count < 0 and errno == EINTR )
+            continue;
+
+        if ( count < 0 ) {
+            ec = { errno, std::generic_category() };
+            break;
+        }
+
+        if ( count == 0 )
+            break;
+
+        hasher.update({ buffer.data(), std::size_t( count ) });
+    }
+
+    ::close( fd );
+    return hasher.digest();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <system_error>
+
+
+namespace utils {
+
+    // ---- XXH64 ----
+    //
+    // Streaming implementation of the 64-bit xxHash. Not cryptographic,
+    // only meant to tell whether a file's contents changed.
+    //
+    class Xxh64 {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit Xxh64( std::uint64_t _seed = 0 );
+
+
+        // ---- MAIN METHODS ----
+        //
+        void update( std::span<const std::byte> data );
+        // +
+        [[nodiscard]]
+        std::uint64_t digest( void ) const;
+
+
+    private:
+        // ---- STATE ----
+        //
+        std::array<std::uint64_t, 4> lanes;
+        std::array<std::byte, 32>    pending {};
+        // +
+        std::uint64_t seed;
+        std::uint64_t total   = 0;
+        std::size_t   buffered = 0;
+    };
+
+
+    // ---- HELPER FUNCTIONS ----
+    //
+    /* Hash of the whole file, ec is set when it cannot be read */
+    std::uint64_t hash_file( const std::filesystem::path &path,
+                             std::error_code &ec );
+}
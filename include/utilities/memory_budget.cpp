@@ -0,0 +1,52 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/memory_budget.hpp"
+
+
+utils::MemoryBudget::MemoryBudget( std::size_t _limit )
+  : limit { _limit }
+{}
+
+
+std::size_t utils::MemoryBudget::get_limit( void ) const {
+    return limit;
+}
+
+
+void utils::MemoryBudget::signal( void ) {
+    events.fetch_add( 1, std::memory_order_release );
+    events.notify_all();
+}
+
+
+bool utils::MemoryBudget::acquire( std::size_t bytes ) {
+    while ( true ) {
+        /* Read before checking: a release in between changes it */
+        const auto seen = events.load( std::memory_order_acquire );
+
+        if ( closed.load( std::memory_order_acquire ))
+            return false;
+
+        auto held = used.load( std::memory_order_acquire );
+
+        while ( held == 0 or held + bytes <= limit ) {
+            if ( used.compare_exchange_weak( held, held + bytes,
+                                             std::memory_order_acq_rel ))
+                return true;
+        }
+
+        events.wait( seen, std::memory_order_acquire );
+    }
+}
+
+
+void utils::MemoryBudget::release( std::size_t bytes ) {
+    used.fetch_sub( bytes, std::memory_order_acq_rel );
+    signal();
+}
+
+
+void utils::MemoryBudget::close( void ) {
+    closed.store( true, std::memory_order_release );
+    signal();
+}
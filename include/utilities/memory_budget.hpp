@@ -0,0 +1,66 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace utils {
+
+    // ---- MEMORY BUDGET ----
+    //
+    // Caps the bytes a pipeline stage keeps in flight. The producer
+    // acquires what it is about to hold and waits while that would go
+    // over the limit; the consumer releases it once done. Lock-free, a
+    // blocked acquire() sleeps on the atomic itself.
+    //
+    class MemoryBudget {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit MemoryBudget( std::size_t _limit );
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        MemoryBudget( const MemoryBudget& ) = delete;
+        MemoryBudget& operator=( const MemoryBudget& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        // Blocks until `bytes` fit. A request larger than the whole limit
+        // waits until nothing else is held, so it can never deadlock.
+        // False once closed.
+        //
+        bool acquire( std::size_t bytes );
+        // +
+        void release( std::size_t bytes );
+        // +
+        /* Wakes and fails every acquire(), for a consumer giving up */
+        void close( void );
+
+
+        // ---- GETTERS ----
+        //
+        [[nodiscard]]
+        std::size_t get_limit( void ) const;
+
+
+    private:
+        // ---- BUDGET STATE ----
+        //
+        const std::size_t limit;
+        // +
+        std::atomic<std::size_t>   used   { 0 };
+        std::atomic<std::uint32_t> events { 0 };
+        std::atomic<bool>          closed { false };
+
+
+        // ---- WAKE UP ----
+        //
+        void signal( void );
+    };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace utils {
+
+    // ---- SPSC QUEUE ----
+    //
+    // Bounded ring between exactly one producer and one consumer thread.
+    // Both ends only touch atomics, no lock is taken on the data path.
+    // push() blocks while the ring is full, which is what holds back a
+    // stage running ahead of the next one (backpressure); pop() blocks
+    // while it is empty.
+    //
+    // close() ends the stream: the consumer still drains what is left,
+    // the producer's push() fails from then on.
+    //
+    template <typename T>
+    class SpscQueue {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        /* Rounded up to a power of two */
+        explicit SpscQueue( std::size_t _capacity );
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        SpscQueue( const SpscQueue& ) = delete;
+        SpscQueue& operator=( const SpscQueue& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        /* False once closed, `item` is left untouched then */
+        bool push( T &&item );
+        // +
+        /* False once closed and drained */
+        bool pop( T &item );
+        // +
+        /* Never blocks, false while empty */
+        bool try_pop( T &item );
+        // +
+        void close( void );
+
+
+    private:
+        // ---- RING LAYOUT ----
+        //
+        /* Each index on its own cache line, the two sides never share one */
+        static constexpr std::size_t CACHE_LINE = 64;
+        // +
+        std::vector<T> slots;
+        std::size_t    mask;
+
+
+        // ---- SHARED STATE ----
+        //
+        alignas( CACHE_LINE ) std::atomic<std::size_t> head { 0 };  /* next to pop  */
+        alignas( CACHE_LINE ) std::atomic<std::size_t> tail { 0 };  /* next to push */
+        // +
+        /* Bumped on every change, what a blocked side waits on */
+        alignas( CACHE_LINE ) std::atomic<std::uint32_t> events { 0 };
+        std::atomic<bool>                                closed { false };
+
+
+        // ---- WAKE UP ----
+        //
+        void signal( void );
+    };
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+
+// ---- TEMPLATE IMPLEMENTATIONS ----
+//
+template <typename T>
+utils::SpscQueue<T>::SpscQueue( std::size_t _capacity )
+  : slots ( std::bit_ceil( std::max<std::size_t>( _capacity, 2 ))),
+    mask  { slots.size() - 1 }
+{}
+
+
+template <typename T>
+void utils::SpscQueue<T>::signal( void ) {
+    events.fetch_add( 1, std::memory_order_release );
+    events.notify_all();
+}
+
+
+template <typename T>
+bool utils::SpscQueue<T>::push( T &&item ) {
+    const auto position = tail.load( std::memory_order_relaxed );
+
+    /* The event count is read first: a pop in between changes it */
+    while ( true ) {
+        const auto seen = events.load( std::memory_order_acquire );
+
+        if ( closed.load( std::memory_order_acquire ))
+            return false;
+
+        if ( position - head.load( std::memory_order_acquire ) < slots.size() )
+            break;
+
+        events.wait( seen, std::memory_order_acquire );
+    }
+
+    slots[ position & mask ] = std::move( item );
+    tail.store( position + 1, std::memory_order_release );
+
+    signal();
+    return true;
+}
+
+
+template <typename T>
+bool utils::SpscQueue<T>::try_pop( T &item ) {
+    const auto position = head.load( std::memory_order_relaxed );
+
+    if ( position == tail.load( std::memory_order_acquire ))
+        return false;
+
+    item = std::move( slots[ position & mask ] );
+    head.store( position + 1, std::memory_order_release );
+
+    signal();
+    return true;
+}
+
+
+template <typename T>
+bool utils::SpscQueue<T>::pop( T &item ) {
+    while ( true ) {
+        const auto seen = events.load( std::memory_order_acquire );
+
+        if ( try_pop( item ))
+            return true;
+
+        /* Closed after the last push: nothing else can arrive */
+        if ( closed.load( std::memory_order_acquire ))
+            return try_pop( item );
+
+        events.wait( seen, std::memory_order_acquire );
+    }
+}
+
+
+template <typename T>
+void utils::SpscQueue<T>::close( void ) {
+    closed.store( true, std::memory_order_release );
+    signal();
+}
@@ -0,0 +1,120 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/thread_pool.hpp"
+
+
+// ---- EXTERNAL INCLUDES ----
+//
+#include <fmt/core.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+
+std::size_t utils::ThreadPool::resolve_workers( std::int64_t requested ) {
+    if ( requested > 0 )
+        return static_cast<std::size_t>( requested );
+
+    return std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+
+std::size_t utils::ThreadPool::size( void ) const {
+    return workers.size();
+}
+
+
+std::future<void> utils::ThreadPool::submit( std::function<void()> task ) {
+    std::packaged_task<void()> packaged { std::move( task ) };
+    auto future = packaged.get_future();
+
+    {
+        std::lock_guard lock { mutex };
+        tasks.push( std::move( packaged ));
+    }
+
+    task_ready.notify_one();
+    return future;
+}
+
+
+std::future<void> utils::ThreadPool::submit( std::atomic<bool> &failed,
+                                             std::function<void()> task
+) {
+    return submit( [&failed, task = std::move( task )] {
+        try {
+            task();
+
+        } catch ( const std::exception &error ) {
+            fmt::println( stderr, "\x1b[1;31mError\x1b[0m: {}", error.what() );
+            failed = true;
+        }
+    });
+}
+
+
+void utils::ThreadPool::wait_idle( void ) {
+    std::unique_lock lock { mutex };
+
+    all_idle.wait( lock, [&] {
+        return tasks.empty() and busy == 0;
+    });
+}
+
+
+void utils::ThreadPool::run( void ) {
+    while ( true ) {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock lock { mutex };
+
+            task_ready.wait( lock, [&] {
+                return stopping or not tasks.empty();
+            });
+
+            if ( tasks.empty() )
+                return;
+
+            task = std::move( tasks.front() );
+            tasks.pop();
+            busy++;
+        }
+
+        /* Exceptions are stored in the task's future */
+        task();
+
+        {
+            std::lock_guard lock { mutex };
+            busy--;
+
+            if ( tasks.empty() and busy == 0 )
+                all_idle.notify_all();
+        }
+    }
+}
+
+
+utils::ThreadPool::ThreadPool( std::size_t _workers ) {
+    workers.reserve( std::max<std::size_t>( _workers, 1 ));
+
+    for ( std::size_t i = 0; i < std::max<std::size_t>( _workers, 1 ); i++ )
+        workers.emplace_back( [this] { run(); } );
+}
+
+
+utils::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock { mutex };
+        stopping = true;
+    }
+
+    task_ready.notify_all();
+
+    for ( auto &worker : workers )
+        worker.join();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// ---- STANDARD INCLUDES ----
+//
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+
+    // ---- THREAD POOL ----
+    //
+    // Fixed set of workers draining a FIFO of tasks. Tasks are plain
+    // callables, submit() hands back a future to wait for (or collect
+    // exceptions from) each one.
+    //
+    class ThreadPool {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit ThreadPool( std::size_t _workers );
+        ~ThreadPool();
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        ThreadPool( const ThreadPool& ) = delete;
+        ThreadPool& operator=( const ThreadPool& ) = delete;
+
+
+        // ---- MAIN METHODS ----
+        //
+        std::future<void> submit( std::function<void()> task );
+        // +
+        /* An exception thrown by `task` is reported and sets `failed`,
+         * it never reaches the future: neither lost in one nobody reads
+         * nor rethrown by get() */
+        std::future<void> submit( std::atomic<bool> &failed,
+                                  std::function<void()> task );
+        // +
+        void wait_idle( void );
+
+
+        // ---- GETTERS ----
+        //
+        [[nodiscard]]
+        std::size_t size( void ) const;
+
+
+        // ---- HELPERS ----
+        //
+        /* 0 (or less) means one worker per hardware thread */
+        [[nodiscard]]
+        static std::size_t resolve_workers( std::int64_t requested );
+
+
+    private:
+        // ---- WORKERS ----
+        //
+        std::vector<std::thread> workers;
+
+
+        // ---- QUEUE STATE ----
+        //
+        std::queue<std::packaged_task<void()>> tasks;
+        // +
+        std::mutex              mutex;
+        std::condition_variable task_ready;
+        std::condition_variable all_idle;
+        // +
+        std::size_t busy     = 0;
+        bool        stopping = false;
+
+
+        // ---- WORKER LOOP ----
+        //
+        void run( void );
+    };
+}
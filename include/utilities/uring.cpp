@@ -0,0 +1,176 @@
+// ---- LOCAL INCLUDES ----
+//
+#include "utilities/uring.hpp"
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+bool utils::IoUring::has_errors( void ) const {
+    return fd < 0;
+}
+
+
+bool utils::IoUring::supports( std::initializer_list<std::uint8_t> opcodes ) const {
+    if ( has_errors() )
+        return false;
+
+    constexpr unsigned MAX_OPS = 256;
+
+    std::vector<std::byte> storage(
+        sizeof( io_uring_probe ) + MAX_OPS * sizeof( io_uring_probe_op )
+    );
+
+    auto *probe = reinterpret_cast<io_uring_probe*>( storage.data() );
+
+    if ( ::syscall( __NR_io_uring_register, fd,
+                    IORING_REGISTER_PROBE, probe, MAX_OPS ) < 0 )
+        return false;
+
+    return std::all_of( opcodes.begin(), opcodes.end(), [&]( auto op ) {
+        return op <= probe->last_op
+           and ( probe->ops[op].flags & IO_URING_OP_SUPPORTED );
+    });
+}
+
+
+io_uring_sqe *utils::IoUring::get_sqe( void ) {
+    const unsigned head = __atomic_load_n( sq_head, __ATOMIC_ACQUIRE );
+
+    if ( local_tail - head >= sq_entries )
+        return nullptr;
+
+    const unsigned index = local_tail & *sq_mask;
+    auto *sqe = &sqes[ index ];
+
+    std::memset( sqe, 0, sizeof( *sqe ));
+    sq_array[ index ] = index;
+    local_tail++;
+
+    return sqe;
+}
+
+
+int utils::IoUring::submit_and_wait( unsigned wait_nr ) {
+    /* Publish the prepared entries before entering the kernel */
+    __atomic_store_n( sq_tail, local_tail, __ATOMIC_RELEASE );
+
+    const unsigned to_submit = local_tail - submitted;
+    const unsigned flags     = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    while ( true ) {
+        const auto result = ::syscall( __NR_io_uring_enter, fd,
+            to_submit, wait_nr, flags, nullptr, 0
+        );
+
+        if ( result < 0 and errno == EINTR )
+            continue;
+
+        if ( result < 0 )
+            return -errno;
+
+        submitted += static_cast<unsigned>( result );
+        return static_cast<int>( result );
+    }
+}
+
+
+utils::IoUring::IoUring( unsigned _entries ) {
+    io_uring_params params {};
+
+    fd = static_cast<int>(
+        ::syscall( __NR_io_uring_setup, _entries, &params )
+    );
+
+    if ( fd < 0 )
+        return;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    cq_size = params.cq_off.cqes  + params.cq_entries * sizeof( io_uring_cqe );
+
+    /* Since 5.4 both rings live in a single mapping */
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+        sq_size = cq_size = std::max( sq_size, cq_size );
+
+
+    sq_ptr = ::mmap( nullptr, sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+
+    if ( sq_ptr == MAP_FAILED ) {
+        sq_ptr = nullptr;
+        ::close( std::exchange( fd, -1 ));
+        return;
+    }
+
+    if ( params.features & IORING_FEAT_SINGLE_MMAP ) {
+        cq_ptr = sq_ptr;
+
+    } else {
+        cq_ptr = ::mmap( nullptr, cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+
+        if ( cq_ptr == MAP_FAILED ) {
+            cq_ptr = nullptr;
+            ::close( std::exchange( fd, -1 ));
+            return;
+        }
+    }
+
+
+    sqes_size = params.sq_entries * sizeof( io_uring_sqe );
+
+    void *sqes_ptr = ::mmap( nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+
+    if ( sqes_ptr == MAP_FAILED ) {
+        ::close( std::exchange( fd, -1 ));
+        return;
+    }
+
+    sqes = static_cast<io_uring_sqe*>( sqes_ptr );
+
+
+    auto *sq = static_cast<char*>( sq_ptr );
+    auto *cq = static_cast<char*>( cq_ptr );
+
+    sq_head    = reinterpret_cast<unsigned*>( sq + params.sq_off.head  );
+    sq_tail    = reinterpret_cast<unsigned*>( sq + params.sq_off.tail  );
+    sq_mask    = reinterpret_cast<unsigned*>( sq + params.sq_off.ring_mask );
+    sq_array   = reinterpret_cast<unsigned*>( sq + params.sq_off.array );
+    sq_entries = params.sq_entries;
+
+    cq_head = reinterpret_cast<unsigned*>( cq + params.cq_off.head );
+    cq_tail = reinterpret_cast<unsigned*>( cq + params.cq_off.tail );
+    cq_mask = reinterpret_cast<unsigned*>( cq + params.cq_off.ring_mask );
+    cqes    = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+
+    local_tail = submitted = *sq_tail;
+}
+
+
+utils::IoUring::~IoUring() {
+    if ( sqes != nullptr )
+        ::munmap( sqes, sqes_size );
+
+    if ( cq_ptr != nullptr and cq_ptr != sq_ptr )
+        ::munmap( cq_ptr, cq_size );
+
+    if ( sq_ptr != nullptr )
+        ::munmap( sq_ptr, sq_size );
+
+    if ( fd >= 0 )
+        ::close( fd );
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// ---- SYSTEM INCLUDES ----
+//
+#include <linux/io_uring.h>
+
+
+// ---- STANDARD INCLUDES ----
+//
+#include <cstdint>
+#include <initializer_list>
+
+
+namespace utils {
+
+    // ---- IO_URING RING ----
+    //
+    // Minimal wrapper over the raw io_uring syscalls (no liburing): one
+    // submission and one completion ring, mapped at construction. Not
+    // thread-safe, each ring belongs to the thread that drives it.
+    //
+    class IoUring {
+    public:
+        // ---- CONSTRUCTORS ----
+        //
+        explicit IoUring( unsigned _entries );
+        ~IoUring();
+
+
+        // ---- PROHIBIT COPY ----
+        //
+        IoUring( const IoUring& ) = delete;
+        IoUring& operator=( const IoUring& ) = delete;
+
+
+        // ---- ERROR HANDLING ----
+        //
+        /* true when the kernel refused the ring (old kernel, seccomp...) */
+        [[nodiscard]]
+        bool has_errors( void ) const;
+        // +
+        [[nodiscard]]
+        bool supports( std::initializer_list<std::uint8_t> opcodes ) const;
+
+
+        // ---- SUBMISSION ----
+        //
+        /* nullptr when the submission ring is full */
+        [[nodiscard]]
+        io_uring_sqe *get_sqe( void );
+        // +
+        int submit_and_wait( unsigned wait_nr );
+
+
+        // ---- COMPLETION ----
+        //
+        template <typename Callback>
+        unsigned for_each_cqe( Callback &&callback );
+
+
+    private:
+        // ---- RING STATE ----
+        //
+        int fd = -1;
+        // +
+        void        *sq_ptr   = nullptr;
+        void        *cq_ptr   = nullptr;
+        std::size_t  sq_size  = 0;
+        std::size_t  cq_size  = 0;
+        // +
+        io_uring_sqe *sqes      = nullptr;
+        std::size_t   sqes_size = 0;
+
+
+        // ---- SUBMISSION QUEUE ----
+        //
+        unsigned *sq_head  = nullptr;
+        unsigned *sq_tail  = nullptr;
+        unsigned *sq_mask  = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned  sq_entries = 0;
+        // +
+        unsigned local_tail = 0;
+        unsigned submitted  = 0;
+
+
+        // ---- COMPLETION QUEUE ----
+        //
+        unsigned     *cq_head = nullptr;
+        unsigned     *cq_tail = nullptr;
+        unsigned     *cq_mask = nullptr;
+        io_uring_cqe *cqes    = nullptr;
+    };
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+
+// ---- TEMPLATE IMPLEMENTATIONS ----
+//
+template <typename Callback>
+unsigned utils::IoUring::for_each_cqe( Callback &&callback ) {
+    unsigned head  = *cq_head;
+    unsigned count = 0;
+
+    const unsigned tail = __atomic_load_n( cq_tail, __ATOMIC_ACQUIRE );
+
+    for (; head != tail; head++, count++ ) {
+        const auto &cqe = cqes[ head & *cq_mask ];
+        callback( cqe.user_data, cqe.res );
+    }
+
+    /* Hand the consumed entries back to the kernel */
+    __atomic_store_n( cq_head, head, __ATOMIC_RELEASE );
+    return count;
+}
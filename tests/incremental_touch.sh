@@ -0,0 +1,40 @@
+#!/bin/sh
+# A file whose mtime changed but whose contents did not must be neither
+# restaged nor make the archive rebuild on the next run.
+#
+# usage: incremental_touch.sh <comprexxion executable>
+
+set -eu
+
+BIN=$( realpath "$1" )
+WORK=$( mktemp -d )
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+
+mkdir -p src/sub
+echo one > src/a.txt
+echo two > src/sub/b.txt
+
+cat > config.txt <<CONFIG
+project_name: "out"
+structure:
+    +d "src/" *
+CONFIG
+
+"$BIN" -c config.txt > first.log
+
+touch -m -d "2030-01-01 00:00:00" src/a.txt
+
+"$BIN" -c config.txt > second.log
+
+fail() {
+    echo "FAIL: $1"
+    cat second.log
+    exit 1
+}
+
+grep -q ", 0 files, 2 unchanged" second.log || fail "touched file was restaged"
+grep -q "archive up to date"     second.log || fail "archive was rebuilt"
+
+echo "OK"
@@ -0,0 +1,45 @@
+#!/bin/sh
+# A fresh archive must verify against the source tree it was built
+# from, and a file changed afterwards must be reported.
+#
+# usage: verify_source.sh <comprexxion executable>
+
+set -eu
+
+BIN=$( realpath "$1" )
+WORK=$( mktemp -d )
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+
+mkdir -p src/sub
+echo one > src/a.txt
+echo two > src/sub/b.txt
+
+cat > config.txt <<CONFIG
+project_name: "out"
+archive_mode: "direct"
+structure:
+    +d "src/" *
+CONFIG
+
+"$BIN" -c config.txt > build.log
+
+fail() {
+    echo "FAIL: $1"
+    cat verify.log
+    exit 1
+}
+
+"$BIN" --verify out.tar.gz . > verify.log || fail "fresh archive does not verify"
+grep -q "(2 files, 0 failed, 0 missing)" verify.log || fail "wrong counts"
+
+echo changed > src/a.txt
+
+if "$BIN" --verify out.tar.gz . > verify.log; then
+    fail "changed file was not reported"
+fi
+
+grep -q "src/a.txt: .*FAILED" verify.log || fail "changed file not named"
+
+echo "OK"